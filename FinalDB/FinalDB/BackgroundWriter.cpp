@@ -0,0 +1,121 @@
+#include "BackgroundWriter.h"
+#include "Metrics.h"
+#include <algorithm>
+using namespace std;
+
+BackgroundWriter::BackgroundWriter(function<void()> save)
+    : save(move(save)),
+    worker(&BackgroundWriter::run, this) {
+}
+
+BackgroundWriter::~BackgroundWriter() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void BackgroundWriter::commit(size_t mutations) {
+    mutations = max<size_t>(mutations, 1);
+    unique_lock<std::mutex> lock(mutex);
+    uint64_t seq = ++committedSeq;
+    if (durability == Durability::SYNC) {
+        lock.unlock();
+        {
+            FINALDB_METRIC_SCOPE("writer.write");
+            FINALDB_METRIC_ROWS(mutations, mutations);
+            save();
+        }
+        lock.lock();
+        writtenSeq = max(writtenSeq, seq);
+        ++writes;
+        written.notify_all();
+        return;
+    }
+    if (pending == 0) firstPending = chrono::steady_clock::now();
+    pending += mutations;
+    // BATCHED: будим на первом изменении (запуск таймера) и на пороге пачки
+    if (durability == Durability::DEFERRED) return;
+    if (durability == Durability::ASYNC || pending == mutations || pending >= maxBatch)
+        wake.notify_one();
+}
+
+void BackgroundWriter::flush() {
+    unique_lock<std::mutex> lock(mutex);
+    uint64_t target = committedSeq;
+    if (writtenSeq >= target) return;
+    flushRequested = true;
+    wake.notify_one();
+    written.wait(lock, [&] { return writtenSeq >= target; });
+}
+
+// Одна итерация — одна группа: всё, что накопилось к моменту записи
+void BackgroundWriter::run() {
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] {
+            return stopping || (pending > 0 && (durability != Durability::DEFERRED || flushRequested));
+        });
+        if (pending == 0) break;   // остановка, всё записано
+        if (durability == Durability::BATCHED) {
+            wake.wait_until(lock, firstPending + maxDelay,
+                [this] { return stopping || flushRequested || pending >= maxBatch; });
+        }
+        uint64_t target = committedSeq;
+        [[maybe_unused]] size_t group = pending;   // только для метрик
+        pending = 0;
+        flushRequested = false;
+        lock.unlock();
+        {
+            FINALDB_METRIC_SCOPE("writer.write");
+            FINALDB_METRIC_ROWS(group, group);
+            save();
+        }
+        lock.lock();
+        writtenSeq = max(writtenSeq, target);
+        ++writes;
+        written.notify_all();
+    }
+}
+
+void BackgroundWriter::setDurability(Durability level) {
+    flush();
+    lock_guard<std::mutex> lock(mutex);
+    durability = level;
+}
+
+BackgroundWriter::Durability BackgroundWriter::getDurability() const {
+    lock_guard<std::mutex> lock(mutex);
+    return durability;
+}
+
+void BackgroundWriter::setBatchLimits(size_t batch, chrono::milliseconds delay) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        maxBatch = max<size_t>(batch, 1);
+        maxDelay = max(delay, chrono::milliseconds(0));
+    }
+    wake.notify_one();
+}
+
+size_t BackgroundWriter::getMaxBatch() const {
+    lock_guard<std::mutex> lock(mutex);
+    return maxBatch;
+}
+
+chrono::milliseconds BackgroundWriter::getMaxDelay() const {
+    lock_guard<std::mutex> lock(mutex);
+    return maxDelay;
+}
+
+uint64_t BackgroundWriter::getCommitCount() const {
+    lock_guard<std::mutex> lock(mutex);
+    return committedSeq;
+}
+
+uint64_t BackgroundWriter::getWriteCount() const {
+    lock_guard<std::mutex> lock(mutex);
+    return writes;
+}
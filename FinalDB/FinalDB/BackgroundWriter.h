@@ -0,0 +1,64 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Фоновая запись на диск с групповой фиксацией.
+// Операция меняет таблицы и вызывает commit(n) — n изменений в пачке.
+// Поток-писатель вызывает save() один раз на накопленную группу:
+//   SYNC    — save() сразу в вызывающем потоке (как раньше);
+//   ASYNC   — писатель просыпается на каждый commit;
+//   BATCHED — писатель ждёт maxBatch изменений или maxDelay с первого;
+//   DEFERRED — изменения копятся до flush() (пакетный сценарий).
+// flush() — барьер: возвращается, когда всё зафиксированное до него записано.
+// save() сам отвечает за блокировку данных, которые читает.
+class BackgroundWriter {
+public:
+    enum class Durability { SYNC, ASYNC, BATCHED, DEFERRED };
+
+    explicit BackgroundWriter(std::function<void()> save);
+    ~BackgroundWriter();   // дописывает всё накопленное и останавливает поток
+
+    BackgroundWriter(const BackgroundWriter&) = delete;
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+    void commit(size_t mutations = 1);
+    void flush();
+
+    // Смена уровня сначала дописывает накопленное по старому
+    void setDurability(Durability level);
+    Durability getDurability() const;
+    void setBatchLimits(size_t maxBatch, std::chrono::milliseconds maxDelay);
+    size_t getMaxBatch() const;
+    std::chrono::milliseconds getMaxDelay() const;
+
+    // Счётчики для меню: фиксаций и фактических записей на диск
+    uint64_t getCommitCount() const;
+    uint64_t getWriteCount() const;
+
+private:
+    void run();
+
+    std::function<void()> save;
+    mutable std::mutex mutex;
+    std::condition_variable wake;      // писателю: есть работа
+    std::condition_variable written;   // flush(): группа записана
+
+    Durability durability = Durability::BATCHED;
+    size_t maxBatch = 256;
+    std::chrono::milliseconds maxDelay{ 100 };
+
+    size_t pending = 0;                // изменений в текущей группе
+    std::chrono::steady_clock::time_point firstPending;
+    uint64_t committedSeq = 0;         // номер последней фиксации
+    uint64_t writtenSeq = 0;           // до какого номера всё на диске
+    uint64_t writes = 0;
+    bool flushRequested = false;
+    bool stopping = false;
+
+    std::thread worker;                // последним: стартует после полей
+};
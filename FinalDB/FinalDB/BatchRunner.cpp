@@ -0,0 +1,383 @@
+#include "BatchRunner.h"
+#include "Metrics.h"
+#include "TableFormatter.h"
+#include "Validation.h"
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+
+void need(const vector<string>& args, size_t count, const char* usage) {
+    if (args.size() < count) throw invalid_argument(string("Usage: ") + usage);
+}
+
+int toInt(const string& text) {
+    char* end = nullptr;
+    long value = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end) throw invalid_argument("Invalid number: " + text);
+    return static_cast<int>(value);
+}
+
+double toDouble(const string& text) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (text.empty() || *end) throw invalid_argument("Invalid number: " + text);
+    return value;
+}
+
+// Значение перечисления по имени, как его печатает таблица
+template <typename Enum>
+Enum toEnum(const string& text, string (*name)(Enum), const char* what) {
+    for (int i = 0; i < 3; ++i)
+        if (name(static_cast<Enum>(i)) == text) return static_cast<Enum>(i);
+    throw invalid_argument(string("Unknown ") + what + ": " + text);
+}
+
+void checkDate(const string& date) {
+    if (!Validation::isDate(date)) throw invalid_argument("Invalid date format: " + date);
+}
+
+string money(double value) {
+    ostringstream oss;
+    oss << fixed << setprecision(2) << value;
+    return oss.str();
+}
+
+} // namespace
+
+BatchRunner::BatchRunner(DatabaseManager& db, ostream& out, ostream& err)
+    : db(db), out(out), err(err) {
+}
+
+vector<string> BatchRunner::tokenize(const string& line) {
+    vector<string> tokens;
+    size_t i = 0;
+    while (i < line.size()) {
+        if (isspace(static_cast<unsigned char>(line[i]))) {
+            ++i;
+            continue;
+        }
+        string token;
+        if (line[i] == '"') {
+            size_t close = line.find('"', i + 1);
+            if (close == string::npos) throw invalid_argument("Unterminated quote");
+            token = line.substr(i + 1, close - i - 1);
+            i = close + 1;
+        }
+        else {
+            while (i < line.size() && !isspace(static_cast<unsigned char>(line[i]))) token += line[i++];
+        }
+        tokens.push_back(move(token));
+    }
+    return tokens;
+}
+
+BatchRunner::Report BatchRunner::run(istream& script) {
+    Report report;
+    BackgroundWriter& writer = db.getWriter();
+    BackgroundWriter::Durability previous = writer.getDurability();
+    writer.setDurability(BackgroundWriter::Durability::DEFERRED);
+    auto start = chrono::steady_clock::now();
+    {
+        // Весь сценарий — под одной блокировкой; commit только считает изменения
+        auto lock = db.lockTables();
+        string line;
+        size_t lineNo = 0;
+        while (getline(script, line)) {
+            ++lineNo;
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == string::npos || line[first] == '#') continue;
+            ++report.commands;
+            try {
+                execute(line);
+            }
+            catch (const exception& e) {
+                ++report.failed;
+                err << "line " << lineNo << ": Error: " << e.what() << "\n";
+            }
+        }
+    }
+    auto ran = chrono::steady_clock::now();
+    // Писатель сохраняет под tablesMutex, поэтому flush — после снятия блокировки
+    db.flush();
+    writer.setDurability(previous);
+    report.runMs = chrono::duration<double, milli>(ran - start).count();
+    report.saveMs = chrono::duration<double, milli>(chrono::steady_clock::now() - ran).count();
+    return report;
+}
+
+void BatchRunner::execute(const string& line) {
+    FINALDB_METRIC_SCOPE("batch.command");
+    vector<string> args = tokenize(line);
+    if (args.empty()) return;
+    const string& command = args[0];
+    if (command == "city") cityCommand(args);
+    else if (command == "driver") driverCommand(args);
+    else if (command == "fine") fineCommand(args);
+    else if (command == "violation") violationCommand(args);
+    else if (command == "report") reportCommand(args);
+    else if (command == "import") importCommand(args);
+    else if (command == "merge") {
+        need(args, 2, "merge <suffix> [suffix...]");
+        MergeEngine::Report report = db.mergeExternal(vector<string>(args.begin() + 1, args.end()));
+        size_t rejected = 0, invalid = 0;
+        for (const auto& s : report.sources) {
+            rejected += s.rejectedViolations;
+            invalid += s.invalidIds;
+        }
+        out << "merged: " << report.mutations() << " change(s)";
+        if (rejected) out << ", rejected " << rejected << " violation(s)";
+        if (invalid) out << ", skipped " << invalid << " row(s) with invalid IDs";
+        out << "\n";
+    }
+    else if (command == "query") {
+        // Текст запроса — остаток строки как есть, без разбора кавычек
+        size_t start = line.find("query") + 5;
+        QueryResult result = db.runQuery(line.substr(start));
+        if (result.explainOnly) {
+            out << result.plan;
+            return;
+        }
+        vector<vector<string>> table;
+        table.push_back(result.columns);
+        table.insert(table.end(), result.rows.begin(), result.rows.end());
+        printTable(table, result.rows.size());
+    }
+    else {
+        throw invalid_argument("Unknown command: " + command);
+    }
+}
+
+void BatchRunner::cityCommand(const vector<string>& args) {
+    need(args, 3, "city add|update|delete \"Name\" ...");
+    CityTable& cities = db.getCities();
+    const string& verb = args[1];
+    const string& name = args[2];
+    if (verb == "add") {
+        need(args, 6, "city add \"Name\" <population> <grade> <type>");
+        if (cities.getCityIdByName(name) != -1) throw invalid_argument("City already exists");
+        db.addCity(name, toInt(args[3]),
+            toEnum(args[4], CityTable::populationGradeToString, "grade"),
+            toEnum(args[5], CityTable::settlementTypeToString, "type"));
+        return;
+    }
+    int id = cities.getCityIdByName(name);
+    if (id == -1) throw invalid_argument("City not found");
+    if (verb == "delete") {
+        db.deleteCity(name);
+        return;
+    }
+    if (verb != "update") throw invalid_argument("Unknown city command: " + verb);
+    need(args, 5, "city update \"Name\" name|population|grade|type <value>");
+    const string& field = args[3];
+    const string& value = args[4];
+    bool ok;
+    if (field == "name") ok = cities.updateCityName(id, value);
+    else if (field == "population") ok = cities.updateCityPopulation(id, toInt(value));
+    else if (field == "grade") ok = cities.updateCityGrade(id, toEnum(value, CityTable::populationGradeToString, "grade"));
+    else if (field == "type") ok = cities.updateCityType(id, toEnum(value, CityTable::settlementTypeToString, "type"));
+    else throw invalid_argument("Unknown city field: " + field);
+    if (!ok) throw invalid_argument("Update failed");
+    db.commit();
+}
+
+void BatchRunner::driverCommand(const vector<string>& args) {
+    need(args, 3, "driver add|update|delete ...");
+    const string& verb = args[1];
+    if (verb == "add") {
+        need(args, 5, "driver add \"Full Name\" <DD.MM.YYYY> \"City\"");
+        db.addDriver(args[2], args[3], args[4]);
+        return;
+    }
+    int id = toInt(args[2]);
+    if (verb == "delete") {
+        db.deleteDriverById(id);
+        return;
+    }
+    if (verb != "update") throw invalid_argument("Unknown driver command: " + verb);
+    need(args, 5, "driver update <id> name|birth|city <value>");
+    DriverTable& drivers = db.getDrivers();
+    const string& field = args[3];
+    const string& value = args[4];
+    bool ok;
+    if (field == "name") ok = drivers.updateDriverName(id, value);
+    else if (field == "birth") ok = drivers.updateDriverBirthDate(id, value);
+    else if (field == "city") {
+        int cityId = db.getCities().getCityIdByName(value);
+        if (cityId == -1) throw invalid_argument("City not found");
+        ok = drivers.updateDriverCity(id, cityId);
+        // Как в меню: нарушения водителя переходят в новый город
+        if (ok) db.getRegistry().updateViolationsCity(id, cityId);
+    }
+    else throw invalid_argument("Unknown driver field: " + field);
+    if (!ok) throw invalid_argument("Update failed");
+    db.commit();
+}
+
+void BatchRunner::fineCommand(const vector<string>& args) {
+    need(args, 3, "fine add|update|delete \"Type\" ...");
+    FineTable& fines = db.getFines();
+    const string& verb = args[1];
+    const string& type = args[2];
+    if (verb == "add") {
+        need(args, 4, "fine add \"Type\" <amount> [severity]");
+        FineTable::Severity severity = args.size() > 4
+            ? toEnum(args[4], FineTable::severityToString, "severity") : FineTable::Severity::LIGHT;
+        db.addFine(type, toDouble(args[3]), severity);
+        return;
+    }
+    if (verb == "delete") {
+        db.deleteFine(type);
+        return;
+    }
+    if (verb != "update") throw invalid_argument("Unknown fine command: " + verb);
+    need(args, 5, "fine update \"Type\" type|amount|severity <value>");
+    int id = fines.getFineIdByType(type);
+    if (id == -1) throw invalid_argument("Fine not found");
+    const string& field = args[3];
+    const string& value = args[4];
+    if (field == "amount") {
+        if (!db.updateFineAmount(id, toDouble(value))) throw invalid_argument("Update failed");
+        return;
+    }
+    bool ok;
+    if (field == "type") ok = fines.updateFineType(id, value);
+    else if (field == "severity") ok = fines.updateFineSeverity(id, toEnum(value, FineTable::severityToString, "severity"));
+    else throw invalid_argument("Unknown fine field: " + field);
+    if (!ok) throw invalid_argument("Update failed");
+    db.commit();
+}
+
+void BatchRunner::violationCommand(const vector<string>& args) {
+    need(args, 3, "violation add|pay|update|delete ...");
+    FineRegistry& registry = db.getRegistry();
+    const string& verb = args[1];
+    if (verb == "add") {
+        need(args, 5, "violation add \"Driver Name\" \"Fine Type\" <DD.MM.YYYY> [<birth date> [\"City\"]]");
+        checkDate(args[4]);
+        DriverTable& drivers = db.getDrivers();
+        int cityId = -1;
+        if (args.size() > 6) {
+            cityId = db.getCities().getCityIdByName(args[6]);
+            if (cityId == -1) throw invalid_argument("City not found");
+        }
+        int driverId = drivers.getDriverId(args[2], args.size() > 5 ? args[5] : "", cityId);
+        DriverTable::DriverInfo driver;
+        if (driverId == -1 || !drivers.getDriverById(driverId, driver)) {
+            throw invalid_argument(drivers.findAllByName(args[2]).empty() ? "Driver not found"
+                : "Several drivers with that name: add birth date and city");
+        }
+        int fineId = db.getFines().getFineIdByType(args[3]);
+        if (fineId == -1) throw invalid_argument("Fine not found");
+        registry.addViolation(driverId, driver.cityId, fineId, args[4]);
+        db.commit();
+        return;
+    }
+    int recordId = toInt(args[2]);
+    FineRegistry::ViolationInfo current;
+    if (!registry.findViolation(recordId, current)) throw invalid_argument("Violation not found");
+    if (verb == "pay") {
+        db.markFineAsPaid(recordId);
+        return;
+    }
+    if (verb == "delete") {
+        registry.deleteViolation(recordId);
+        db.commit();
+        return;
+    }
+    if (verb != "update") throw invalid_argument("Unknown violation command: " + verb);
+    need(args, 5, "violation update <recordId> date|paid|fine <value>");
+    const string& field = args[3];
+    const string& value = args[4];
+    if (field == "date") {
+        checkDate(value);
+        registry.updateViolationDate(recordId, value);
+    }
+    else if (field == "paid") {
+        registry.updateViolationPaid(recordId, toInt(value) != 0);
+    }
+    else if (field == "fine") {
+        int fineId = db.getFines().getFineIdByType(value);
+        if (fineId == -1) throw invalid_argument("Fine not found");
+        registry.updateViolationFine(recordId, fineId);
+    }
+    else {
+        throw invalid_argument("Unknown violation field: " + field);
+    }
+    db.commit();
+}
+
+void BatchRunner::reportCommand(const vector<string>& args) {
+    need(args, 2, "report groupby|series|debtors ...");
+    const string& kind = args[1];
+    if (kind == "groupby") {
+        GroupByEngine::Spec spec = GroupByEngine::parseSpec(args.size() > 2 ? args[2] : "",
+            args.size() > 3 ? args[3] : "");
+        if (args.size() > 4) spec.limit = static_cast<size_t>(max(0, toInt(args[4])));
+        GroupByEngine::Result result = db.groupViolations(spec);
+        printTable(result.table, result.groups.size());
+    }
+    else if (kind == "series") {
+        need(args, 5, "report series day|month|year <from> <to> [\"City\"]");
+        ViolationRollup::Granularity granularity;
+        if (args[2] == "day") granularity = ViolationRollup::Granularity::DAY;
+        else if (args[2] == "month") granularity = ViolationRollup::Granularity::MONTH;
+        else if (args[2] == "year") granularity = ViolationRollup::Granularity::YEAR;
+        else throw invalid_argument("Unknown granularity: " + args[2]);
+        int bounds[2] = { 0, 99991231 };
+        for (int i = 0; i < 2; ++i) {
+            if (args[3 + i] == "*") continue;
+            bounds[i] = FineRegistry::dateKey(args[3 + i]);
+            if (bounds[i] == 0) throw invalid_argument("Invalid date format: " + args[3 + i]);
+        }
+        auto points = db.violationSeries(granularity, bounds[0], bounds[1], args.size() > 5 ? args[5] : "");
+        vector<vector<string>> table;
+        table.push_back({ "Period", "City", "Severity", "Violations", "Paid", "Billed", "Revenue" });
+        for (const auto& p : points) {
+            CityTable::CityInfo city;
+            string cityLabel = db.getCities().getCityById(p.cityId, city) ? string(city.name) : "-";
+            string severity = p.severity < 0 ? "-"
+                : FineTable::severityToString(static_cast<FineTable::Severity>(p.severity));
+            table.push_back({ to_string(p.bucket), cityLabel, severity, to_string(p.count), to_string(p.paid),
+                money(p.billed), money(p.revenue) });
+        }
+        printTable(table, points.size());
+    }
+    else if (kind == "debtors") {
+        double minBalance = args.size() > 2 ? toDouble(args[2]) : 0;
+        int limit = args.size() > 3 ? toInt(args[3]) : 0;
+        auto list = db.debtors(minBalance, limit > 0 ? static_cast<size_t>(limit) : 0);
+        vector<vector<string>> table;
+        table.push_back({ "Driver ID", "Driver", "Unpaid", "Outstanding" });
+        for (const auto& debt : list) {
+            string_view name = db.getDrivers().getDriverNameById(debt.driverId);
+            table.push_back({ to_string(debt.driverId), name.empty() ? "-" : string(name),
+                to_string(debt.unpaid), money(debt.balance()) });
+        }
+        printTable(table, list.size());
+    }
+    else {
+        throw invalid_argument("Unknown report: " + kind);
+    }
+}
+
+void BatchRunner::importCommand(const vector<string>& args) {
+    need(args, 3, "import violations|drivers <path>");
+    BulkImport::Report report;
+    if (args[1] == "violations") report = db.importViolations(args[2]);
+    else if (args[1] == "drivers") report = db.importDrivers(args[2]);
+    else throw invalid_argument("Unknown import: " + args[1]);
+    out << "imported " << report.inserted << " of " << report.rowsRead << " row(s), duplicates "
+        << report.duplicates << ", rejected " << report.rejected << "\n";
+    for (const string& error : report.errors) err << "  " << error << "\n";
+}
+
+void BatchRunner::printTable(const vector<vector<string>>& table, size_t rows) {
+    out << TableFormatter::format(table);
+    out << "(" << rows << " rows)\n";
+}
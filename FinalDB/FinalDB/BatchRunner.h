@@ -0,0 +1,67 @@
+#pragma once
+#include "DatabaseManager.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Пакетный режим: сценарий команд без меню, подсказок и листингов.
+// Одна команда на строку, слова через пробел, значения с пробелами —
+// в двойных кавычках, строки с '#' — комментарии:
+//   city add "Name" <population> <Small|Medium|Large> <City|Town|Village>
+//   city update "Name" name|population|grade|type <value>
+//   city delete "Name"
+//   driver add "Full Name" <DD.MM.YYYY> "City"
+//   driver update <id> name|birth|city <value>
+//   driver delete <id>
+//   fine add "Type" <amount> [Light|Medium|Heavy]
+//   fine update "Type" type|amount|severity <value>
+//   fine delete "Type"
+//   violation add "Driver Name" "Fine Type" <DD.MM.YYYY> [<birth date> ["City"]]
+//     (дата рождения и город водителя — для полных тёзок, как в меню)
+//   violation pay <recordId>
+//   violation update <recordId> date|paid|fine <value>
+//   violation delete <recordId>
+//   import violations|drivers <path>
+//   merge <suffix> [suffix...]
+//   query <текст запроса до конца строки>
+//   report groupby "<dims>" ["<measures>"] [limit]
+//   report series day|month|year <from> <to> ["City"]   (DD.MM.YYYY или *)
+//   report debtors [minBalance] [limit]
+// Изменения на диск пишутся один раз, в конце сценария.
+class BatchRunner {
+public:
+    struct Report {
+        size_t commands = 0;
+        size_t failed = 0;
+        double runMs = 0;        // выполнение команд
+        double saveMs = 0;       // запись на диск в конце
+    };
+
+    // Результаты query/report — в out, ошибки "line N: Error: ..." — в err
+    BatchRunner(DatabaseManager& db, std::ostream& out, std::ostream& err);
+
+    // Ошибка в строке не останавливает сценарий
+    Report run(std::istream& script);
+
+    // Одна команда; ошибка → invalid_argument
+    void execute(const std::string& line);
+
+    // Слова строки с учётом кавычек
+    static std::vector<std::string> tokenize(const std::string& line);
+
+private:
+    void cityCommand(const std::vector<std::string>& args);
+    void driverCommand(const std::vector<std::string>& args);
+    void fineCommand(const std::vector<std::string>& args);
+    void violationCommand(const std::vector<std::string>& args);
+    void reportCommand(const std::vector<std::string>& args);
+    void importCommand(const std::vector<std::string>& args);
+    void printTable(const std::vector<std::vector<std::string>>& table, size_t rows);
+
+    DatabaseManager& db;
+    std::ostream& out;
+    std::ostream& err;
+};
@@ -0,0 +1,143 @@
+#include "BloomFilter.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+// "FDBBLOOM"; заголовок: метка, stamp, capacity, keys, число слов
+static const uint64_t MAGIC = 0x4d4f4f4c42424446ull;
+static const size_t HEADER_WORDS = 5;
+
+uint64_t BloomFilter::mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+void BloomFilter::reset(size_t capacity) {
+    size_t blocks = 1;
+    while (blocks * BLOCK_WORDS * 64 < capacity * BITS_PER_KEY) blocks *= 2;
+    words.assign(blocks * BLOCK_WORDS, 0);
+    blockMask = blocks - 1;
+    keys = 0;
+    this->capacity = capacity;
+    dirtyPages.clear();
+    wholeDirty = true;
+}
+
+void BloomFilter::clear() {
+    words.clear();
+    words.shrink_to_fit();
+    blockMask = 0;
+    keys = capacity = 0;
+    dirtyPages.clear();
+    wholeDirty = true;
+}
+
+// Младшие биты хеша выбирают блок, перемешанный хеш — 7 позиций по 9 бит
+bool BloomFilter::insert(uint64_t hash) {
+    if (words.empty()) return false;
+    size_t first = static_cast<size_t>(hash & blockMask) * BLOCK_WORDS;
+    uint64_t* block = &words[first];
+    uint64_t bits = mix(hash);
+    bool added = false;
+    for (int i = 0; i < HASHES; ++i, bits >>= 9) {
+        uint64_t mask = 1ull << (bits & 63);
+        uint64_t& word = block[(bits >> 6) & (BLOCK_WORDS - 1)];
+        if (!(word & mask)) {
+            word |= mask;
+            added = true;
+        }
+    }
+    if (added) {
+        ++keys;
+        dirtyPages.insert(first / PAGE_WORDS);
+    }
+    return added;
+}
+
+bool BloomFilter::mayContain(uint64_t hash) const {
+    if (words.empty()) return true;
+    const uint64_t* block = &words[static_cast<size_t>(hash & blockMask) * BLOCK_WORDS];
+    uint64_t bits = mix(hash);
+    for (int i = 0; i < HASHES; ++i, bits >>= 9) {
+        if (!(block[(bits >> 6) & (BLOCK_WORDS - 1)] & (1ull << (bits & 63)))) return false;
+    }
+    return true;
+}
+
+// Заголовок пишется последним: оборванная запись не пройдёт проверку
+// отметки при загрузке, и фильтр просто перестроят
+bool BloomFilter::save(const string& filename, uint64_t stamp) const {
+    bool whole = wholeDirty || savedName != filename;
+    fstream file;
+    if (!whole) {
+        file.open(filename, ios::in | ios::out | ios::binary);
+        whole = !file.is_open();
+    }
+    if (whole) {
+        file.close();
+        file.clear();
+        file.open(filename, ios::out | ios::binary | ios::trunc);
+    }
+    if (!file.is_open()) {
+        cerr << "Error opening filter file for writing: " << filename << "\n";
+        return false;
+    }
+    uint64_t header[HEADER_WORDS] = { 0, stamp, capacity, keys, words.size() };
+    const size_t headerBytes = sizeof(header);
+    if (whole) {
+        file.write(reinterpret_cast<const char*>(header), headerBytes);
+        file.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+    }
+    else {
+        for (size_t page : dirtyPages) {
+            size_t first = page * PAGE_WORDS;
+            size_t count = words.size() - first;
+            if (count > PAGE_WORDS) count = PAGE_WORDS;
+            file.seekp(static_cast<streamoff>(headerBytes + first * sizeof(uint64_t)));
+            file.write(reinterpret_cast<const char*>(&words[first]), count * sizeof(uint64_t));
+        }
+    }
+    header[0] = MAGIC;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(header), headerBytes);
+    file.close();
+    if (!file) {
+        cerr << "Error writing filter file: " << filename << "\n";
+        wholeDirty = true;
+        return false;
+    }
+    dirtyPages.clear();
+    wholeDirty = false;
+    savedName = filename;
+    return true;
+}
+
+bool BloomFilter::load(const string& filename, uint64_t stamp) {
+    ifstream file(filename, ios::binary | ios::ate);
+    if (!file.is_open()) return false;
+    uint64_t fileBytes = static_cast<uint64_t>(file.tellg());
+    uint64_t header[HEADER_WORDS];
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) return false;
+    if (header[0] != MAGIC || header[1] != stamp) return false;
+    uint64_t count = header[4];
+    uint64_t blocks = count / BLOCK_WORDS;
+    if (blocks == 0 || count % BLOCK_WORDS != 0 || (blocks & (blocks - 1)) != 0
+        || fileBytes != sizeof(header) + count * sizeof(uint64_t))
+        return false;
+    vector<uint64_t> loaded(static_cast<size_t>(count));
+    if (!file.read(reinterpret_cast<char*>(loaded.data()), loaded.size() * sizeof(uint64_t))) return false;
+    words.swap(loaded);
+    blockMask = static_cast<size_t>(blocks - 1);
+    capacity = static_cast<size_t>(header[2]);
+    keys = static_cast<size_t>(header[3]);
+    dirtyPages.clear();
+    wholeDirty = false;
+    savedName = filename;
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+// Блочный фильтр Блума по 64-битным хешам ключей: все биты ключа лежат
+// в одном блоке 64 байта (одна строка кэша), поэтому проверка — один
+// промах кэша. Ответ "нет" точен, "может быть" надо проверять по данным.
+// Удаление не поддерживается: биты удалённых ключей остаются и дают
+// только лишние точные проверки, пока фильтр не перестроят.
+// Фильтр без битов (после clear) ничего не исключает.
+// Файл: заголовок с отметкой владельца (stamp), затем биты страницами
+// по 4 КБ; сохраняются только страницы с новыми битами и заголовок.
+class BloomFilter {
+public:
+    static const size_t BITS_PER_KEY = 10;   // ~1% ложных "может быть"
+    static const int HASHES = 7;
+
+    // Пустые биты под capacity ключей
+    void reset(size_t capacity);
+    void clear();
+    bool ready() const { return !words.empty(); }
+
+    // true — появился хотя бы один новый бит (ключа, скорее всего, не было)
+    bool insert(uint64_t hash);
+    bool mayContain(uint64_t hash) const;
+
+    // Ключей больше, чем рассчитан фильтр: пора перестроить с запасом
+    bool overfull() const { return keys > capacity; }
+    size_t keyCount() const { return keys; }
+    size_t capacityKeys() const { return capacity; }
+    size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+    // stamp — отпечаток данных, по которым построен фильтр;
+    // load возвращает false (и не меняет фильтр), если файла нет,
+    // он повреждён или отметка не совпала
+    bool save(const std::string& filename, uint64_t stamp) const;
+    bool load(const std::string& filename, uint64_t stamp);
+
+    // Перемешивание битов (splitmix64) для построения хешей ключей
+    static uint64_t mix(uint64_t x);
+
+private:
+    static const size_t BLOCK_WORDS = 8;     // 512 бит
+    static const size_t PAGE_WORDS = 512;    // 4 КБ файла
+
+    std::vector<uint64_t> words;
+    size_t blockMask = 0;                    // блоков — степень двойки
+    size_t keys = 0;
+    size_t capacity = 0;
+
+    // Что ещё не записано в файл savedName
+    mutable std::set<size_t> dirtyPages;
+    mutable bool wholeDirty = true;
+    mutable std::string savedName;
+};
@@ -0,0 +1,245 @@
+#include "BulkImport.h"
+#include "ThreadPool.h"
+#include "Validation.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+using namespace std;
+
+void BulkImport::splitRow(string_view line, char delimiter, vector<string>& fields) {
+    fields.clear();
+    size_t i = 0, n = line.size();
+    while (true) {
+        string field;
+        while (i < n && line[i] == ' ') ++i;
+        if (i < n && line[i] == '"') {
+            ++i;
+            while (i < n) {
+                if (line[i] == '"') {
+                    if (i + 1 < n && line[i + 1] == '"') {
+                        field += '"';
+                        i += 2;
+                        continue;
+                    }
+                    ++i;
+                    break;
+                }
+                field += line[i++];
+            }
+            while (i < n && line[i] != delimiter) ++i;   // хвост после кавычки не нужен
+        }
+        else {
+            size_t start = i;
+            while (i < n && line[i] != delimiter) ++i;
+            size_t end = i;
+            while (end > start && line[end - 1] == ' ') --end;
+            field.assign(line.substr(start, end - start));
+        }
+        fields.push_back(move(field));
+        if (i >= n) break;
+        ++i;   // разделитель
+    }
+}
+
+static string toLower(string s) {
+    for (char& c : s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+// "", 0/1, yes/no, true/false
+static bool parseFlag(const string& text, bool& value) {
+    string s = toLower(text);
+    if (s.empty() || s == "0" || s == "no" || s == "false") { value = false; return true; }
+    if (s == "1" || s == "yes" || s == "true") { value = true; return true; }
+    return false;
+}
+
+// Общий цикл импорта. Row — разобранная строка с полем error;
+// parse(строка, разделитель, поля, row) выполняется на пуле,
+// insert(row) — в вызывающем потоке и возвращает текст ошибки или "".
+template <class Row, class Parse, class Insert>
+static BulkImport::Report runImport(const string& path, const char* headerColumn,
+    Parse parse, Insert insert)
+{
+    ifstream file(path);
+    if (!file.is_open()) {
+        throw invalid_argument("Cannot open import file: " + path);
+    }
+    bool tsv = path.size() >= 4 && toLower(path.substr(path.size() - 4)) == ".tsv";
+    char delimiter = tsv ? '\t' : ',';
+
+    BulkImport::Report report;
+    auto reject = [&report](size_t lineNo, const string& reason) {
+        ++report.rejected;
+        if (report.errors.size() < BulkImport::MAX_ERRORS)
+            report.errors.push_back("line " + to_string(lineNo) + ": " + reason);
+    };
+
+    ThreadPool pool;
+    vector<string> lines;
+    vector<size_t> lineNumbers;
+    vector<Row> rows;
+    size_t lineNo = 0;
+    bool firstLine = true;
+    string line;
+    while (true) {
+        lines.clear();
+        lineNumbers.clear();
+        while (lines.size() < BulkImport::CHUNK_ROWS && getline(file, line)) {
+            ++lineNo;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.find_first_not_of(" \t") == string::npos) continue;
+            if (firstLine) {
+                firstLine = false;
+                if (line.find('\t') != string::npos) delimiter = '\t';
+                vector<string> fields;
+                BulkImport::splitRow(line, delimiter, fields);
+                if (toLower(fields[0]) == headerColumn) continue;
+            }
+            lines.push_back(move(line));
+            lineNumbers.push_back(lineNo);
+        }
+        if (lines.empty()) break;
+
+        rows.assign(lines.size(), Row());
+        pool.parallelFor(lines.size(), [&](size_t begin, size_t end) {
+            vector<string> fields;
+            for (size_t i = begin; i < end; ++i) parse(lines[i], delimiter, fields, rows[i]);
+        });
+
+        for (size_t i = 0; i < rows.size(); ++i) {
+            ++report.rowsRead;
+            string error = rows[i].error.empty() ? insert(rows[i]) : rows[i].error;
+            if (error.empty()) ++report.inserted;
+            else reject(lineNumbers[i], error);
+        }
+    }
+    return report;
+}
+
+namespace {
+    struct ViolationRow {
+        string driver, fine, date, birthDate;
+        bool paid = false;
+        string error;
+    };
+
+    struct DriverRow {
+        string name, birthDate, city;
+        string error;
+    };
+
+    struct DriverRef {
+        int id;
+        int cityId;
+    };
+}
+
+BulkImport::Report BulkImport::importViolations(const string& path, const DriverTable& drivers,
+    const FineTable& fines, FineRegistry& registry)
+{
+    auto parse = [](const string& line, char delimiter, vector<string>& fields, ViolationRow& row) {
+        splitRow(line, delimiter, fields);
+        if (fields.size() < 3) {
+            row.error = "expected driver, fine, date";
+            return;
+        }
+        row.driver = move(fields[0]);
+        row.fine = move(fields[1]);
+        row.date = move(fields[2]);
+        if (row.driver.empty() || row.fine.empty()) {
+            row.error = "empty driver or fine";
+        }
+        else if (!Validation::isDate(row.date)) {
+            row.error = "invalid date '" + row.date + "'";
+        }
+        else if (fields.size() > 3 && !parseFlag(fields[3], row.paid)) {
+            row.error = "invalid paid flag '" + fields[3] + "'";
+        }
+        else if (fields.size() > 4 && !fields[4].empty()) {
+            row.birthDate = move(fields[4]);
+            if (!Validation::isDate(row.birthDate))
+                row.error = "invalid birth date '" + row.birthDate + "'";
+        }
+    };
+
+    // Кэши на весь импорт: каждое ФИО и тип штрафа ищутся в таблицах один раз
+    unordered_map<string, DriverRef> driverCache;
+    unordered_map<string, int> fineCache;
+    size_t duplicates = 0, paidDuplicates = 0;
+    FineRegistry::ViolationInfo existing;
+    auto insert = [&](const ViolationRow& row) -> string {
+        string key = row.driver;
+        key += '\t';
+        key += row.birthDate;
+        auto driver = driverCache.find(key);
+        if (driver == driverCache.end()) {
+            DriverRef ref{ drivers.getDriverId(row.driver, row.birthDate), -1 };
+            DriverTable::DriverInfo info;
+            if (ref.id != -1 && drivers.getDriverById(ref.id, info)) ref.cityId = info.cityId;
+            driver = driverCache.emplace(move(key), ref).first;
+        }
+        if (driver->second.id == -1) return "unknown or ambiguous driver '" + row.driver + "'";
+
+        auto fine = fineCache.find(row.fine);
+        if (fine == fineCache.end())
+            fine = fineCache.emplace(row.fine, fines.getFineIdByType(row.fine)).first;
+        if (fine->second == -1) return "unknown fine '" + row.fine + "'";
+
+        int recordId = registry.findIdentical(driver->second.id, driver->second.cityId, fine->second, row.date);
+        if (recordId != 0) {
+            // Повтор меняет реестр, только если неоплаченная запись стала оплаченной
+            ++duplicates;
+            if (row.paid && registry.findViolation(recordId, existing) && !existing.paid) {
+                registry.markAsPaid(recordId);
+                ++paidDuplicates;
+            }
+            return string();
+        }
+        recordId = registry.addViolation(driver->second.id, driver->second.cityId, fine->second, row.date);
+        if (row.paid) registry.markAsPaid(recordId);
+        return string();
+    };
+    Report report = runImport<ViolationRow>(path, "driver", parse, insert);
+    // Повторы прошли через insert без ошибки, но новых записей не дали
+    report.inserted -= duplicates;
+    report.duplicates = duplicates;
+    report.paidDuplicates = paidDuplicates;
+    return report;
+}
+
+BulkImport::Report BulkImport::importDrivers(const string& path, const CityTable& cities,
+    DriverTable& drivers)
+{
+    // Текущая дата для проверки возраста — одна на весь импорт
+    Validation::Date today = Validation::today();
+    auto parse = [today](const string& line, char delimiter, vector<string>& fields, DriverRow& row) {
+        splitRow(line, delimiter, fields);
+        if (fields.size() < 3) {
+            row.error = "expected name, birth_date, city";
+            return;
+        }
+        row.name = move(fields[0]);
+        row.birthDate = move(fields[1]);
+        row.city = move(fields[2]);
+        if (!Validation::isName(row.name))
+            row.error = "invalid characters in name '" + row.name + "'";
+        else if (!Validation::isDate(row.birthDate))
+            row.error = "invalid birth date '" + row.birthDate + "'";
+        else if (!Validation::isDriverAge(row.birthDate, today))
+            row.error = "driver must be between 18 and 100 years old";
+    };
+
+    unordered_map<string, int> cityCache;
+    auto insert = [&](const DriverRow& row) -> string {
+        auto city = cityCache.find(row.city);
+        if (city == cityCache.end())
+            city = cityCache.emplace(row.city, cities.getCityIdByName(row.city)).first;
+        if (city->second == -1) return "unknown city '" + row.city + "'";
+        drivers.insertDriver(row.name, row.birthDate, city->second);
+        return string();
+    };
+    return runImport<DriverRow>(path, "name", parse, insert);
+}
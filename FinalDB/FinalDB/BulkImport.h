@@ -0,0 +1,46 @@
+#pragma once
+#include "CityTable.h"
+#include "DriverTable.h"
+#include "FineTable.h"
+#include "FineRegistry.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Пакетный импорт нарушений и водителей из CSV/TSV.
+// Файл читается кусками по CHUNK_ROWS строк: разбор и проверка строк
+// куска идут на пуле потоков, разрешение имён (кэш ФИО/типов на весь
+// импорт) и вставка — в вызывающем потоке. В памяти только один кусок,
+// так что размер файла памятью не ограничен.
+// Разделитель — табуляция для .tsv или если она есть в первой строке,
+// иначе запятая. Первая строка с названиями колонок пропускается.
+//   нарушения: driver, fine, date[, paid[, birth_date]]
+//     (нарушение, уже записанное в реестре, не дублируется — как при
+//     слиянии, обновляется только оплата)
+//   водители:  name, birth_date, city
+// Строки с ошибками пропускаются и попадают в отчёт; запись на диск —
+// забота вызывающего (один commit на весь файл).
+class BulkImport {
+public:
+    static const size_t CHUNK_ROWS = 65536;
+    static const size_t MAX_ERRORS = 20;   // в отчёт попадают первые ошибки
+
+    struct Report {
+        size_t rowsRead = 0;
+        size_t inserted = 0;
+        size_t duplicates = 0;          // уже были в реестре
+        size_t paidDuplicates = 0;      // из них впервые отмечены оплаченными
+        size_t rejected = 0;
+        std::vector<std::string> errors;   // "line N: причина"
+    };
+
+    // Бросают invalid_argument, если файл не открывается
+    static Report importViolations(const std::string& path, const DriverTable& drivers,
+        const FineTable& fines, FineRegistry& registry);
+    static Report importDrivers(const std::string& path, const CityTable& cities,
+        DriverTable& drivers);
+
+    // Разбор строки: поля в кавычках, "" внутри кавычек — одна кавычка
+    static void splitRow(std::string_view line, char delimiter, std::vector<std::string>& fields);
+};
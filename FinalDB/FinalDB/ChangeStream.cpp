@@ -0,0 +1,181 @@
+#include "ChangeStream.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+
+const char* opName(ChangeOp op) {
+    switch (op) {
+    case ChangeOp::INSERTED: return "insert";
+    case ChangeOp::UPDATED:  return "update";
+    case ChangeOp::DELETED:  return "delete";
+    }
+    return "?";
+}
+
+void writeImage(ostream& out, const ChangeEvent::Image& image) {
+    if (auto c = get_if<CityTable::CityInfo>(&image)) {
+        out << "{id=" << c->id << " name=" << quoted(string(c->name)) << " population=" << c->population
+            << " grade=" << CityTable::populationGradeToString(c->grade)
+            << " type=" << CityTable::settlementTypeToString(c->type) << "}";
+    }
+    else if (auto d = get_if<DriverTable::DriverInfo>(&image)) {
+        out << "{id=" << d->id << " name=" << quoted(string(d->fullName))
+            << " birth=" << d->birthDate << " city=" << d->cityId << "}";
+    }
+    else if (auto f = get_if<FineTable::FineInfo>(&image)) {
+        out << "{id=" << f->id << " type=" << quoted(string(f->type)) << " amount=" << f->amount
+            << " severity=" << FineTable::severityToString(f->severity) << "}";
+    }
+    else if (auto v = get_if<FineRegistry::ViolationInfo>(&image)) {
+        out << "{id=" << v->recordId << " driver=" << v->driverId << " city=" << v->cityId
+            << " fine=" << v->fineId << " paid=" << (v->paid ? 1 : 0) << " date=" << v->date << "}";
+    }
+    else {
+        out << "-";
+    }
+}
+
+} // namespace
+
+const char* ChangeEvent::tableName() const {
+    switch (before.index() ? before.index() : after.index()) {
+    case 1: return "cities";
+    case 2: return "drivers";
+    case 3: return "fines";
+    case 4: return "violations";
+    }
+    return "?";
+}
+
+int ChangeEvent::rowId() const {
+    const Image& image = before.index() ? before : after;
+    if (auto c = get_if<CityTable::CityInfo>(&image)) return c->id;
+    if (auto d = get_if<DriverTable::DriverInfo>(&image)) return d->id;
+    if (auto f = get_if<FineTable::FineInfo>(&image)) return f->id;
+    if (auto v = get_if<FineRegistry::ViolationInfo>(&image)) return v->recordId;
+    return -1;
+}
+
+ChangeStream::ChangeStream(size_t capacity)
+    : ring(max<size_t>(capacity, 1)),
+    worker(&ChangeStream::run, this) {
+}
+
+ChangeStream::~ChangeStream() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    hasEvents.notify_one();
+    worker.join();
+}
+
+int ChangeStream::subscribe(Consumer consumer) {
+    lock_guard<std::mutex> lock(consumersMutex);
+    int id = nextSubscription++;
+    consumers.push_back({ id, move(consumer) });
+    consumerCount.store(static_cast<int>(consumers.size()), memory_order_relaxed);
+    return id;
+}
+
+// После возврата подписчик больше не вызывается
+void ChangeStream::unsubscribe(int id) {
+    lock_guard<std::mutex> lock(consumersMutex);
+    consumers.erase(remove_if(consumers.begin(), consumers.end(),
+        [id](const Subscription& s) { return s.id == id; }), consumers.end());
+    consumerCount.store(static_cast<int>(consumers.size()), memory_order_relaxed);
+}
+
+void ChangeStream::emit(ChangeOp op, const ChangeEvent::Image& before, const ChangeEvent::Image& after) {
+    unique_lock<std::mutex> lock(mutex);
+    if (emitted - taken >= ring.size()) {
+        FINALDB_METRIC_SCOPE("cdc.bufferFull");
+        hasRoom.wait(lock, [this] { return emitted - taken < ring.size(); });
+    }
+    ChangeEvent& event = ring[emitted % ring.size()];
+    event.sequence = ++emitted;
+    event.op = op;
+    event.before = before;
+    event.after = after;
+    // Поток доставки спит, только когда буфер был пуст
+    bool wake = emitted - taken == 1;
+    lock.unlock();
+    if (wake) hasEvents.notify_one();
+}
+
+void ChangeStream::flush() {
+    unique_lock<std::mutex> lock(mutex);
+    uint64_t target = emitted;
+    hasRoom.wait(lock, [&] { return delivered >= target; });
+}
+
+uint64_t ChangeStream::getEmitted() const {
+    lock_guard<std::mutex> lock(mutex);
+    return emitted;
+}
+
+uint64_t ChangeStream::getDelivered() const {
+    lock_guard<std::mutex> lock(mutex);
+    return delivered;
+}
+
+// Пачка — всё, что накопилось в буфере; слоты освобождаются сразу
+// после копирования, до вызова подписчиков
+void ChangeStream::run() {
+    vector<ChangeEvent> batch;
+    batch.reserve(ring.size());
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        hasEvents.wait(lock, [this] { return stopping || emitted > taken; });
+        if (emitted == taken) break;   // остановка, всё доставлено
+        batch.clear();
+        for (uint64_t seq = taken + 1; seq <= emitted; ++seq)
+            batch.push_back(ring[(seq - 1) % ring.size()]);
+        taken = emitted;
+        lock.unlock();
+        hasRoom.notify_all();
+        {
+            FINALDB_METRIC_SCOPE("cdc.deliver");
+            FINALDB_METRIC_ROWS(batch.size(), batch.size());
+            lock_guard<std::mutex> consumersLock(consumersMutex);
+            for (Subscription& s : consumers) {
+                try {
+                    s.consumer(batch.data(), batch.size());
+                }
+                catch (const exception& e) {
+                    cerr << "Change consumer " << s.id << " failed: " << e.what() << "\n";
+                }
+            }
+        }
+        lock.lock();
+        delivered = batch.back().sequence;
+        hasRoom.notify_all();
+    }
+}
+
+string ChangeStream::describe(const ChangeEvent& event) {
+    ostringstream oss;
+    oss << event.sequence << ' ' << opName(event.op) << ' ' << event.tableName()
+        << ' ' << event.rowId() << " before ";
+    writeImage(oss, event.before);
+    oss << " after ";
+    writeImage(oss, event.after);
+    return oss.str();
+}
+
+ChangeFileSink::ChangeFileSink(const string& path)
+    : path(path), file(path, ios::app) {
+    if (!file.is_open()) cerr << "Error opening change log for writing: " << path << "\n";
+}
+
+void ChangeFileSink::write(const ChangeEvent* events, size_t count) {
+    if (!file.is_open()) return;
+    for (size_t i = 0; i < count; ++i) file << ChangeStream::describe(events[i]) << '\n';
+    file.flush();
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "CityTable.h"
+#include "DriverTable.h"
+#include "FineTable.h"
+#include "FineRegistry.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+// Не INSERT/DELETE: DELETE — макрос в <windows.h>
+enum class ChangeOp : uint8_t { INSERTED, UPDATED, DELETED };
+
+// Событие изменения строки одной из четырёх таблиц.
+// Образ — Info-структура таблицы; её строки — view в глобальный пул,
+// который не освобождается, поэтому событие можно хранить без копий строк.
+// У вставки нет образа "до", у удаления — "после" (monostate).
+struct ChangeEvent {
+    using Image = std::variant<std::monostate, CityTable::CityInfo, DriverTable::DriverInfo,
+        FineTable::FineInfo, FineRegistry::ViolationInfo>;
+
+    uint64_t sequence = 0;           // сквозной порядок по всем таблицам, с 1
+    ChangeOp op = ChangeOp::INSERTED;
+    Image before, after;
+
+    const char* tableName() const;   // "cities", "drivers", "fines", "violations"
+    int rowId() const;               // ID города/водителя/штрафа или recordId
+};
+
+// Поток изменений (CDC): таблицы выпускают события в кольцевой буфер,
+// отдельный поток раздаёт их подписчикам пачками в порядке sequence.
+// Пока подписчиков нет, таблицы не снимают образы строк (active()).
+// Буфер без потерь: когда он полон, выпускающий поток ждёт доставки.
+// Подписчик получает события, доставленные после подписки; исключение
+// подписчика пишется в cerr и не останавливает доставку остальным.
+// Подписчик вызывается в потоке доставки и не должен менять таблицы
+// или ждать tablesMutex: выпускающий поток может ждать места в буфере.
+class ChangeStream {
+public:
+    // Подписчик получает пачку подряд идущих событий
+    using Consumer = std::function<void(const ChangeEvent* events, size_t count)>;
+
+    explicit ChangeStream(size_t capacity = 1 << 14);
+    ~ChangeStream();   // доставляет накопленное и останавливает поток
+
+    ChangeStream(const ChangeStream&) = delete;
+    ChangeStream& operator=(const ChangeStream&) = delete;
+
+    int subscribe(Consumer consumer);   // ID подписки
+    void unsubscribe(int id);
+    bool active() const { return consumerCount.load(std::memory_order_relaxed) > 0; }
+
+    void emitInsert(const ChangeEvent::Image& after) { emit(ChangeOp::INSERTED, ChangeEvent::Image(), after); }
+    void emitUpdate(const ChangeEvent::Image& before, const ChangeEvent::Image& after) {
+        emit(ChangeOp::UPDATED, before, after);
+    }
+    void emitDelete(const ChangeEvent::Image& before) { emit(ChangeOp::DELETED, before, ChangeEvent::Image()); }
+
+    // Барьер: всё выпущенное до вызова доставлено подписчикам
+    void flush();
+
+    uint64_t getEmitted() const;
+    uint64_t getDelivered() const;
+    size_t getCapacity() const { return ring.size(); }
+
+    // "seq op table id before {поля} after {поля}" — формат файлового приёмника
+    static std::string describe(const ChangeEvent& event);
+
+private:
+    void emit(ChangeOp op, const ChangeEvent::Image& before, const ChangeEvent::Image& after);
+    void run();
+
+    std::vector<ChangeEvent> ring;
+    uint64_t emitted = 0;            // sequence последнего выпущенного
+    uint64_t taken = 0;              // забрано из буфера на доставку
+    uint64_t delivered = 0;          // доставлено подписчикам
+    bool stopping = false;
+    mutable std::mutex mutex;
+    std::condition_variable hasEvents;
+    std::condition_variable hasRoom;     // и барьер flush()
+
+    struct Subscription {
+        int id;
+        Consumer consumer;
+    };
+    std::vector<Subscription> consumers;
+    std::mutex consumersMutex;           // список меняется, пока идёт доставка
+    std::atomic<int> consumerCount{ 0 };
+    int nextSubscription = 1;
+
+    std::thread worker;                  // последним: стартует после полей
+};
+
+// Приёмник: события построчно дописываются в текстовый файл
+class ChangeFileSink {
+public:
+    explicit ChangeFileSink(const std::string& path);
+    bool isOpen() const { return file.is_open(); }
+    const std::string& getPath() const { return path; }
+    // Для ChangeStream::subscribe; файл сбрасывается на диск раз в пачку
+    void write(const ChangeEvent* events, size_t count);
+
+private:
+    std::string path;
+    std::ofstream file;
+};
@@ -1,11 +1,15 @@
 #include "CityTable.h"
+#include "ChangeStream.h"
+#include "Metrics.h"
+#include "SubstringScan.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 using namespace std;
 
 CityTable::CityTable()
-    : head(new CityNode(-1, "", 0, PopulationGrade::SMALL, SettlementType::CITY, nullptr)),
+    : head(new CityNode(-1, InternedString(), 0, PopulationGrade::SMALL, SettlementType::CITY, nullptr)),
     currentFilter(nullptr),
     idWidth(5),
     nameWidth(20),
@@ -13,7 +17,6 @@ CityTable::CityTable()
     typeWidth(10),
     currentIterator(nullptr)
 {
-    loadFromFile();
     updateColumnWidths();
 }
 
@@ -54,6 +57,9 @@ bool CityTable::loadFromFile(const std::string& filename) {
     head->next = nullptr;
     idToCityMap.clear();
     nameToIdMap.clear();
+    nameSearchIndex.clear();
+    nameHeapDirty = true;
+    modified = false;
 
     std::string line;
     while (std::getline(file, line)) parseLine(line);
@@ -80,16 +86,18 @@ void CityTable::parseLine(const std::string& line) {
     addCityNode(id, name, population, grade, type);
 }
 
-void CityTable::addCityNode(int id, const std::string& name, int population,
+void CityTable::addCityNode(int id, std::string_view name, int population,
     PopulationGrade grade, SettlementType type)
 {
-    CityNode* newNode = new CityNode(id, name, population, grade, type, head->next);
+    CityNode* newNode = new CityNode(id, InternedString(name), population, grade, type, head->next);
     head->next = newNode;
     idToCityMap.insert(id, newNode);
-    nameToIdMap[name] = id;
+    nameToIdMap[newNode->name.view()] = id;
+    nameSearchIndex.insert(id, newNode->name.view());
+    nameHeapDirty = true;
 }
 
-void CityTable::addCity(const std::string& name, int population,
+void CityTable::addCity(std::string_view name, int population,
     PopulationGrade grade, SettlementType type)
 {
     int newId = 1;
@@ -97,7 +105,9 @@ void CityTable::addCity(const std::string& name, int population,
         if (pair.second >= newId) newId = pair.second + 1;
     }
     addCityNode(newId, name, population, grade, type);
+    modified = true;
     updateColumnWidths();
+    if (capturing()) changes->emitInsert(cloneInfo(idToCityMap.find<CityNode>(newId)));
 }
 
 void CityTable::deleteCity(const std::string& name) {
@@ -108,9 +118,13 @@ void CityTable::deleteCity(const std::string& name) {
     CityNode* curr = head->next;
     while (curr) {
         if (curr->id == id) {
+            if (capturing()) changes->emitDelete(cloneInfo(curr));
             prev->next = curr->next;
             idToCityMap.remove(id);
             nameToIdMap.erase(name);
+            nameSearchIndex.remove(id, curr->name);
+            nameHeapDirty = true;
+            modified = true;
             delete curr;
             return;
         }
@@ -128,7 +142,7 @@ void CityTable::saveToFile() const {
     CityNode* curr = head->next;
     while (curr) {
         file << curr->id << ' '
-            << quoted(curr->name) << ' '
+            << quoted(curr->name.view()) << ' '
             << curr->population << ' '
             << quoted(populationGradeToString(curr->grade)) << ' '
             << quoted(settlementTypeToString(curr->type))
@@ -136,6 +150,7 @@ void CityTable::saveToFile() const {
         curr = curr->next;
     }
     file.close();
+    modified = false;
 }
 
 void CityTable::updateColumnWidths() {
@@ -145,7 +160,7 @@ void CityTable::updateColumnWidths() {
     while (curr) {
         int idLen = static_cast<int>(to_string(curr->id).length());
         if (idLen > maxIdLen) maxIdLen = idLen;
-        if (curr->name.length() > maxNameLen) maxNameLen = curr->name.length();
+        if (curr->name.view().length() > maxNameLen) maxNameLen = curr->name.view().length();
         curr = curr->next;
     }
     idWidth = maxIdLen + 2;
@@ -184,9 +199,72 @@ void CityTable::clearFilters() {
     currentFilter = nullptr;
 }
 
+// Кандидаты из индекса названий, если среди фильтров есть "содержит"/"начинается с"
+bool CityTable::indexCandidates(std::vector<int>& ids) const {
+    bool found = false;
+    std::vector<int> tmp;
+    for (Filter* f = currentFilter; f; f = f->next) {
+        if (f->field != "name" || (f->cmpType != 1 && f->cmpType != 5)) continue;
+        nameSearch(f->value, f->cmpType == 5, tmp);
+        if (!found || tmp.size() < ids.size()) ids.swap(tmp);
+        found = true;
+    }
+    return found;
+}
+
+void CityTable::nameSearch(const std::string& pattern, bool prefixOnly, std::vector<int>& ids) const {
+    if (prefixOnly) {
+        nameSearchIndex.prefixMatches(pattern, ids);
+        return;
+    }
+    if (!nameSearchIndex.containsCandidates(pattern, ids)) scanNames(pattern, ids);
+}
+
+// Точный ответ "содержит" проходом по упакованной куче; куча
+// пересобирается лениво после изменений названий
+void CityTable::scanNames(const std::string& pattern, std::vector<int>& ids) const {
+    if (nameHeapDirty) {
+        nameHeap.clear();
+        for (CityNode* curr = head->next; curr; curr = curr->next)
+            nameHeap.add(curr->id, curr->name);
+        nameHeapDirty = false;
+    }
+    SubstringScan::scan(nameHeap, pattern, ids);
+    std::sort(ids.begin(), ids.end());
+}
+
 CityTable::CityNode* CityTable::applyFilters() const {
-    CityNode* filteredDummy = new CityNode(-1, "", 0, PopulationGrade::SMALL, SettlementType::CITY, nullptr);
+    FINALDB_METRIC_SCOPE("cities.applyFilters");
+    size_t returned = 0;
+    CityNode* filteredDummy = new CityNode(-1, InternedString(), 0, PopulationGrade::SMALL, SettlementType::CITY, nullptr);
     CityNode* tail = filteredDummy;
+
+    std::vector<int> candidates;
+    if (indexCandidates(candidates)) {
+        // Обходим только кандидатов; от больших id к меньшим — как в списке
+        for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+            CityNode* node = idToCityMap.find<CityNode>(*it);
+            if (!node) continue;
+            bool match = true;
+            for (Filter* f = currentFilter; f; f = f->next) {
+                if (!matchField(node, f->field, f->cmpType, f->value)) {
+                    match = false;
+                    break;
+                }
+            }
+            if (match) {
+                CityNode* newNode = cloneNode(node);
+                tail->next = newNode;
+                tail = newNode;
+                ++returned;
+            }
+        }
+        FINALDB_METRIC_ROWS(candidates.size(), returned);
+        CityNode* result = filteredDummy->next;
+        delete filteredDummy;
+        return result;
+    }
+
     CityNode* curr = head->next;
     while (curr) {
         bool match = true;
@@ -202,9 +280,11 @@ CityTable::CityNode* CityTable::applyFilters() const {
             CityNode* newNode = cloneNode(curr);
             tail->next = newNode;
             tail = newNode;
+            ++returned;
         }
         curr = curr->next;
     }
+    FINALDB_METRIC_ROWS(nameToIdMap.size(), returned);
     CityNode* result = filteredDummy->next;
     delete filteredDummy;
     return result;
@@ -215,11 +295,14 @@ bool CityTable::matchField(const CityNode* node, const std::string& field,
 {
     if (field == "name") {
         if (cmpType == 1) { // contains
-            return node->name.find(value) != string::npos;
+            return node->name.view().find(value) != string::npos;
         }
         else if (cmpType == 2) { // equals
             return node->name == value;
         }
+        else if (cmpType == 5) { // starts with
+            return node->name.view().compare(0, value.size(), value) == 0;
+        }
     }
     else if (field == "population") {
         return checkNumeric(node->population, cmpType, value);
@@ -292,12 +375,27 @@ bool CityTable::cityExists(int cityId) const {
     return idToCityMap.find<CityNode>(cityId) != nullptr;
 }
 
-std::string CityTable::getCityNameById(int id) const {
+std::string_view CityTable::getCityNameById(int id) const {
     CityNode* node = idToCityMap.find<CityNode>(id); //Возвращает название города по ID
-    return node ? node->name : "";
+    return node ? node->name.view() : std::string_view();
+}
+
+bool CityTable::getCityById(int id, CityInfo& out) const {
+    CityNode* node = idToCityMap.find<CityNode>(id);
+    if (!node) return false;
+    out = cloneInfo(node);
+    return true;
+}
+
+CityTable::CityInfo CityTable::cloneInfo(const CityNode* node) const {
+    return { node->id, node->name.view(), node->population, node->grade, node->type };
+}
+
+bool CityTable::capturing() const {
+    return changes && changes->active();
 }
 
-int CityTable::getCityIdByName(const std::string& name) const {
+int CityTable::getCityIdByName(std::string_view name) const {
     auto it = nameToIdMap.find(name); //Возвращает ID города по его названию
     return (it != nameToIdMap.end()) ? it->second : -1;
 }
@@ -305,31 +403,46 @@ int CityTable::getCityIdByName(const std::string& name) const {
 bool CityTable::updateCityName(int id, const std::string& newName) { //Обновляет название города по ID.
     CityNode* node = idToCityMap.find<CityNode>(id);
     if (!node) return false;
-    nameToIdMap.erase(node->name);
-    node->name = newName;
-    nameToIdMap[newName] = id;
+    CityInfo before = cloneInfo(node);
+    nameToIdMap.erase(node->name.view());
+    nameSearchIndex.remove(id, node->name.view());
+    node->name = InternedString(newName);
+    nameToIdMap[node->name.view()] = id;
+    nameSearchIndex.insert(id, node->name.view());
+    nameHeapDirty = true;
     updateColumnWidths();
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
 bool CityTable::updateCityPopulation(int id, int newPopulation) {
     CityNode* node = idToCityMap.find<CityNode>(id);
     if (!node) return false;
+    CityInfo before = cloneInfo(node);
     node->population = newPopulation;
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
 bool CityTable::updateCityGrade(int id, PopulationGrade newGrade) {
     CityNode* node = idToCityMap.find<CityNode>(id);
     if (!node) return false;
+    CityInfo before = cloneInfo(node);
     node->grade = newGrade;
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
 bool CityTable::updateCityType(int id, SettlementType newType) {
     CityNode* node = idToCityMap.find<CityNode>(id);
     if (!node) return false;
+    CityInfo before = cloneInfo(node);
     node->type = newType;
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
@@ -352,6 +465,7 @@ std::string CityTable::getFilterDescription(int index) const {
             if (f->field == "name") {
                 if (f->cmpType == 1) oss << "Name contains \"" << f->value << "\"";
                 else if (f->cmpType == 2) oss << "Name equals \"" << f->value << "\"";
+                else if (f->cmpType == 5) oss << "Name starts with \"" << f->value << "\"";
             }
             else if (f->field == "population") {
                 if (f->cmpType == 3) oss << "Population < " << f->value;
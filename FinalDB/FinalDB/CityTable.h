@@ -1,22 +1,30 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include "IntHashMap.h"
+#include "NgramIndex.h"
+#include "StringHeap.h"
+#include "StringPool.h"
 #include <map>
+#include <vector>
+
+class ChangeStream;
 
 class CityTable {
 public:
+    // 24 байта: перечисления хранятся в одном байте каждое
     struct CityNode {
         int    id;
-        std::string name;
+        InternedString name;
         int    population;
-        enum class PopulationGrade { SMALL, MEDIUM, LARGE };
-        enum class SettlementType { CITY, TOWN, VILLAGE };
+        enum class PopulationGrade : uint8_t { SMALL, MEDIUM, LARGE };
+        enum class SettlementType : uint8_t { CITY, TOWN, VILLAGE };
         PopulationGrade grade;
         SettlementType  type;
         CityNode* next;
-        CityNode(int id, const std::string& name, int population,
+        CityNode(int id, InternedString name, int population,
             PopulationGrade grade, SettlementType type, CityNode* next)
             : id(id), name(name), population(population),
             grade(grade), type(type), next(next) {
@@ -26,9 +34,10 @@ public:
     using PopulationGrade = CityNode::PopulationGrade;
     using SettlementType = CityNode::SettlementType;
 
+    // Строки — view в глобальный пул, не копии
     struct CityInfo {
         int    id;
-        std::string name;
+        std::string_view name;
         int    population;
         PopulationGrade grade;
         SettlementType  type;
@@ -42,7 +51,9 @@ public:
     /// Загрузить из произвольного файла
     bool loadFromFile(const std::string& filename);
     void saveToFile() const;
-    void addCity(const std::string& name, int population,
+    // Есть изменения, не записанные в файл
+    bool isModified() const { return modified; }
+    void addCity(std::string_view name, int population,
         PopulationGrade grade, SettlementType type);
     void deleteCity(const std::string& name);
 
@@ -66,35 +77,52 @@ public:
     CityInfo cityIteratorNext() const;
 
     bool cityExists(int cityId) const;
-    std::string getCityNameById(int id) const;
-    int         getCityIdByName(const std::string& name) const;
+    std::string_view getCityNameById(int id) const;   // view из пула, "" если нет
+    bool getCityById(int id, CityInfo& out) const;
+    int getCityCount() const { return static_cast<int>(nameToIdMap.size()); }
+    int         getCityIdByName(std::string_view name) const;
+    // Поиск по подстроке / префиксу названия: n-граммный индекс,
+    // для образцов короче триграммы — векторный проход по куче названий.
+    void nameSearch(const std::string& pattern, bool prefixOnly, std::vector<int>& ids) const;
 
     bool updateCityName(int id, const std::string& newName);
     bool updateCityPopulation(int id, int newPopulation);
     bool updateCityGrade(int id, PopulationGrade newGrade);
     bool updateCityType(int id, SettlementType newType);
 
+    // Поток изменений (CDC); nullptr — события не выпускаются
+    void setChangeStream(ChangeStream* stream) { changes = stream; }
+
 private:
     struct Filter {
         std::string field;
-        int cmpType; // 1: contains, 2: equals, 3: <, 4: >
+        int cmpType; // 1: contains, 2: equals, 3: <, 4: >, 5: starts with
         std::string value;
         Filter* next;
     };
 
     CityNode* head;
     IntHashMap idToCityMap;
-    std::map<std::string, int> nameToIdMap;
+    std::map<std::string_view, int> nameToIdMap;   // ключи — view из пула
+    NgramIndex nameSearchIndex;      // подстрока / префикс названия
+    mutable StringHeap nameHeap;     // упакованные названия для SIMD-поиска
+    mutable bool nameHeapDirty = true;
+    mutable bool modified = false;    // сбрасывается при загрузке и сохранении
     Filter* currentFilter;
     mutable CityNode* currentIterator;
+    ChangeStream* changes = nullptr;
 
     int idWidth, nameWidth, populationWidth, typeWidth;
 
     void parseLine(const std::string& line);
-    void addCityNode(int id, const std::string& name, int population,
+    void addCityNode(int id, std::string_view name, int population,
         PopulationGrade grade, SettlementType type);
     bool matchField(const CityNode* node, const std::string& field,
         int cmpType, const std::string& value) const;
     bool checkNumeric(int value, int cmpType, const std::string& valueStr) const;
     CityNode* cloneNode(const CityNode* src) const;
+    CityInfo cloneInfo(const CityNode* node) const;
+    bool capturing() const;          // у потока изменений есть подписчики
+    bool indexCandidates(std::vector<int>& ids) const;
+    void scanNames(const std::string& pattern, std::vector<int>& ids) const;
 };
\ No newline at end of file
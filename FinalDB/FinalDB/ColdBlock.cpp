@@ -0,0 +1,139 @@
+#include "ColdBlock.h"
+#include <algorithm>
+#include <bitset>
+#include <stdexcept>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+using namespace std;
+
+int ColdBlock::lowestBit(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// Бит на значения из [0, span]
+static uint8_t widthFor(uint32_t span) {
+    uint8_t width = 0;
+    while (width < 32 && (span >> width) != 0) ++width;
+    return width;
+}
+
+ColdBlock::ColdBlock(const vector<Entry>& entries) {
+    if (entries.empty()) throw invalid_argument("Empty cold block");
+    count = entries.size();
+
+    int32_t lo[3] = { INT32_MAX, INT32_MAX, INT32_MAX }, hi[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+    for (const Entry& e : entries) {
+        present[e.slot >> 6] |= 1ull << (e.slot & 63);
+        const int32_t values[3] = { e.row.driverId, e.row.cityId, e.row.date };
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = min(lo[c], values[c]);
+            hi[c] = max(hi[c], values[c]);
+        }
+        fines.push_back(e.row.fineId);
+    }
+    sort(fines.begin(), fines.end());
+    fines.erase(unique(fines.begin(), fines.end()), fines.end());
+    fines.shrink_to_fit();
+
+    uint16_t before = 0;
+    for (int w = 0; w < SLOTS / 64; ++w) {
+        rankBefore[w] = before;
+        before = static_cast<uint16_t>(before + bitset<64>(present[w]).count());
+    }
+
+    Field* columns[3] = { &driver, &city, &date };
+    for (int c = 0; c < 3; ++c) {
+        columns[c]->base = lo[c];
+        columns[c]->top = hi[c];
+        columns[c]->width = widthFor(static_cast<uint32_t>(static_cast<int64_t>(hi[c]) - lo[c]));
+    }
+    fine.width = widthFor(static_cast<uint32_t>(fines.size() - 1));
+    driver.offset = 0;
+    city.offset = static_cast<uint8_t>(driver.offset + driver.width);
+    fine.offset = static_cast<uint8_t>(city.offset + city.width);
+    date.offset = static_cast<uint8_t>(fine.offset + fine.width);
+    rowBits = date.offset + date.width;
+
+    bits.assign((count * rowBits + 63) / 64 + 1, 0);   // +1: чтение окна из двух слов
+    for (size_t i = 0; i < count; ++i) {
+        const Row& r = entries[i].row;
+        size_t at = i * rowBits;
+        write(at + driver.offset, driver.width, static_cast<uint32_t>(r.driverId - driver.base));
+        write(at + city.offset, city.width, static_cast<uint32_t>(r.cityId - city.base));
+        size_t code = lower_bound(fines.begin(), fines.end(), r.fineId) - fines.begin();
+        write(at + fine.offset, fine.width, static_cast<uint32_t>(code));
+        write(at + date.offset, date.width, static_cast<uint32_t>(r.date - date.base));
+    }
+}
+
+size_t ColdBlock::rank(int slot) const {
+    uint64_t below = present[slot >> 6] & ((1ull << (slot & 63)) - 1);
+    return rankBefore[slot >> 6] + bitset<64>(below).count();
+}
+
+uint32_t ColdBlock::read(size_t bitPos, uint8_t width) const {
+    if (width == 0) return 0;
+    size_t word = bitPos >> 6;
+    unsigned shift = bitPos & 63;
+    uint64_t value = bits[word] >> shift;
+    if (shift + width > 64) value |= bits[word + 1] << (64 - shift);
+    return static_cast<uint32_t>(value & ((1ull << width) - 1));
+}
+
+void ColdBlock::write(size_t bitPos, uint8_t width, uint32_t value) {
+    if (width == 0) return;
+    size_t word = bitPos >> 6;
+    unsigned shift = bitPos & 63;
+    bits[word] |= static_cast<uint64_t>(value) << shift;
+    if (shift + width > 64) bits[word + 1] |= static_cast<uint64_t>(value) >> (64 - shift);
+}
+
+ColdBlock::Row ColdBlock::decode(size_t index) const {
+    size_t at = index * rowBits;
+    Row r;
+    r.driverId = static_cast<int32_t>(driver.base + static_cast<int64_t>(read(at + driver.offset, driver.width)));
+    r.cityId = static_cast<int32_t>(city.base + static_cast<int64_t>(read(at + city.offset, city.width)));
+    r.fineId = fines[read(at + fine.offset, fine.width)];
+    r.date = static_cast<int32_t>(date.base + static_cast<int64_t>(read(at + date.offset, date.width)));
+    return r;
+}
+
+vector<ColdBlock::Entry> ColdBlock::entries() const {
+    vector<Entry> out;
+    out.reserve(count);
+    forEach([&out](int slot, const Row& row) { out.push_back({ slot, row }); });
+    return out;
+}
+
+int32_t ColdBlock::minValue(Column column) const {
+    switch (column) {
+    case Column::DRIVER: return driver.base;
+    case Column::CITY:   return city.base;
+    case Column::FINE:   return fines.front();
+    default:             return date.base;
+    }
+}
+
+int32_t ColdBlock::maxValue(Column column) const {
+    switch (column) {
+    case Column::DRIVER: return driver.top;
+    case Column::CITY:   return city.top;
+    case Column::FINE:   return fines.back();
+    default:             return date.top;
+    }
+}
+
+bool ColdBlock::hasFine(int fineId) const {
+    return binary_search(fines.begin(), fines.end(), fineId);
+}
+
+size_t ColdBlock::bytes() const {
+    return sizeof(*this) + fines.capacity() * sizeof(int32_t) + bits.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Неизменяемый сжатый блок строк реестра (холодный ярус) на один сегмент.
+// Занятые слоты — битовая карта с префиксными счётчиками: номер строки
+// слота — число занятых слотов перед ним, recordId не хранятся. Колонки
+// упакованы в биты фиксированной ширины: водитель, город и дата —
+// смещение от минимума блока, штраф — номер в словаре блока.
+// Любая строка читается за O(1) без распаковки блока и без общего
+// состояния, поэтому блок можно читать из нескольких потоков.
+// Изменение — только построением нового блока.
+class ColdBlock {
+public:
+    static const int SLOTS = 4096;   // = FineRegistry::SEGMENT_RECORDS
+    enum class Column { DRIVER, CITY, FINE, DATE };
+
+    struct Row {
+        int32_t driverId;
+        int32_t cityId;
+        int32_t fineId;
+        int32_t date;                // упакованная дата, см. FineRegistry::packDate
+    };
+    struct Entry {
+        int slot;
+        Row row;
+    };
+
+    // entries — по возрастанию slot, не пустой
+    explicit ColdBlock(const std::vector<Entry>& entries);
+
+    size_t size() const { return count; }
+    bool has(int slot) const {
+        return (present[slot >> 6] >> (slot & 63)) & 1;
+    }
+    Row row(int slot) const { return decode(rank(slot)); }   // только для has(slot)
+
+    // Строки по возрастанию слота: visit(slot, row)
+    template <class Visit>
+    void forEach(Visit visit) const {
+        size_t index = 0;
+        for (int w = 0; w < SLOTS / 64; ++w) {
+            for (uint64_t bits = present[w]; bits; bits &= bits - 1) {
+                int slot = w * 64 + lowestBit(bits);
+                visit(slot, decode(index++));
+            }
+        }
+    }
+    std::vector<Entry> entries() const;
+
+    // Границы значений колонки в блоке (для отсечения блоков целиком)
+    int32_t minValue(Column column) const;
+    int32_t maxValue(Column column) const;
+    bool hasFine(int fineId) const;
+
+    size_t bytes() const;
+
+private:
+    struct Field {
+        int32_t base = 0;            // минимум колонки
+        int32_t top = 0;             // максимум
+        uint8_t width = 0;           // бит на значение
+        uint8_t offset = 0;          // смещение в упакованной строке
+    };
+
+    uint64_t present[SLOTS / 64] = {};
+    uint16_t rankBefore[SLOTS / 64] = {};
+    size_t count = 0;
+    Field driver, city, fine, date;  // fine — номер в словаре fines
+    uint32_t rowBits = 0;
+    std::vector<int32_t> fines;      // по возрастанию
+    std::vector<uint64_t> bits;
+
+    size_t rank(int slot) const;
+    Row decode(size_t index) const;
+    uint32_t read(size_t bitPos, uint8_t width) const;
+    void write(size_t bitPos, uint8_t width, uint32_t value);
+    static int lowestBit(uint64_t x);
+};
@@ -1,7 +1,77 @@
 ﻿#include "UserInterface.h"
+#include "BatchRunner.h"
+#include "QueryServer.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 
-int main() {
+namespace {
+
+QueryServer* activeServer = nullptr;
+
+void stopServer(int) {
+    if (activeServer) activeServer->stop();
+}
+
+// FinalDB --serve [адрес] [потоков]: база загружается один раз и
+// обслуживает клиентов QueryProtocol до Ctrl+C
+int serve(int argc, char** argv) {
+    std::string address = argc > 0 ? argv[0] : "127.0.0.1:5433";
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 0;
+    DatabaseManager db;
+    db.loadAll();
+    {
+        // Сервер разрушается раньше flush: его потоки дописывают изменения
+        QueryServer server(db, threads);
+        if (!server.listen(address)) return 1;
+        activeServer = &server;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+        std::cout << "Serving on " << address << " (Ctrl+C to stop)\n";
+        server.run();
+        activeServer = nullptr;
+        QueryServer::Stats stats = server.getStats();
+        std::cout << "Stopped: " << stats.connections << " connections, " << stats.requests
+            << " requests, " << stats.failed << " failed\n";
+    }
+    db.flush();
+    return 0;
+}
+
+// FinalDB --batch <файл|->: сценарий команд (BatchRunner.h) без меню;
+// код возврата 2, если хотя бы одна команда не выполнилась
+int batch(int argc, char** argv) {
+    if (argc < 1) {
+        std::cerr << "Usage: FinalDB --batch <script|->\n";
+        return 1;
+    }
+    std::ifstream file;
+    bool fromStdin = std::strcmp(argv[0], "-") == 0;
+    if (!fromStdin) {
+        file.open(argv[0]);
+        if (!file.is_open()) {
+            std::cerr << "Error opening script: " << argv[0] << "\n";
+            return 1;
+        }
+    }
+    DatabaseManager db;
+    BatchRunner runner(db, std::cout, std::cerr);
+    BatchRunner::Report report = runner.run(fromStdin ? std::cin : file);
+    std::cerr << std::fixed << std::setprecision(1) << "Batch: " << report.commands << " command(s), "
+        << report.failed << " failed in " << report.runMs << " ms ("
+        << std::setprecision(0) << (report.runMs > 0 ? report.commands * 1000.0 / report.runMs : 0.0)
+        << " commands/s), saved in " << std::setprecision(1) << report.saveMs << " ms\n";
+    return report.failed ? 2 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
     try {
+        if (argc > 1 && std::strcmp(argv[1], "--serve") == 0) return serve(argc - 2, argv + 2);
+        if (argc > 1 && std::strcmp(argv[1], "--batch") == 0) return batch(argc - 2, argv + 2);
         UserInterface ui;
         ui.run();
     }
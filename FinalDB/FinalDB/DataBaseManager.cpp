@@ -1,20 +1,72 @@
 // DatabaseManager.cpp
 #include "DatabaseManager.h"
+#include "Metrics.h"
+#include "Validation.h"
 #include <iostream>
 #include <stdexcept>
 
+DatabaseManager::DatabaseManager() {
+    cities.setChangeStream(&changes);
+    drivers.setChangeStream(&changes);
+    fines.setChangeStream(&changes);
+    registry.setChangeStream(&changes);
+    registry.setColdCutoff((Validation::today().year - 1) * 10000 + 101);
+}
+
+void DatabaseManager::setColdCutoff(int cutoff) {
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    registry.setColdCutoff(cutoff);
+}
+
+int DatabaseManager::getColdCutoff() {
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    return registry.getColdCutoff();
+}
+
+// Данные не меняются — commit не нужен
+size_t DatabaseManager::compactCold() {
+    FINALDB_METRIC_SCOPE("db.compactCold");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(REGISTRY);
+    return registry.compactCold();
+}
+
 void DatabaseManager::loadAll() {
+    FINALDB_METRIC_SCOPE("db.loadAll");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
     cities.loadFromFile();
     drivers.loadFromFile();
     fines.loadFromFile();
     registry.loadFromFile();
+    loadedTables = ALL_TABLES;
+    registry.priceFines(&fines);
+}
+
+// Читает ещё не загруженные таблицы из маски; отсутствующий файл
+// считается пустой таблицей и повторно не читается
+void DatabaseManager::ensureLoaded(int tables) {
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    int missing = tables & ~loadedTables;
+    if (!missing) return;
+    FINALDB_METRIC_SCOPE("db.lazyLoad");
+    if (missing & CITIES) cities.loadFromFile();
+    if (missing & DRIVERS) drivers.loadFromFile();
+    if (missing & FINES) fines.loadFromFile();
+    if (missing & REGISTRY) registry.loadFromFile();
+    loadedTables |= missing;
+    // Долги в реестре оцениваются по ставкам загруженного справочника штрафов
+    if ((missing & (FINES | REGISTRY)) && (loadedTables & FINES) && (loadedTables & REGISTRY))
+        registry.priceFines(&fines);
 }
 
 void DatabaseManager::saveAll() {
-    cities.saveToFile();
-    drivers.saveToFile();
-    fines.saveToFile();
-    registry.saveToFile();
+    FINALDB_METRIC_SCOPE("db.saveAll");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    // Переписываются только загруженные и изменённые таблицы
+    if ((loadedTables & CITIES) && cities.isModified()) cities.saveToFile();
+    if ((loadedTables & DRIVERS) && drivers.isModified()) drivers.saveToFile();
+    if ((loadedTables & FINES) && fines.isModified()) fines.saveToFile();
+    if ((loadedTables & REGISTRY) && registry.isModified()) registry.saveToFile();
 }
 
 void DatabaseManager::addCity(const std::string& name,
@@ -22,55 +74,91 @@ void DatabaseManager::addCity(const std::string& name,
     CityTable::PopulationGrade grade,
     CityTable::SettlementType type)
 {
+    FINALDB_METRIC_SCOPE("db.addCity");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(CITIES);
     cities.addCity(name, population, grade, type);
-    cities.saveToFile();
+    writer.commit();
 }
 
-void DatabaseManager::deleteCity(const std::string& name) {
+ReferentialIntegrity::DeleteReport DatabaseManager::deleteCity(const std::string& name) {
+    FINALDB_METRIC_SCOPE("db.deleteCity");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(ALL_TABLES);
     int id = cities.getCityIdByName(name);
-    if (id != -1) {
-        cities.deleteCity(name);
-        drivers.updateCityReferences(id);
-        registry.updateCityReferences(id);
-        saveAll();
+    if (id == -1) {
+        throw std::invalid_argument("City not found");
     }
+    ReferentialIntegrity::DeleteReport report = integrity.deleteCity(id);
+    writer.commit();
+    return report;
 }
 
 void DatabaseManager::addDriver(const std::string& fullName,
     const std::string& birthDate,
     const std::string& cityName)
 {
+    FINALDB_METRIC_SCOPE("db.addDriver");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(CITIES | DRIVERS);
     int cityId = cities.getCityIdByName(cityName);
     if (cityId == -1) {
         throw std::invalid_argument("City does not exist");
     }
     drivers.addDriver(fullName, birthDate, cityId);
-    saveAll();
+    writer.commit();
 }
 
-void DatabaseManager::deleteDriverById(int driverId) {
-    drivers.deleteDriverById(driverId);
-    registry.updateDriverReferences(driverId);
-    saveAll();
+ReferentialIntegrity::DeleteReport DatabaseManager::deleteDriverById(int driverId) {
+    FINALDB_METRIC_SCOPE("db.deleteDriver");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(DRIVERS | REGISTRY);
+    ReferentialIntegrity::DeleteReport report = integrity.deleteDriver(driverId);
+    writer.commit();
+    return report;
 }
 
 void DatabaseManager::addFine(const std::string& type,
     double amount,
     FineTable::Severity severity)
 {
+    FINALDB_METRIC_SCOPE("db.addFine");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(FINES);
     fines.addFine(type, amount, severity);
-    saveAll();
+    writer.commit();
 }
 
-void DatabaseManager::deleteFine(const std::string& type) {
-    fines.deleteFine(type);
-    saveAll();
+bool DatabaseManager::updateFineAmount(int fineId, double amount) {
+    FINALDB_METRIC_SCOPE("db.updateFineAmount");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(FINES | REGISTRY);
+    if (!fines.updateFineAmount(fineId, amount)) return false;
+    registry.repriceFine(fineId);
+    writer.commit();
+    return true;
+}
+
+ReferentialIntegrity::DeleteReport DatabaseManager::deleteFine(const std::string& type) {
+    FINALDB_METRIC_SCOPE("db.deleteFine");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(FINES | REGISTRY);
+    int id = fines.getFineIdByType(type);
+    if (id == -1) {
+        throw std::invalid_argument("Fine not found");
+    }
+    ReferentialIntegrity::DeleteReport report = integrity.deleteFine(id);
+    writer.commit();
+    return report;
 }
 
 void DatabaseManager::addViolation(const std::string& driverName,
     const std::string& fineType,
     const std::string& date)
 {
+    FINALDB_METRIC_SCOPE("db.addViolation");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(DRIVERS | FINES | REGISTRY);
     int driverId = drivers.getDriverId(driverName);
     int cityId = drivers.getCityIdForDriver(driverName);
     int fineId = fines.getFineIdByType(fineType);
@@ -78,148 +166,134 @@ void DatabaseManager::addViolation(const std::string& driverName,
         throw std::invalid_argument("Invalid data for violation");
     }
     registry.addViolation(driverId, cityId, fineId, date);
-    saveAll();
+    writer.commit();
 }
 
 void DatabaseManager::markFineAsPaid(int recordId) {
+    FINALDB_METRIC_SCOPE("db.markFineAsPaid");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(REGISTRY);
     registry.markAsPaid(recordId);
-    saveAll();
+    writer.commit();
+}
+
+BulkImport::Report DatabaseManager::importViolations(const std::string& path) {
+    FINALDB_METRIC_SCOPE("db.importViolations");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(DRIVERS | FINES | REGISTRY);
+    BulkImport::Report report = BulkImport::importViolations(path, drivers, fines, registry);
+    // Из повторов изменения дают только впервые оплаченные записи
+    size_t changed = report.inserted + report.paidDuplicates;
+    if (changed) writer.commit(changed);
+    FINALDB_METRIC_ROWS(report.rowsRead, report.inserted);
+    return report;
+}
+
+BulkImport::Report DatabaseManager::importDrivers(const std::string& path) {
+    FINALDB_METRIC_SCOPE("db.importDrivers");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(CITIES | DRIVERS);
+    BulkImport::Report report = BulkImport::importDrivers(path, cities, drivers);
+    if (report.inserted) writer.commit(report.inserted);
+    FINALDB_METRIC_ROWS(report.rowsRead, report.inserted);
+    return report;
 }
 
 std::vector<FineRegistry::ViolationInfo> DatabaseManager::getAllViolations() {
+    FINALDB_METRIC_SCOPE("db.getAllViolations");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(ALL_TABLES);
     registry.violationIteratorReset();
     std::vector<FineRegistry::ViolationInfo> list;
     while (registry.violationIteratorHasNext()) {
         list.push_back(registry.violationIteratorNext(drivers, cities, fines));
     }
+    FINALDB_METRIC_ROWS(list.size(), list.size());
     return list;
 }
 
-void DatabaseManager::loadExternalTables(const std::string& suffix) {
-    // 1) Сначала основная база (если нужно)
-    cities.loadFromFile();
-    drivers.loadFromFile();
-    fines.loadFromFile();
-    registry.loadFromFile();
+QueryResult DatabaseManager::runQuery(const std::string& text) {
+    FINALDB_METRIC_SCOPE("db.runQuery");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(ALL_TABLES);
+    QueryEngine engine(cities, drivers, fines, registry);
+    QueryResult result = engine.execute(text);
+    FINALDB_METRIC_ROWS(result.rowsExamined, result.rows.size());
+    return result;
+}
 
-    // 2) Читаем внешние файлы, без присваиваний объектов:
-    externalCities.loadFromFile("cities" + suffix + ".txt");
-    externalDrivers.loadFromFile("drivers" + suffix + ".txt");
-    externalFines.loadFromFile("fines" + suffix + ".txt");
-    externalRegistry.loadFromFile("registry" + suffix + ".txt");
-}
-
-void DatabaseManager::mergeExternalTables() {
-    // 1) Города
-    externalCities.cityIteratorReset();
-    while (externalCities.cityIteratorHasNext()) {
-        auto ext = externalCities.cityIteratorNext();
-        int id = cities.getCityIdByName(ext.name);
-        if (id == -1) {
-            cities.addCity(ext.name, ext.population, ext.grade, ext.type);
-        }
-        else {
-            cities.updateCityPopulation(id, ext.population);
-            cities.updateCityGrade(id, ext.grade);
-            cities.updateCityType(id, ext.type);
-        }
-    }
+GroupByEngine::Result DatabaseManager::groupViolations(const GroupByEngine::Spec& spec) {
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(ALL_TABLES);
+    GroupByEngine engine(cities, drivers, fines, registry);
+    return engine.run(spec);
+}
 
-    // 2) Водители
-    externalDrivers.driverIteratorReset();
-    while (externalDrivers.driverIteratorHasNext()) {
-        auto ext = externalDrivers.driverIteratorNext();
-        // Находим/создаем город в основной базе
-        std::string cityName = externalCities.getCityNameById(ext.cityId);
-        int mainCityId = cities.getCityIdByName(cityName);
-        if (mainCityId == -1) {
-            cities.addCity(cityName, 0,
-                CityTable::PopulationGrade::SMALL,
-                CityTable::SettlementType::CITY);
-            mainCityId = cities.getCityIdByName(cityName);
-        }
-        int did = drivers.getDriverId(ext.fullName, ext.birthDate, mainCityId);
-        if (did == -1) {
-            drivers.addDriver(ext.fullName, ext.birthDate, mainCityId);
-        }
-        else {
-            drivers.updateDriverName(did, ext.fullName);
-            drivers.updateDriverBirthDate(did, ext.birthDate);
-            drivers.updateDriverCity(did, mainCityId);
-        }
+std::vector<ViolationRollup::Point> DatabaseManager::violationSeries(
+    ViolationRollup::Granularity granularity, int fromDay, int toDay, const std::string& cityName)
+{
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(ALL_TABLES);
+    int cityId = ViolationRollup::ANY_CITY;
+    if (!cityName.empty()) {
+        cityId = cities.getCityIdByName(cityName);
+        if (cityId == -1) throw std::invalid_argument("City not found");
     }
+    return registry.getRollup().series(granularity, fromDay, toDay, cityId, fines);
+}
 
-    // 3) Штрафы
-    externalFines.fineIteratorReset();
-    while (externalFines.fineIteratorHasNext()) {
-        auto ext = externalFines.fineIteratorNext();
-        int fid = fines.getFineIdByType(ext.type);
-        if (fid == -1) {
-            fines.addFine(ext.type, ext.amount, ext.severity);
-        }
-        else {
-            fines.updateFineAmount(fid, ext.amount);
-            fines.updateFineSeverity(fid, ext.severity);
-        }
-    }
+DebtLedger::Debt DatabaseManager::driverDebt(int driverId) {
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(FINES | REGISTRY);
+    return registry.getDebts().debtOf(driverId);
+}
 
-    // 4) Нарушения
-    auto extList = externalRegistry.applyFilters(externalDrivers, externalCities, externalFines);
-    for (auto& v : extList) {
-        bool found = false;
-        registry.violationIteratorReset();
-        while (registry.violationIteratorHasNext()) {
-            auto mv = registry.violationIteratorNext(drivers, cities, fines);
-            if (mv.driverName == v.driverName
-                && mv.cityName == v.cityName
-                && mv.fineType == v.fineType
-                && mv.date == v.date)
-            {
-                registry.updateViolationPaid(mv.recordId, v.paid);
-                registry.updateViolationFine(mv.recordId, v.fineId);
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            // 1) Найдём дату рождения водителя во внешней таблице
-            externalDrivers.driverIteratorReset();
-            std::string birthDate;
-            while (externalDrivers.driverIteratorHasNext()) {
-                auto di = externalDrivers.driverIteratorNext();
-                if (di.id == v.driverId) {
-                    birthDate = di.birthDate;
-                    break;
-                }
-            }
-
-            // 2) Определяем mainCityId
-            int mainCityId = cities.getCityIdByName(v.cityName);
-
-            // 3) Ищем в основной таблице водителя по ФИО+birthDate+город
-            int driverId = drivers.getDriverId(v.driverName, birthDate, mainCityId);
-
-            // 4) Добавляем нарушение
-            int fineId = fines.getFineIdByType(v.fineType);
-            registry.addViolation(driverId, mainCityId, fineId, v.date);
-
-            // 5) Если нужно, помечаем оплачено
-            if (v.paid) {
-                int maxId = 0;
-                registry.violationIteratorReset();
-                while (registry.violationIteratorHasNext()) {
-                    auto info = registry.violationIteratorNext(drivers, cities, fines);
-                    maxId = std::max(maxId, info.recordId);
-                }
-                registry.markAsPaid(maxId);
-            }
-        }
-    }
+std::vector<DebtLedger::Debt> DatabaseManager::debtors(double minBalance, size_t limit) {
+    FINALDB_METRIC_SCOPE("db.debtors");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    ensureLoaded(FINES | REGISTRY);
+    std::vector<DebtLedger::Debt> list = registry.getDebts().debtors(minBalance, limit);
+    FINALDB_METRIC_ROWS(list.size(), list.size());
+    return list;
+}
 
-    // Сохраняем объединённую базу сразу
-    saveAll();
+MergeEngine::Report DatabaseManager::mergeExternal(const std::vector<std::string>& suffixes) {
+    FINALDB_METRIC_SCOPE("merge.total");
+    std::lock_guard<std::recursive_mutex> lock(tablesMutex);
+    MergeEngine::Report report = MergeEngine::merge(suffixes,
+        [this] { ensureLoaded(ALL_TABLES); }, cities, drivers, fines, registry);
+    if (report.mutations()) writer.commit(report.mutations());
+    // Перекодировка ID — след слияния для аудита
+    if (MergeEngine::writeRemap(report, "merge_remap.txt")) report.remapFile = "merge_remap.txt";
+    return report;
 }
 
-void DatabaseManager::saveMainTables() {
+void DatabaseManager::commit(size_t mutations) {
+    writer.commit(mutations);
+}
+
+// Барьер фоновой записи и дозапись того, что меняли без commit
+void DatabaseManager::flush() {
+    writer.flush();
     saveAll();
+    changes.flush();
+}
+
+bool DatabaseManager::startChangeLog(const std::string& path) {
+    stopChangeLog();
+    auto sink = std::make_unique<ChangeFileSink>(path);
+    if (!sink->isOpen()) return false;
+    ChangeFileSink* target = sink.get();
+    changeLog = std::move(sink);
+    changeLogSubscription = changes.subscribe(
+        [target](const ChangeEvent* events, size_t count) { target->write(events, count); });
+    return true;
+}
+
+// После unsubscribe приёмник больше не вызывается и его можно закрыть
+void DatabaseManager::stopChangeLog() {
+    if (!changeLog) return;
+    changes.flush();
+    changes.unsubscribe(changeLogSubscription);
+    changeLog.reset();
 }
@@ -5,59 +5,137 @@
 #include "DriverTable.h"
 #include "FineTable.h"
 #include "FineRegistry.h"
+#include "QueryEngine.h"
+#include "ReferentialIntegrity.h"
+#include "BackgroundWriter.h"
+#include "ChangeStream.h"
+#include "BulkImport.h"
+#include "GroupByEngine.h"
+#include "MergeEngine.h"
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 class DatabaseManager {
 private:
-    // Основные таблицы
+    // Поток изменений и файловый приёмник объявлены до таблиц: поток
+    // разрушается после них и успевает доставить накопленное в файл
+    std::unique_ptr<ChangeFileSink> changeLog;
+    int changeLogSubscription = 0;
+    ChangeStream changes;
+
+    // Основные таблицы. Конструкторы таблиц ничего не читают: файл
+    // загружается при первом обращении к таблице (ensureLoaded).
     CityTable    cities;
     DriverTable  drivers;
     FineTable    fines;
     FineRegistry registry;
 
-    // Внешние таблицы для слияния
-    CityTable    externalCities;
-    DriverTable  externalDrivers;
-    FineTable    externalFines;
-    FineRegistry externalRegistry;
+    enum LoadedTable { CITIES = 1, DRIVERS = 2, FINES = 4, REGISTRY = 8, ALL_TABLES = 15 };
+    int loadedTables = 0;
+    void ensureLoaded(int tables);
+
+    // ON DELETE для связей основной базы
+    ReferentialIntegrity integrity{ cities, drivers, fines, registry };
+
+    // Изменения таблиц и их запись фоновым потоком — под этой блокировкой
+    std::recursive_mutex tablesMutex;
+    // Объявлен последним: разрушается первым и дописывает накопленное,
+    // пока таблицы ещё живы
+    BackgroundWriter writer{ [this] { saveAll(); } };
 
 public:
-    // Загрузка/сохранение основной базы
+    DatabaseManager();
+
+    // Загрузка/сохранение основной базы. loadAll перечитывает все файлы,
+    // saveAll пишет только загруженные таблицы (остальные на диске не менялись).
     void loadAll();
     void saveAll();
 
+    // Операции ниже не пишут на диск сами, а фиксируют изменения в writer
+    // (уровень надёжности — getWriter().setDurability).
+    // Правки через getCities() и т.п. делаются под lockTables()
+    // и завершаются commit(); flush() — барьер перед выходом.
+    std::unique_lock<std::recursive_mutex> lockTables() {
+        return std::unique_lock<std::recursive_mutex>(tablesMutex);
+    }
+    void commit(size_t mutations = 1);
+    void flush();
+    BackgroundWriter& getWriter() { return writer; }
+
+    // Поток изменений всех четырёх таблиц (ChangeStream.h); подписчики
+    // вызываются в потоке доставки и не должны брать lockTables()
+    ChangeStream& getChanges() { return changes; }
+    // Журнал изменений в файл; false — файл не открылся
+    bool startChangeLog(const std::string& path);
+    void stopChangeLog();
+    bool isChangeLogging() const { return changeLog != nullptr; }
+    std::string getChangeLogPath() const { return changeLog ? changeLog->getPath() : std::string(); }
+
     // Операции над основной базой
     void addCity(const std::string& name, int population,
         CityTable::PopulationGrade grade,
         CityTable::SettlementType type);
-    void deleteCity(const std::string& name);
+    // Удаления применяют политики integrity; RESTRICT → invalid_argument
+    ReferentialIntegrity::DeleteReport deleteCity(const std::string& name);
 
     void addDriver(const std::string& fullName,
         const std::string& birthDate,
         const std::string& cityName);
-    void deleteDriverById(int driverId);
+    ReferentialIntegrity::DeleteReport deleteDriverById(int driverId);
 
     void addFine(const std::string& type, double amount,
         FineTable::Severity severity = FineTable::Severity::LIGHT);
-    void deleteFine(const std::string& type);
+    ReferentialIntegrity::DeleteReport deleteFine(const std::string& type);
+    // Смена суммы штрафа с пересчётом долгов водителей; false — штрафа нет
+    bool updateFineAmount(int fineId, double amount);
 
     void addViolation(const std::string& driverName,
         const std::string& fineType,
         const std::string& date);
     void markFineAsPaid(int recordId);
 
+    // Пакетный импорт CSV/TSV (формат — BulkImport.h); один commit на файл
+    BulkImport::Report importViolations(const std::string& path);
+    BulkImport::Report importDrivers(const std::string& path);
+
     std::vector<FineRegistry::ViolationInfo> getAllViolations();
 
-    CityTable& getCities() { return cities; }
-    DriverTable& getDrivers() { return drivers; }
-    FineTable& getFines() { return fines; }
-    FineRegistry& getRegistry() { return registry; }
+    CityTable& getCities() { ensureLoaded(CITIES); return cities; }
+    DriverTable& getDrivers() { ensureLoaded(DRIVERS); return drivers; }
+    FineTable& getFines() { ensureLoaded(FINES); return fines; }
+    FineRegistry& getRegistry() { ensureLoaded(REGISTRY); return registry; }
+    ReferentialIntegrity& getIntegrity() { return integrity; }
+
+    // Язык запросов: "[EXPLAIN] violations WHERE city.grade = Large AND ..."
+    QueryResult runQuery(const std::string& text);
+
+    // Группировка нарушений с агрегатами (GroupByEngine.h)
+    GroupByEngine::Result groupViolations(const GroupByEngine::Spec& spec);
+
+    // Ряды нарушений и выручки по дням/месяцам/годам из счётчиков реестра
+    // (ViolationRollup.h): без прохода по записям. Дни — YYYYMMDD,
+    // cityName "" — все города, неизвестный город → invalid_argument
+    std::vector<ViolationRollup::Point> violationSeries(ViolationRollup::Granularity granularity,
+        int fromDay, int toDay, const std::string& cityName);
+
+    // Долги водителей по счётчикам реестра (DebtLedger.h)
+    DebtLedger::Debt driverDebt(int driverId);
+    // Должники с долгом больше minBalance, по убыванию; limit 0 — все
+    std::vector<DebtLedger::Debt> debtors(double minBalance, size_t limit);
+
+    // Холодный ярус реестра (FineRegistry.h): оплаченные нарушения с датой
+    // раньше cutoff (YYYYMMDD, 0 — ярус выключен) хранятся сжатыми.
+    // По умолчанию — 1 января прошлого года; граница действует при загрузке
+    // реестра и в compactCold, которая переносит записи сразу.
+    void setColdCutoff(int cutoff);
+    int getColdCutoff();
+    size_t compactCold();
 
-    // Слияние внешней базы
-    // suffix — суффикс в именах файлов, например "_ext"
-    void loadExternalTables(const std::string& suffix);
-    void mergeExternalTables();
-    void saveMainTables();
+    // Слияние внешних баз: суффиксы в именах файлов, например "_ext".
+    // Источники читаются параллельно и живут только на время слияния;
+    // результат фиксируется одним commit.
+    MergeEngine::Report mergeExternal(const std::vector<std::string>& suffixes);
 };
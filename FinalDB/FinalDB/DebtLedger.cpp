@@ -0,0 +1,77 @@
+#include "DebtLedger.h"
+#include <cmath>
+using namespace std;
+
+int64_t DebtLedger::toCents(double amount) {
+    return llround(amount * 100);
+}
+
+DebtLedger::FineDebtors& DebtLedger::fineDebtors(int fineId) {
+    auto it = byFine.find(fineId);
+    if (it != byFine.end()) return it->second;
+    FineDebtors& entry = byFine[fineId];
+    if (fines) entry.cents = toCents(fines->getAmountById(fineId));
+    return entry;
+}
+
+void DebtLedger::add(int driverId, int fineId, int delta) {
+    FineDebtors& fine = fineDebtors(fineId);
+    uint32_t& count = fine.unpaid[driverId];
+    count += static_cast<uint32_t>(delta);
+    if (count == 0) fine.unpaid.erase(driverId);
+    adjust(driverId, delta, fine.cents * delta);
+}
+
+// Изменение долга водителя вместе с его позицией в индексе
+void DebtLedger::adjust(int driverId, int unpaidDelta, int64_t centsDelta) {
+    Debt& debt = debts[driverId];
+    debt.driverId = driverId;
+    byBalance.erase({ debt.cents, driverId });
+    debt.unpaid += static_cast<uint32_t>(unpaidDelta);
+    debt.cents += centsDelta;
+    if (debt.unpaid == 0) {
+        debts.erase(driverId);
+        return;
+    }
+    byBalance.insert({ debt.cents, driverId });
+}
+
+void DebtLedger::clear() {
+    byFine.clear();
+    debts.clear();
+    byBalance.clear();
+}
+
+void DebtLedger::attach(const FineTable* table) {
+    fines = table;
+    for (auto& entry : byFine) repriceFine(entry.first);
+}
+
+void DebtLedger::repriceFine(int fineId) {
+    auto it = byFine.find(fineId);
+    if (it == byFine.end()) return;      // записей с этим штрафом не было
+    FineDebtors& fine = it->second;
+    int64_t cents = fines ? toCents(fines->getAmountById(fineId)) : 0;
+    int64_t change = cents - fine.cents;
+    fine.cents = cents;
+    if (change == 0) return;
+    for (const auto& d : fine.unpaid) adjust(d.first, 0, change * d.second);
+}
+
+DebtLedger::Debt DebtLedger::debtOf(int driverId) const {
+    auto it = debts.find(driverId);
+    if (it != debts.end()) return it->second;
+    Debt none;
+    none.driverId = driverId;
+    return none;
+}
+
+vector<DebtLedger::Debt> DebtLedger::debtors(double minBalance, size_t limit) const {
+    vector<Debt> list;
+    int64_t floor = toCents(minBalance);
+    for (auto it = byBalance.rbegin(); it != byBalance.rend() && it->first > floor; ++it) {
+        if (limit && list.size() == limit) break;
+        list.push_back(debts.at(it->second));
+    }
+    return list;
+}
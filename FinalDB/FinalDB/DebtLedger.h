@@ -0,0 +1,54 @@
+#pragma once
+#include "FineTable.h"
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Долги водителей: число неоплаченных нарушений и непогашенная сумма.
+// Ведётся FineRegistry при каждом изменении записи; суммы — в копейках,
+// чтобы приращения не накапливали ошибку округления. Ставки берутся из
+// присоединённого FineTable и пересчитываются при их изменении
+// (repriceFine) — затрагиваются только водители с долгами по этому штрафу.
+// Упорядоченный индекс по сумме даёт список должников без прохода по реестру.
+class DebtLedger {
+public:
+    struct Debt {
+        int      driverId = -1;
+        uint32_t unpaid = 0;         // неоплаченных нарушений
+        int64_t  cents = 0;          // непогашенная сумма
+        double balance() const { return static_cast<double>(cents) / 100; }
+    };
+
+    // Неоплаченная запись появилась (+1) или исчезла (-1)
+    void add(int driverId, int fineId, int delta);
+    void clear();
+
+    // Ставки из fines: пересчёт всех известных штрафов; новые штрафы
+    // оцениваются при первой записи. Без FineTable ставки нулевые.
+    void attach(const FineTable* fines);
+    void repriceFine(int fineId);
+
+    Debt debtOf(int driverId) const;           // нулевой долг, если записей нет
+    // Должники с суммой больше minBalance по убыванию суммы; limit 0 — все
+    std::vector<Debt> debtors(double minBalance, size_t limit) const;
+    size_t debtorCount() const { return debts.size(); }
+
+    static int64_t toCents(double amount);
+
+private:
+    // Кто и сколько раз не оплатил данный штраф — для пересчёта ставки
+    struct FineDebtors {
+        int64_t cents = 0;
+        std::unordered_map<int, uint32_t> unpaid;   // driverId → записей
+    };
+    const FineTable* fines = nullptr;
+    std::unordered_map<int, FineDebtors> byFine;
+    std::unordered_map<int, Debt> debts;            // только водители с долгом
+    std::set<std::pair<int64_t, int>> byBalance;    // (cents, driverId)
+
+    FineDebtors& fineDebtors(int fineId);
+    void adjust(int driverId, int unpaidDelta, int64_t centsDelta);
+};
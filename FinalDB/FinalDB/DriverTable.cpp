@@ -1,41 +1,28 @@
 #include "DriverTable.h"
+#include "ChangeStream.h"
+#include "Metrics.h"
+#include "SubstringScan.h"
+#include "Validation.h"
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <iomanip>
+#include <algorithm>
 using namespace std;
 
-// Вспомогательные: разбирают дату
-static bool parseDateParts(const string& dateStr, int& day, int& month, int& year) {
-    if (dateStr.size() != 10) return false;
-    if (dateStr[2] != '.' || dateStr[5] != '.') return false;
-    try {
-        day = stoi(dateStr.substr(0, 2)); //(start,length)
-        month = stoi(dateStr.substr(3, 2));
-        year = stoi(dateStr.substr(6, 4));
-    }
-    catch (...) {
-        return false;
+// Удалить из индекса ФИО ровно пару (name, id), не трогая однофамильцев
+static void eraseNameEntry(multimap<string_view, int>& index, string_view name, int id) {
+    auto range = index.equal_range(name);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == id) {
+            index.erase(it);
+            return;
+        }
     }
-    return true;
-}
-
-static int calculateAgeFromBirth(const string& birthDateStr) {
-    int day, month, year;
-    if (!parseDateParts(birthDateStr, day, month, year)) return -1;
-    time_t t = time(nullptr);
-    tm nowStruct;
-    localtime_s(&nowStruct, &t);
-    int cy = nowStruct.tm_year + 1900;
-    int cm = nowStruct.tm_mon + 1;
-    int cd = nowStruct.tm_mday;
-    int age = cy - year;
-    if (cm < month || (cm == month && cd < day)) age--;
-    return age;
 }
 
 DriverTable::DriverTable()
-    : head(new DriverNode(-1, "", "", -1, nullptr)),
+    : head(new DriverNode(-1, InternedString(), InternedString(), -1, nullptr)),
     currentIterator(nullptr),
     currentFilter(nullptr),
     idWidth(5),
@@ -43,7 +30,6 @@ DriverTable::DriverTable()
     birthDateWidth(12),
     cityIdWidth(5)
 {
-    loadFromFile();
 }
 
 DriverTable::~DriverTable() {
@@ -55,7 +41,7 @@ DriverTable::~DriverTable() {
     }
     delete head;
     idToDriverMap.clear();
-    nameToIdMap.clear();
+    nameIndex.clear();
 
     Filter* f = currentFilter;
     while (f) {
@@ -85,7 +71,12 @@ bool DriverTable::loadFromFile(const std::string& filename) {
     }
     head->next = nullptr;
     idToDriverMap.clear();
-    nameToIdMap.clear();
+    nameIndex.clear();
+    nameSearchIndex.clear();
+    cityIndex.clear();
+    nameHeapDirty = true;
+    modified = false;
+    maxDriverId = 0;
 
     std::string line;
     while (std::getline(file, line)) parseLine(line);
@@ -104,17 +95,24 @@ void DriverTable::parseLine(const std::string& line) {
 }
 
 // Добавление узла в список и в хеш-таблицу
-void DriverTable::addDriverNode(int id, const std::string& fullName,
-    const std::string& birthDate, int cityId)
+void DriverTable::addDriverNode(int id, std::string_view fullName,
+    std::string_view birthDate, int cityId)
 {
-    DriverNode* newNode = new DriverNode(id, fullName, birthDate, cityId, head->next);
+    DriverNode* newNode = new DriverNode(id, InternedString(fullName), InternedString(birthDate),
+        cityId, head->next);
+    newNode->prev = head;
+    if (head->next) head->next->prev = newNode;
     head->next = newNode;
     idToDriverMap.insert(id, newNode);
-    nameToIdMap[fullName] = id;
+    cityIndex.insert(cityId, id);
+    nameIndex.emplace(newNode->fullName.view(), id);
+    nameSearchIndex.insert(id, newNode->fullName.view());
+    nameHeapDirty = true;
+    if (id > maxDriverId) maxDriverId = id;
 }
 
 // Добавление водителя (OK)
-void DriverTable::addDriver(const std::string& fullName,
+int DriverTable::addDriver(const std::string& fullName,
     const std::string& birthDate, int cityId)
 {
     if (!validateName(fullName))
@@ -123,28 +121,37 @@ void DriverTable::addDriver(const std::string& fullName,
         throw invalid_argument("Incorrect date format");
     if (!validateAge(birthDate))
         throw invalid_argument("Driver must be between 18 and 100 years old");
+    return insertDriver(fullName, birthDate, cityId);
+}
 
-    int newId = 1;
-    for (auto& pair : nameToIdMap) {
-        if (pair.second >= newId) newId = pair.second + 1;
-    }
+int DriverTable::insertDriver(std::string_view fullName, std::string_view birthDate, int cityId) {
+    int newId = maxDriverId + 1;
     addDriverNode(newId, fullName, birthDate, cityId);
+    modified = true;
+    if (capturing()) changes->emitInsert(cloneInfo(idToDriverMap.find<DriverNode>(newId)));
+    return newId;
 }
 
 // Удаление водителя по ID
 void DriverTable::deleteDriverById(int id) {
-    DriverNode* prev = head;
-    DriverNode* curr = head->next;
-    while (curr) {
-        if (curr->id == id) {
-            prev->next = curr->next;
-            idToDriverMap.remove(id);
-            nameToIdMap.erase(curr->fullName);
-            delete curr;
-            return;
-        }
-        prev = curr;
-        curr = curr->next;
+    DriverNode* node = idToDriverMap.find<DriverNode>(id);
+    if (!node) return;
+    if (capturing()) changes->emitDelete(cloneInfo(node));
+    node->prev->next = node->next;
+    if (node->next) node->next->prev = node->prev;
+    if (currentIterator == node) currentIterator = node->next;
+    idToDriverMap.remove(id);
+    eraseNameEntry(nameIndex, node->fullName, id);
+    nameSearchIndex.remove(id, node->fullName);
+    cityIndex.remove(node->cityId, id);
+    nameHeapDirty = true;
+    modified = true;
+    delete node;
+    if (id == maxDriverId) {
+        // Удалён водитель с наибольшим ID — следующий снова будет max + 1
+        maxDriverId = 0;
+        for (DriverNode* curr = head->next; curr; curr = curr->next)
+            if (curr->id > maxDriverId) maxDriverId = curr->id;
     }
 }
 
@@ -171,9 +178,9 @@ DriverTable::DriverInfo DriverTable::driverIteratorNext() const {
 }
 
 // Геттер: получить ФИО по ID
-std::string DriverTable::getDriverNameById(int id) const {
+std::string_view DriverTable::getDriverNameById(int id) const {
     DriverNode* node = idToDriverMap.find<DriverNode>(id);
-    return node ? node->fullName : "";
+    return node ? node->fullName.view() : std::string_view();
 }
 
 // Геттер: получить ID города для водителя
@@ -186,8 +193,8 @@ int DriverTable::getCityIdForDriver(const std::string& fullName) const {
 
 // Геттер: получить ID по ФИО (в случае дублей возвращает первый попавшийся,
 // если заданы birthDate и cityId — найдет точное совпадение)
-int DriverTable::getDriverId(const std::string& fullName,
-    const std::string& birthDate,
+int DriverTable::getDriverId(std::string_view fullName,
+    std::string_view birthDate,
     int cityId) const
 {
     std::vector<DriverInfo> candidates = findAllByName(fullName);
@@ -221,27 +228,30 @@ int DriverTable::getDriverId(const std::string& fullName,
 }
 
 // Вспомогательное: вернуть всех водителей с данным ФИО
-std::vector<DriverTable::DriverInfo> DriverTable::findAllByName(const std::string& fullName) const {
+std::vector<DriverTable::DriverInfo> DriverTable::findAllByName(std::string_view fullName) const {
     std::vector<DriverInfo> result;
-    DriverNode* curr = head->next;
-    while (curr) {
-        if (curr->fullName == fullName) {
-            result.push_back(cloneInfo(curr));
-        }
-        curr = curr->next;
+    auto range = nameIndex.equal_range(fullName);
+    for (auto it = range.first; it != range.second; ++it) {
+        DriverNode* node = idToDriverMap.find<DriverNode>(it->second);
+        if (node) result.push_back(cloneInfo(node));
     }
     return result;
 }
 
+// Геттер: полная информация о водителе по ID
+bool DriverTable::getDriverById(int id, DriverInfo& out) const {
+    DriverNode* node = idToDriverMap.find<DriverNode>(id);
+    if (!node) return false;
+    out = cloneInfo(node);
+    return true;
+}
+
 // Обновление ссылок при удалении города: устанавливаем cityId = -1
 void DriverTable::updateCityReferences(int deletedCityId) {
-    DriverNode* curr = head->next;
-    while (curr) {
-        if (curr->cityId == deletedCityId) {
-            curr->cityId = -1;
-        }
-        curr = curr->next;
-    }
+    const std::vector<int>* ids = cityIndex.find(deletedCityId);
+    if (!ids) return;
+    std::vector<int> dependents(*ids);   // индекс меняется по ходу
+    for (int id : dependents) updateDriverCity(id, -1);
 }
 
 // Редактирование ФИО
@@ -249,9 +259,15 @@ bool DriverTable::updateDriverName(int id, const std::string& newName) {
     if (!validateName(newName)) return false;
     DriverNode* node = idToDriverMap.find<DriverNode>(id);
     if (!node) return false;
-    nameToIdMap.erase(node->fullName);
-    node->fullName = newName;
-    nameToIdMap[newName] = id;
+    DriverInfo before = cloneInfo(node);
+    eraseNameEntry(nameIndex, node->fullName, id);
+    nameSearchIndex.remove(id, node->fullName);
+    node->fullName = InternedString(newName);
+    nameIndex.emplace(node->fullName.view(), id);
+    nameSearchIndex.insert(id, node->fullName.view());
+    nameHeapDirty = true;
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
@@ -260,7 +276,10 @@ bool DriverTable::updateDriverBirthDate(int id, const std::string& newBirthDate)
     if (!validateDate(newBirthDate) || !validateAge(newBirthDate)) return false;
     DriverNode* node = idToDriverMap.find<DriverNode>(id);
     if (!node) return false;
-    node->birthDate = newBirthDate;
+    DriverInfo before = cloneInfo(node);
+    node->birthDate = InternedString(newBirthDate);
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
@@ -268,26 +287,30 @@ bool DriverTable::updateDriverBirthDate(int id, const std::string& newBirthDate)
 bool DriverTable::updateDriverCity(int id, int newCityId) {
     DriverNode* node = idToDriverMap.find<DriverNode>(id);
     if (!node) return false;
-    node->cityId = newCityId;
+    if (node->cityId != newCityId) {
+        DriverInfo before = cloneInfo(node);
+        cityIndex.remove(node->cityId, id);
+        cityIndex.insert(newCityId, id);
+        node->cityId = newCityId;
+        if (capturing()) changes->emitUpdate(before, cloneInfo(node));
+    }
+    modified = true;
     return true;
 }
 
 // Проверка ФИО
-bool DriverTable::validateName(const std::string& name) const {
-    static const regex pattern("^[A-Za-z\\s]+$");
-    return regex_match(name, pattern);
+bool DriverTable::validateName(const std::string& name) {
+    return Validation::isName(name);
 }
 
 // Проверка формата даты
-bool DriverTable::validateDate(const std::string& date) const {
-    static const regex pattern("^\\d{2}\\.\\d{2}\\.\\d{4}$");
-    return regex_match(date, pattern);
+bool DriverTable::validateDate(const std::string& date) {
+    return Validation::isDate(date);
 }
 
 // Проверка возраста: 18–100
-bool DriverTable::validateAge(const std::string& birthDate) const {
-    int age = calculateAgeFromBirth(birthDate);
-    return age >= 18 && age <= 100;
+bool DriverTable::validateAge(const std::string& birthDate) {
+    return Validation::isDriverAge(birthDate, Validation::today());
 }
 
 // Сохранение в файл
@@ -300,12 +323,13 @@ void DriverTable::saveToFile() const {
     DriverNode* curr = head->next;
     while (curr) {
         file << curr->id << ' '
-            << quoted(curr->fullName) << ' '
-            << quoted(curr->birthDate) << ' '
+            << quoted(curr->fullName.view()) << ' '
+            << quoted(curr->birthDate.view()) << ' '
             << curr->cityId << '\n';
         curr = curr->next;
     }
     file.close();
+    modified = false;
 }
 
 // Добавление фильтра
@@ -337,8 +361,9 @@ bool DriverTable::matchField(const DriverNode* node, const std::string& field,
     int cmpType, const std::string& value) const
 {
     if (field == "fullName") {
-        if (cmpType == 1) return node->fullName.find(value) != string::npos;
+        if (cmpType == 1) return node->fullName.view().find(value) != string::npos;
         if (cmpType == 2) return node->fullName == value;
+        if (cmpType == 5) return node->fullName.view().compare(0, value.size(), value) == 0;
     }
     else if (field == "birthDate") {
         if (cmpType == 2) return node->birthDate == value;
@@ -356,8 +381,70 @@ DriverTable::DriverInfo DriverTable::cloneInfo(const DriverNode* node) const {
     return info;
 }
 
+bool DriverTable::capturing() const {
+    return changes && changes->active();
+}
+
+// Поиск по подстроке / префиксу ФИО
+void DriverTable::nameSearch(const std::string& pattern, bool prefixOnly, std::vector<int>& ids) const {
+    if (prefixOnly) {
+        nameSearchIndex.prefixMatches(pattern, ids);
+        return;
+    }
+    if (!nameSearchIndex.containsCandidates(pattern, ids)) scanNames(pattern, ids);
+}
+
+// Точный ответ "содержит" проходом по упакованной куче ФИО
+void DriverTable::scanNames(const std::string& pattern, std::vector<int>& ids) const {
+    if (nameHeapDirty) {
+        nameHeap.clear();
+        for (DriverNode* curr = head->next; curr; curr = curr->next)
+            nameHeap.add(curr->id, curr->fullName);
+        nameHeapDirty = false;
+    }
+    SubstringScan::scan(nameHeap, pattern, ids);
+    std::sort(ids.begin(), ids.end());
+}
+
+// Кандидаты из индекса ФИО, если среди фильтров есть "содержит"/"начинается с"
+bool DriverTable::indexCandidates(std::vector<int>& ids) const {
+    bool found = false;
+    std::vector<int> tmp;
+    for (Filter* f = currentFilter; f; f = f->next) {
+        if (f->field != "fullName" || (f->cmpType != 1 && f->cmpType != 5)) continue;
+        nameSearch(f->value, f->cmpType == 5, tmp);
+        if (!found || tmp.size() < ids.size()) ids.swap(tmp);
+        found = true;
+    }
+    return found;
+}
+
+// Узел проходит все активные фильтры
+bool DriverTable::matchAll(const DriverNode* node) const {
+    for (Filter* f = currentFilter; f; f = f->next) {
+        if (!matchField(node, f->field, f->cmpType, f->value)) return false;
+    }
+    return true;
+}
+
 // Применение всех активных фильтров, возвращает динамический массив DriverInfo
 DriverTable::DriverInfo* DriverTable::applyFilters(int& outCount) const {
+    FINALDB_METRIC_SCOPE("drivers.applyFilters");
+    std::vector<int> candidates;
+    if (indexCandidates(candidates)) {
+        std::vector<const DriverNode*> matched;
+        for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+            DriverNode* node = idToDriverMap.find<DriverNode>(*it);
+            if (node && matchAll(node)) matched.push_back(node);
+        }
+        outCount = static_cast<int>(matched.size());
+        FINALDB_METRIC_ROWS(candidates.size(), matched.size());
+        if (matched.empty()) return nullptr;
+        DriverInfo* arr = new DriverInfo[matched.size()];
+        for (size_t i = 0; i < matched.size(); ++i) arr[i] = cloneInfo(matched[i]);
+        return arr;
+    }
+
     int count = 0;
     DriverNode* curr = head->next;
     while (curr) {
@@ -373,6 +460,7 @@ DriverTable::DriverInfo* DriverTable::applyFilters(int& outCount) const {
         if (match) count++;
         curr = curr->next;
     }
+    FINALDB_METRIC_ROWS(getDriverCount(), count);
     if (count == 0) {
         outCount = 0;
         return nullptr;
@@ -419,6 +507,7 @@ std::string DriverTable::getFilterDescription(int index) const {
             ostringstream oss;
             if (f->field == "fullName") {
                 if (f->cmpType == 1) oss << "Full Name contains \"" << f->value << "\"";
+                else if (f->cmpType == 5) oss << "Full Name starts with \"" << f->value << "\"";
                 else oss << "Full Name equals \"" << f->value << "\"";
             }
             else if (f->field == "birthDate") {
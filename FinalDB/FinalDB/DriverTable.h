@@ -2,19 +2,25 @@
 #include <string>
 #include <iostream>
 #include <iomanip>
-#include <regex>
 #include <map>
 #include "IntHashMap.h"
+#include "IntMultiIndex.h"
+#include "NgramIndex.h"
+#include "StringPool.h"
+#include "StringHeap.h"
 #include <ctime>
 #include <vector>
 
+class ChangeStream;
+
 class DriverTable {
 public:
     // Структура для передачи информации о водителе
+    // Строки — view в глобальный пул, не копии
     struct DriverInfo {
         int    id;
-        std::string fullName;
-        std::string birthDate;
+        std::string_view fullName;
+        std::string_view birthDate;
         int    cityId;
     };
 
@@ -26,9 +32,15 @@ public:
     bool loadFromFile();
     bool loadFromFile(const std::string& filename);
     void saveToFile() const;
-    void addDriver(const std::string& fullName,
+    // Есть изменения, не записанные в файл
+    bool isModified() const { return modified; }
+    // Возвращает ID нового водителя; неверные поля — invalid_argument
+    int addDriver(const std::string& fullName,
         const std::string& birthDate,
         int cityId);
+    // Вставка без проверок — для строк, уже проверенных Validation
+    // (пакетный импорт); возвращает ID нового водителя
+    int insertDriver(std::string_view fullName, std::string_view birthDate, int cityId);
     void deleteDriverById(int id);
 
     // Итератор по списку водителей
@@ -37,14 +49,21 @@ public:
     DriverInfo driverIteratorNext() const;
 
     // Геттеры
-    int getDriverId(const std::string& fullName,
-        const std::string& birthDate = "",
+    int getDriverId(std::string_view fullName,
+        std::string_view birthDate = std::string_view(),
         int cityId = -1) const;
     int getCityIdForDriver(const std::string& fullName) const;
-    std::string getDriverNameById(int id) const;
-
-    // Обновление ссылок при удалении города
+    std::string_view getDriverNameById(int id) const;   // view из пула, "" если нет
+    bool getDriverById(int id, DriverInfo& out) const;
+    // Поиск по подстроке / префиксу ФИО: n-граммный индекс,
+    // для образцов короче триграммы — векторный проход по куче ФИО.
+    void nameSearch(const std::string& pattern, bool prefixOnly, std::vector<int>& ids) const;
+    int getDriverCount() const { return static_cast<int>(nameIndex.size()); }
+
+    // Обновление ссылок при удалении города (только водители этого города)
     void updateCityReferences(int deletedCityId);
+    // Водители, ссылающиеся на город
+    const IntMultiIndex& getCityIndex() const { return cityIndex; }
 
     // Редактирование данных водителя
     bool updateDriverName(int id, const std::string& newName);
@@ -61,48 +80,63 @@ public:
     void removeFilterAt(int index);
 
     // Вспомогательное: вернуть всех водителей с данным ФИО
-    std::vector<DriverInfo> findAllByName(const std::string& fullName) const;
+    std::vector<DriverInfo> findAllByName(std::string_view fullName) const;
+
+    // Поток изменений (CDC); nullptr — события не выпускаются
+    void setChangeStream(ChangeStream* stream) { changes = stream; }
 
 private:
     // Узел списка водителей
     struct DriverNode {
         int    id;
-        std::string fullName;
-        std::string birthDate;
+        InternedString fullName;
+        InternedString birthDate;
         int    cityId;
         DriverNode* next;
-        DriverNode(int id, const std::string& fullName, const std::string& birthDate,
+        DriverNode* prev;            // для удаления за O(1)
+        DriverNode(int id, InternedString fullName, InternedString birthDate,
             int cityId, DriverNode* next)
             : id(id), fullName(fullName), birthDate(birthDate),
-            cityId(cityId), next(next) {
+            cityId(cityId), next(next), prev(nullptr) {
         }
     };
 
     // Структура фильтра
     struct Filter {
         std::string field;
-        int cmpType; // 1: contains, 2: equals
+        int cmpType; // 1: contains, 2: equals, 5: starts with
         std::string value;
         Filter* next;
     };
 
     DriverNode* head;                 // заголовочный узел
     IntHashMap idToDriverMap;         // поиск по ID
-    std::map<std::string, int> nameToIdMap; // ФИО → ID (хранит только последнее вхождение)
+    std::multimap<std::string_view, int> nameIndex; // ФИО (view из пула) → ID, все однофамильцы
+    IntMultiIndex cityIndex;          // cityId → ID водителей (обратная ссылка)
+    NgramIndex nameSearchIndex;       // подстрока / префикс ФИО
+    mutable StringHeap nameHeap;      // упакованные ФИО для SIMD-поиска
+    mutable bool nameHeapDirty = true;
+    mutable bool modified = false;    // сбрасывается при загрузке и сохранении
     mutable DriverNode* currentIterator;
     Filter* currentFilter;
+    int maxDriverId = 0;              // новый ID — без прохода по таблице
+    ChangeStream* changes = nullptr;
 
     int idWidth, nameWidth, birthDateWidth, cityIdWidth;
 
     void parseLine(const std::string& line);
-    void addDriverNode(int id, const std::string& fullName,
-        const std::string& birthDate, int cityId);
+    void addDriverNode(int id, std::string_view fullName,
+        std::string_view birthDate, int cityId);
 
-    bool validateName(const std::string& name) const;
-    bool validateDate(const std::string& date) const;
-    bool validateAge(const std::string& birthDate) const;
+    static bool validateName(const std::string& name);
+    static bool validateDate(const std::string& date);
+    static bool validateAge(const std::string& birthDate);
 
     bool matchField(const DriverNode* node, const std::string& field,
         int cmpType, const std::string& value) const;
     DriverInfo cloneInfo(const DriverNode* node) const;
+    bool capturing() const;           // у потока изменений есть подписчики
+    bool indexCandidates(std::vector<int>& ids) const;
+    void scanNames(const std::string& pattern, std::vector<int>& ids) const;
+    bool matchAll(const DriverNode* node) const;
 };
\ No newline at end of file
@@ -1,14 +1,22 @@
 ﻿#include "FineRegistry.h"
+#include "ChangeStream.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <iomanip>
 using namespace std;
 
-// Конструктор: инициализация заголовочного узла и загрузка данных
+// Первая строка registry.txt в формате с сегментами
+static const char MANIFEST_TAG[] = "#segments";
+
+// Конструктор (данные — в loadFromFile)
 FineRegistry::FineRegistry()
-    : head(new ViolationNode(-1, -1, -1, -1, false, "", nullptr)),
-    currentIterator(nullptr),
+    : currentIterator(0),
+    recordCount(0),
     recordIdWidth(5),
     driverIdWidth(5),
     cityIdWidth(5),
@@ -16,19 +24,12 @@ FineRegistry::FineRegistry()
     paidWidth(8),
     dateWidth(12)
 {
-    loadFromFile();
+    identities.reset(MIN_IDENTITY_CAPACITY);
 }
 
-// Деструктор: очистка списка и хеш-таблицы
+// Деструктор: блоки строк освобождаются сами
 FineRegistry::~FineRegistry() {
-    ViolationNode* current = head->next;
-    while (current) {
-        ViolationNode* temp = current;
-        current = current->next;
-        delete temp;
-    }
-    delete head;
-    recordToNodeMap.clear();
+    clearFilters();
 }
 
 // Загрузка данных из файла
@@ -42,19 +43,63 @@ bool FineRegistry::loadFromFile(const std::string& filename) {
         std::cerr << "Error opening registry file: " << filename << "\n";
         return false;
     }
+    std::string line;
+    bool segmented = std::getline(file, line) && line.rfind(MANIFEST_TAG, 0) == 0;
+
     // Очистка
-    ViolationNode* curr = head->next;
-    while (curr) {
-        ViolationNode* tmp = curr;
-        curr = curr->next;
-        delete tmp;
+    blocks.clear();
+    currentIterator = 0;
+    dateIndex.clear();
+    driverIndex.clear();
+    cityIndex.clear();
+    fineIndex.clear();
+    rollup.clear();
+    debts.clear();
+    identities.clear();              // при разборе строк ключи не вставляются
+    identityDigest = 0;
+    cold.clear();
+    coldDates.clear();
+    coldDateBase = 0;
+    coldCount = 0;
+    deferLinks = true;
+    recordCount = 0;
+    maxRecordId = 0;
+    dirtySegments.clear();
+    storedSegments.clear();
+    manifestDirty = false;
+
+    if (segmented) {
+        // Строки манифеста: "<сегмент> <файл>", файлы — рядом с манифестом
+        filesystem::path dir = filesystem::path(filename).parent_path();
+        while (std::getline(file, line)) {
+            istringstream iss(line);
+            int segment;
+            string name;
+            if (!(iss >> segment >> name)) continue;
+            ifstream segmentFile(dir / name);
+            if (!segmentFile.is_open()) {
+                cerr << "Error opening registry segment: " << (dir / name).string() << "\n";
+                continue;
+            }
+            string record;
+            while (std::getline(segmentFile, record)) parseLine(record);
+            storedSegments.insert(segment);
+            freezeSegment(segment);      // в памяти — только горячая часть
+        }
+    }
+    else {
+        parseLine(line);
+        while (std::getline(file, line)) parseLine(line);
+        for (int id = maxRecordId; id > 0; id = previousRecord(id)) touch(id);
+        manifestDirty = true;
+        for (int segment = 0; segment < static_cast<int>(blocks.size()); ++segment) freezeSegment(segment);
     }
-    head->next = nullptr;
-    recordToNodeMap.clear();
-
-    std::string line;
-    while (std::getline(file, line)) parseLine(line);
     file.close();
+    deferLinks = false;
+    linkAll();
+    rollup.shrinkToFit();
+    identitiesDirty = !identities.load(bloomFileName(filename), identityStamp());
+    if (identitiesDirty) rebuildIdentities();
     return true;
 }
 
@@ -66,68 +111,279 @@ void FineRegistry::parseLine(const std::string& line) {
     int paidInt;
     string date;
     iss >> recordId >> driverId >> cityId >> fineId >> paidInt >> quoted(date);
+    if (!iss || recordId <= 0) {
+        cerr << "Invalid registry line skipped: " << line << "\n";
+        return;
+    }
 
     bool paid = (paidInt == 1);
-    addViolationNode(recordId, driverId, cityId, fineId, paid, date);
+    addViolationRow(recordId, driverId, cityId, fineId, paid, date);
+}
+
+FineRegistry::ViolationRow* FineRegistry::findRow(int recordId) {
+    return const_cast<ViolationRow*>(static_cast<const FineRegistry*>(this)->findRow(recordId));
+}
+
+const FineRegistry::ViolationRow* FineRegistry::findRow(int recordId) const {
+    if (recordId <= 0) return nullptr;
+    size_t block = static_cast<size_t>(segmentOf(recordId));
+    if (block >= blocks.size() || !blocks[block]) return nullptr;
+    const ViolationRow& row = blocks[block][(recordId - 1) % SEGMENT_RECORDS];
+    return row.live() ? &row : nullptr;
+}
+
+int FineRegistry::previousRecord(int recordId) const {
+    for (int id = recordId - 1; id > 0; --id) {
+        size_t block = static_cast<size_t>(segmentOf(id));
+        const ViolationRow* rows = block < blocks.size() ? blocks[block].get() : nullptr;
+        const ColdSegment* frozen = coldSegment(static_cast<int>(block));
+        if (!rows && !frozen) {
+            id = static_cast<int>(block) * SEGMENT_RECORDS + 1;   // весь блок пуст
+            continue;
+        }
+        int slot = (id - 1) % SEGMENT_RECORDS;
+        if ((rows && rows[slot].live()) || (frozen && frozen->rows.has(slot))) return id;
+    }
+    return 0;
 }
 
-// Добавление узла в список и в хеш-таблицу
-void FineRegistry::addViolationNode(int recordId, int driverId, int cityId,
-    int fineId, bool paid, const std::string& date)
+const FineRegistry::ColdSegment* FineRegistry::coldSegment(int segment) const {
+    return segment >= 0 && static_cast<size_t>(segment) < cold.size() ? cold[segment].get() : nullptr;
+}
+
+bool FineRegistry::readRow(int recordId, ViolationRow& out) const {
+    if (const ViolationRow* row = findRow(recordId)) {
+        out = *row;
+        return true;
+    }
+    const ColdSegment* frozen = recordId > 0 ? coldSegment(segmentOf(recordId)) : nullptr;
+    int slot = (recordId - 1) % SEGMENT_RECORDS;
+    if (!frozen || !frozen->rows.has(slot)) return false;
+    out = hotRow(frozen->rows.row(slot));
+    return true;
+}
+
+bool FineRegistry::isLive(int recordId) const {
+    ViolationRow row;
+    return readRow(recordId, row);
+}
+
+// Холодная запись размораживается вместе со всем сегментом: блок всё равно
+// строится заново, а соседние правки (пакетная оплата, перенос) идут уже
+// по горячим строкам. Назад в холод — при следующем compactCold/загрузке.
+FineRegistry::ViolationRow* FineRegistry::editableRow(int recordId) {
+    ViolationRow* row = findRow(recordId);
+    if (row || recordId <= 0) return row;
+    int slot = (recordId - 1) % SEGMENT_RECORDS;
+    const ColdSegment* frozen = coldSegment(segmentOf(recordId));
+    if (!frozen || !frozen->rows.has(slot)) return nullptr;
+    thawSegment(segmentOf(recordId), [](int, const ColdBlock::Row&) { return true; });
+    return findRow(recordId);
+}
+
+// Запись строки в слот recordId (> 0) и во вторичные индексы
+void FineRegistry::addViolationRow(int recordId, int driverId, int cityId,
+    int fineId, bool paid, std::string_view date)
 {
-    ViolationNode* newNode = new ViolationNode(
-        recordId, driverId, cityId, fineId, paid, date, head->next
-    );
-    head->next = newNode;
-    recordToNodeMap.insert(recordId, newNode);
+    editableRow(recordId);           // повтор холодной записи заменяется в горячем ярусе
+    size_t block = static_cast<size_t>(segmentOf(recordId));
+    if (block >= blocks.size()) blocks.resize(block + 1);
+    if (!blocks[block]) blocks[block].reset(new ViolationRow[SEGMENT_RECORDS]());
+    ViolationRow& row = blocks[block][(recordId - 1) % SEGMENT_RECORDS];
+    if (row.live()) {
+        // Повтор recordId в файле: остаётся последняя строка
+        unindexRow(recordId, row);
+        --recordCount;
+    }
+    row.driverId = driverId;
+    row.cityId = cityId;
+    row.fineId = fineId;
+    row.dateAndFlags = ViolationRow::LIVE;
+    row.setDate(date);
+    row.setPaid(paid);
+    indexRow(recordId, row);
+    ++recordCount;
+    if (recordId > maxRecordId) maxRecordId = recordId;
+}
+
+// Регистрация записи во вторичных индексах, rollup и долгах водителей
+void FineRegistry::indexRow(int recordId, const ViolationRow& row) {
+    int day = dateKey(row.date());
+    linkRow(recordId, row, day);
+    countRow(row, day, +1);
+}
+
+void FineRegistry::unindexRow(int recordId, const ViolationRow& row) {
+    int day = dateKey(row.date());
+    unlinkRow(recordId, row, day);
+    countRow(row, day, -1);
 }
 
-// Добавление нового нарушения (с генерацией recordId)
-void FineRegistry::addViolation(int driverId, int cityId, int fineId, const std::string& date) {
-    // Генерация recordId: максимум существующего +1
-    int newId = 1;
-    ViolationNode* curr = head->next;
-    while (curr) {
-        if (curr->recordId >= newId) newId = curr->recordId + 1;
-        curr = curr->next;
+void FineRegistry::linkRow(int recordId, const ViolationRow& row, int day) {
+    if (deferLinks) return;
+    dateIndex.insert(day, recordId);
+    driverIndex.insert(row.driverId, recordId);
+    cityIndex.insert(row.cityId, recordId);
+    fineIndex.insert(row.fineId, recordId);
+}
+
+void FineRegistry::unlinkRow(int recordId, const ViolationRow& row, int day) {
+    if (deferLinks) return;
+    dateIndex.remove(day, recordId);
+    driverIndex.remove(row.driverId, recordId);
+    cityIndex.remove(row.cityId, recordId);
+    fineIndex.remove(row.fineId, recordId);
+}
+
+// Индексы горячих строк заново, по возрастанию recordId — после загрузки
+// и переноса строк между ярусами; корзины без запаса ёмкости
+void FineRegistry::linkAll() {
+    dateIndex.clear();
+    driverIndex.clear();
+    cityIndex.clear();
+    fineIndex.clear();
+    for (size_t block = 0; block < blocks.size(); ++block) {
+        if (!blocks[block]) continue;
+        for (int i = 0; i < SEGMENT_RECORDS; ++i) {
+            const ViolationRow& row = blocks[block][i];
+            if (row.live())
+                linkRow(static_cast<int>(block) * SEGMENT_RECORDS + i + 1, row, dateKey(row.date()));
+        }
     }
-    addViolationNode(newId, driverId, cityId, fineId, false, date);
+    dateIndex.shrinkToFit();
+    driverIndex.shrinkToFit();
+    cityIndex.shrinkToFit();
+    fineIndex.shrinkToFit();
 }
 
-// Итератор: сброс на начало
+void FineRegistry::countRow(const ViolationRow& row, int day, int delta) {
+    rollup.add(day, row.cityId, row.fineId, row.paid(), delta);
+    if (!row.paid()) debts.add(row.driverId, row.fineId, delta);
+    // Отпечаток следует за множеством ключей, фильтр только пополняется
+    uint64_t key = identityHash(row.driverId, row.cityId, row.fineId, day);
+    identityDigest += delta > 0 ? key : 0 - key;
+    if (delta > 0) identities.insert(key);
+    identitiesDirty = true;
+}
+
+uint64_t FineRegistry::identityHash(int driverId, int cityId, int fineId, int day) {
+    uint64_t a = static_cast<uint64_t>(static_cast<uint32_t>(driverId)) << 32 | static_cast<uint32_t>(cityId);
+    uint64_t b = static_cast<uint64_t>(static_cast<uint32_t>(fineId)) << 32 | static_cast<uint32_t>(day);
+    return BloomFilter::mix(a ^ BloomFilter::mix(b));
+}
+
+uint64_t FineRegistry::identityStamp() const {
+    return BloomFilter::mix(identityDigest ^ static_cast<uint64_t>(recordCount));
+}
+
+std::string FineRegistry::bloomFileName(const std::string& registryFile) {
+    return filesystem::path(registryFile).replace_extension(".bloom").string();
+}
+
+// Фильтр заново по живым строкам, с запасом вдвое; сбрасывает и биты
+// удалённых ключей
+void FineRegistry::rebuildIdentities() {
+    FINALDB_METRIC_SCOPE("registry.rebuildIdentities");
+    size_t capacity = 2 * static_cast<size_t>(recordCount);
+    identities.reset(capacity < MIN_IDENTITY_CAPACITY ? MIN_IDENTITY_CAPACITY : capacity);
+    for (const auto& block : blocks) {
+        if (!block) continue;
+        for (int i = 0; i < SEGMENT_RECORDS; ++i) {
+            const ViolationRow& row = block[i];
+            if (row.live()) identities.insert(identityHash(row.driverId, row.cityId, row.fineId, dateKey(row.date())));
+        }
+    }
+    for (const auto& frozen : cold) {
+        if (!frozen) continue;
+        frozen->rows.forEach([this](int, const ColdBlock::Row& r) {
+            identities.insert(identityHash(r.driverId, r.cityId, r.fineId, unpackDate(r.date)));
+        });
+    }
+    identitiesDirty = true;
+    FINALDB_METRIC_ROWS(recordCount, identities.keyCount());
+}
+
+// Точная проверка — по меньшему из списков индексов водителя и даты
+// (у частых нарушителей записей больше, чем в одном дне), затем по
+// холодным блокам, чей фильтр допускает ключ
+int FineRegistry::findIdentical(int driverId, int cityId, int fineId, std::string_view date) const {
+    ++identityStats.probes;
+    int day = dateKey(date);
+    if (!identities.mayContain(identityHash(driverId, cityId, fineId, day))) {
+        ++identityStats.skipped;
+        return 0;
+    }
+    int found = 0;
+    const vector<int>* byDriver = driverIndex.find(driverId);
+    const vector<int>* byDate = dateIndex.find(day);
+    const vector<int>* ids = !byDriver || (byDate && byDate->size() < byDriver->size()) ? byDate : byDriver;
+    if (ids) {
+        for (int recordId : *ids) {
+            const ViolationRow* row = findRow(recordId);
+            if (recordId > found && row->driverId == driverId && row->cityId == cityId
+                && row->fineId == fineId && row->date() == date)
+                found = recordId;
+        }
+    }
+    uint64_t key = identityHash(driverId, cityId, fineId, day);
+    for (int segment = static_cast<int>(cold.size()) - 1;
+        segment >= 0 && (segment + 1) * SEGMENT_RECORDS > found; --segment) {
+        const ColdSegment* frozen = cold[segment].get();
+        if (!frozen || !frozen->identities.mayContain(key)) continue;
+        frozen->rows.forEach([&](int slot, const ColdBlock::Row& r) {
+            if (r.driverId == driverId && r.cityId == cityId && r.fineId == fineId
+                && unpackDate(r.date) == day && hotRow(r).date() == date)
+                found = max(found, segment * SEGMENT_RECORDS + slot + 1);
+        });
+    }
+    if (!found) ++identityStats.falsePositives;
+    return found;
+}
+
+bool FineRegistry::capturing() const {
+    return changes && changes->active();
+}
+
+void FineRegistry::emitUpdate(const ViolationInfo& before, int recordId, const ViolationRow& row) {
+    if (capturing()) changes->emitUpdate(before, recordInfo(recordId, row));
+}
+
+// Добавление нового нарушения; recordId — максимум существующего + 1
+int FineRegistry::addViolation(int driverId, int cityId, int fineId, std::string_view date) {
+    int newId = maxRecordId + 1;
+    addViolationRow(newId, driverId, cityId, fineId, false, date);
+    touch(newId);
+    if (identities.overfull()) rebuildIdentities();
+    if (capturing()) changes->emitInsert(recordInfo(newId, *findRow(newId)));
+    return newId;
+}
+
+// Итератор: от новых записей к старым (по убыванию recordId)
 void FineRegistry::violationIteratorReset() const {
-    currentIterator = head->next;
+    currentIterator = isLive(maxRecordId) ? maxRecordId : 0;
 }
 
 // Есть ли следующий?
 bool FineRegistry::violationIteratorHasNext() const {
-    return currentIterator != nullptr;
+    return currentIterator != 0;
 }
 
 // Получение следующего с детализированной информацией
 FineRegistry::ViolationInfo FineRegistry::violationIteratorNext(
     const DriverTable& drivers, const CityTable& cities, const FineTable& fines) const
 {
-    ViolationInfo info;
-    if (!currentIterator) return info;
-    info.recordId = currentIterator->recordId;
-    info.driverId = currentIterator->driverId;
-    info.cityId = currentIterator->cityId;
-    info.fineId = currentIterator->fineId;
-    info.paid = currentIterator->paid;
-    info.date = currentIterator->date;
-
-    // Получаем driverName
-    info.driverName = drivers.getDriverNameById(info.driverId);
-
-    // Получаем cityName
-    info.cityName = cities.getCityNameById(info.cityId);
-
-    // Получаем fineType и fineAmount
-    info.fineType = fines.getFineTypeById(info.fineId);
-    info.fineAmount = fines.getAmountById(info.fineId);
-
-    currentIterator = currentIterator->next;
+    ViolationRow row;
+    if (!readRow(currentIterator, row)) return ViolationInfo();
+    ViolationInfo info = getViolationInfo(currentIterator, row, drivers, cities, fines);
+    currentIterator = previousRecord(currentIterator);
+    return info;
+}
+
+FineRegistry::ViolationInfo FineRegistry::violationIteratorNextRecord() const {
+    ViolationRow row;
+    if (!readRow(currentIterator, row)) return ViolationInfo{};
+    ViolationInfo info = recordInfo(currentIterator, row);
+    currentIterator = previousRecord(currentIterator);
     return info;
 }
 
@@ -138,62 +394,97 @@ FineRegistry::ViolationInfo FineRegistry::getViolationById(
     const CityTable& cities,
     const FineTable& fines) const
 {
-    ViolationNode* node = recordToNodeMap.find<ViolationNode>(recordId);
-    if (!node) return ViolationInfo{};
-    ViolationInfo info;
-    info.recordId = node->recordId;
-    info.driverId = node->driverId;
-    info.cityId = node->cityId;
-    info.fineId = node->fineId;
-    info.paid = node->paid;
-    info.date = node->date;
-
-    info.driverName = drivers.getDriverNameById(info.driverId);
-    info.cityName = cities.getCityNameById(info.cityId);
-    info.fineType = fines.getFineTypeById(info.fineId);
-    info.fineAmount = fines.getAmountById(info.fineId);
-
-    return info;
+    ViolationRow row;
+    if (!readRow(recordId, row)) return ViolationInfo{};
+    return getViolationInfo(recordId, row, drivers, cities, fines);
 }
 
 // Пометка оплаченным
 void FineRegistry::markAsPaid(int recordId) {
-    ViolationNode* node = recordToNodeMap.find<ViolationNode>(recordId);
-    if (node) {
-        node->paid = true;
-    }
+    updateViolationPaid(recordId, true);
+}
+
+// Удаление записи: слот освобождается, блок остаётся на месте
+bool FineRegistry::deleteViolation(int recordId) {
+    ViolationRow* row = editableRow(recordId);
+    if (!row) return false;
+    if (capturing()) changes->emitDelete(recordInfo(recordId, *row));
+    if (currentIterator == recordId) currentIterator = previousRecord(recordId);
+    unindexRow(recordId, *row);
+    row->dateAndFlags = 0;
+    touch(recordId);
+    --recordCount;
+    if (recordId == maxRecordId) maxRecordId = previousRecord(recordId);
+    return true;
+}
+
+// Копия списка записей по ключу индекса (индекс меняется по ходу обновления)
+static std::vector<int> dependentRecords(const IntMultiIndex& index, int key) {
+    const std::vector<int>* ids = index.find(key);
+    return ids ? *ids : std::vector<int>();
 }
 
 // Обновление ссылок при удалении водителя (driverId = -1)
 void FineRegistry::updateDriverReferences(int deletedDriverId) {
-    ViolationNode* curr = head->next;
-    while (curr) {
-        if (curr->driverId == deletedDriverId) {
-            curr->driverId = -1;
-        }
-        curr = curr->next;
+    thawReferences(ColdBlock::Column::DRIVER, deletedDriverId);
+    for (int recordId : dependentRecords(driverIndex, deletedDriverId)) {
+        ViolationRow* row = findRow(recordId);
+        ViolationInfo before = recordInfo(recordId, *row);
+        driverIndex.remove(row->driverId, recordId);
+        countRow(*row, -1);
+        row->driverId = -1;
+        countRow(*row, +1);
+        driverIndex.insert(-1, recordId);
+        touch(recordId);
+        emitUpdate(before, recordId, *row);
     }
 }
 
 // Обновление ссылок при удалении города (cityId = -1)
 void FineRegistry::updateCityReferences(int deletedCityId) {
-    ViolationNode* curr = head->next;
-    while (curr) {
-        if (curr->cityId == deletedCityId) {
-            curr->cityId = -1;
-        }
-        curr = curr->next;
+    thawReferences(ColdBlock::Column::CITY, deletedCityId);
+    for (int recordId : dependentRecords(cityIndex, deletedCityId)) {
+        ViolationRow* row = findRow(recordId);
+        ViolationInfo before = recordInfo(recordId, *row);
+        cityIndex.remove(row->cityId, recordId);
+        countRow(*row, -1);
+        row->cityId = -1;
+        countRow(*row, +1);
+        cityIndex.insert(-1, recordId);
+        touch(recordId);
+        emitUpdate(before, recordId, *row);
+    }
+}
+
+// Обновление ссылок при удалении штрафа (fineId = -1)
+void FineRegistry::updateFineReferences(int deletedFineId) {
+    thawReferences(ColdBlock::Column::FINE, deletedFineId);
+    for (int recordId : dependentRecords(fineIndex, deletedFineId)) {
+        ViolationRow* row = findRow(recordId);
+        ViolationInfo before = recordInfo(recordId, *row);
+        fineIndex.remove(row->fineId, recordId);
+        countRow(*row, -1);
+        row->fineId = -1;
+        countRow(*row, +1);
+        fineIndex.insert(-1, recordId);
+        touch(recordId);
+        emitUpdate(before, recordId, *row);
     }
 }
 
 // Обновление cityId у всех нарушений данного водителя
 void FineRegistry::updateViolationsCity(int driverId, int newCityId) {
-    ViolationNode* curr = head->next;
-    while (curr) {
-        if (curr->driverId == driverId) {
-            curr->cityId = newCityId;
-        }
-        curr = curr->next;
+    thawReferences(ColdBlock::Column::DRIVER, driverId);
+    for (int recordId : dependentRecords(driverIndex, driverId)) {
+        ViolationRow* row = findRow(recordId);
+        ViolationInfo before = recordInfo(recordId, *row);
+        cityIndex.remove(row->cityId, recordId);
+        countRow(*row, -1);
+        row->cityId = newCityId;
+        countRow(*row, +1);
+        cityIndex.insert(newCityId, recordId);
+        touch(recordId);
+        emitUpdate(before, recordId, *row);
     }
 }
 
@@ -201,55 +492,129 @@ void FineRegistry::updateViolationsCity(int driverId, int newCityId) {
 
 // Изменить водителя (и cityId) у записи нарушения
 bool FineRegistry::updateViolationDriver(int recordId, int newDriverId, int newCityId) {
-    ViolationNode* node = recordToNodeMap.find<ViolationNode>(recordId);
-    if (!node) return false;
-    node->driverId = newDriverId;
-    node->cityId = newCityId;
+    ViolationRow* row = editableRow(recordId);
+    if (!row) return false;
+    ViolationInfo before = recordInfo(recordId, *row);
+    unindexRow(recordId, *row);
+    row->driverId = newDriverId;
+    row->cityId = newCityId;
+    indexRow(recordId, *row);
+    touch(recordId);
+    emitUpdate(before, recordId, *row);
     return true;
 }
 
 // Изменить тип штрафа (fineId)
 bool FineRegistry::updateViolationFine(int recordId, int newFineId) {
-    ViolationNode* node = recordToNodeMap.find<ViolationNode>(recordId);
-    if (!node) return false;
-    node->fineId = newFineId;
+    ViolationRow* row = editableRow(recordId);
+    if (!row) return false;
+    ViolationInfo before = recordInfo(recordId, *row);
+    fineIndex.remove(row->fineId, recordId);
+    countRow(*row, -1);
+    row->fineId = newFineId;
+    countRow(*row, +1);
+    fineIndex.insert(newFineId, recordId);
+    touch(recordId);
+    emitUpdate(before, recordId, *row);
     return true;
 }
 
 // Изменить дату нарушения
 bool FineRegistry::updateViolationDate(int recordId, const std::string& newDate) {
-    ViolationNode* node = recordToNodeMap.find<ViolationNode>(recordId);
-    if (!node) return false;
-    node->date = newDate;
+    ViolationRow* row = editableRow(recordId);
+    if (!row) return false;
+    ViolationInfo before = recordInfo(recordId, *row);
+    dateIndex.remove(dateKey(row->date()), recordId);
+    countRow(*row, -1);
+    row->setDate(newDate);
+    countRow(*row, +1);
+    dateIndex.insert(dateKey(newDate), recordId);
+    touch(recordId);
+    emitUpdate(before, recordId, *row);
     return true;
 }
 
-// Изменить статус оплаты
+// Изменить статус оплаты. Проверка — по копии строки: холодные записи
+// уже оплачены, и повторная оплата не размораживает их сегмент
 bool FineRegistry::updateViolationPaid(int recordId, bool paid) {
-    ViolationNode* node = recordToNodeMap.find<ViolationNode>(recordId);
-    if (!node) return false;
-    node->paid = paid;
+    ViolationRow current;
+    if (!readRow(recordId, current)) return false;
+    if (current.paid() == paid) return true;
+    ViolationRow* row = editableRow(recordId);
+    ViolationInfo before = recordInfo(recordId, *row);
+    countRow(*row, -1);
+    row->setPaid(paid);
+    countRow(*row, +1);
+    touch(recordId);
+    emitUpdate(before, recordId, *row);
     return true;
 }
 
-// Сохранение данных в файл
+// Сохранение: переписываются только изменённые сегменты
 void FineRegistry::saveToFile() const {
+    for (auto it = dirtySegments.begin(); it != dirtySegments.end(); ) {
+        if (!saveSegment(*it)) return;   // остальные останутся изменёнными
+        it = dirtySegments.erase(it);
+    }
+    // После сегментов: отметка фильтра описывает уже записанные строки
+    if (identitiesDirty && identities.save(bloomFileName("registry.txt"), identityStamp()))
+        identitiesDirty = false;
+    if (manifestDirty) saveManifest();
+}
+
+std::string FineRegistry::segmentFileName(int segment) {
+    char name[32];
+    snprintf(name, sizeof(name), "registry.%06d.txt", segment);
+    return name;
+}
+
+// Записи сегмента — по возрастанию recordId; пустой сегмент удаляется
+bool FineRegistry::saveSegment(int segment) const {
+    const ViolationRow* rows = static_cast<size_t>(segment) < blocks.size() ? blocks[segment].get() : nullptr;
+    const ColdSegment* frozen = coldSegment(segment);
+    int live = frozen ? static_cast<int>(frozen->rows.size()) : 0;
+    for (int i = 0; rows && i < SEGMENT_RECORDS; ++i) live += rows[i].live();
+    std::string name = segmentFileName(segment);
+    if (live == 0) {
+        if (storedSegments.erase(segment)) {
+            error_code ec;
+            filesystem::remove(name, ec);
+            manifestDirty = true;
+        }
+        return true;
+    }
+    ofstream file(name);
+    if (!file.is_open()) {
+        cerr << "Error opening registry segment for writing: " << name << endl;
+        return false;
+    }
+    for (int i = 0; i < SEGMENT_RECORDS; ++i) {
+        ViolationRow row;
+        if (rows && rows[i].live()) row = rows[i];
+        else if (frozen && frozen->rows.has(i)) row = hotRow(frozen->rows.row(i));
+        else continue;
+        file << segment * SEGMENT_RECORDS + i + 1 << ' '
+            << row.driverId << ' '
+            << row.cityId << ' '
+            << row.fineId << ' '
+            << (row.paid() ? 1 : 0) << ' '
+            << quoted(row.date()) << '\n';
+    }
+    file.close();
+    if (storedSegments.insert(segment).second) manifestDirty = true;
+    return true;
+}
+
+void FineRegistry::saveManifest() const {
     ofstream file("registry.txt");
     if (!file.is_open()) {
         cerr << "Error opening registry file for writing!" << endl;
         return;
     }
-    ViolationNode* curr = head->next;
-    while (curr) {
-        file << curr->recordId << ' '
-            << curr->driverId << ' '
-            << curr->cityId << ' '
-            << curr->fineId << ' '
-            << (curr->paid ? 1 : 0) << ' '
-            << quoted(curr->date) << '\n';
-        curr = curr->next;
-    }
+    file << MANIFEST_TAG << ' ' << SEGMENT_RECORDS << '\n';
+    for (int segment : storedSegments) file << segment << ' ' << segmentFileName(segment) << '\n';
     file.close();
+    manifestDirty = false;
 }
 //========== РАБОТА С ФИЛЬТРОМ ==========
 void FineRegistry::addFilter(const std::string& field, int cmpType, const std::string& value) {
@@ -340,39 +705,38 @@ std::vector<FineRegistry::ViolationInfo> FineRegistry::applyFilters(
     const CityTable& cities,
     const FineTable& fines) const
 {
+    FINALDB_METRIC_SCOPE("violations.applyFilters");
     std::vector<ViolationInfo> result;
-    ViolationNode* current = head->next;
-
-    while (current) {
-        if (matchFilter(current, drivers, cities, fines)) {
-            result.push_back(getViolationInfo(current, drivers, cities, fines));
-        }
-        current = current->next;
+    ViolationRow row;
+    for (int id = maxRecordId; id > 0; id = previousRecord(id)) {
+        readRow(id, row);
+        ViolationInfo info = getViolationInfo(id, row, drivers, cities, fines);
+        if (matchFilter(info)) result.push_back(info);
     }
 
+    FINALDB_METRIC_ROWS(recordCount, result.size());
     return result;
 }
 
-static int dateToInt(const std::string& dateStr) {
-    try {
-        return stoi(dateStr.substr(6, 4)) * 10000
-            + stoi(dateStr.substr(3, 2)) * 100
-            + stoi(dateStr.substr(0, 2));
-    }
-    catch (...) {
-        return 0;
-    }
+int FineRegistry::dateKey(std::string_view dateStr) {
+    if (dateStr.size() != 10) return 0;
+    auto digits = [&](size_t pos, size_t len, int& out) {
+        out = 0;
+        for (size_t i = pos; i < pos + len; ++i) {
+            if (dateStr[i] < '0' || dateStr[i] > '9') return false;
+            out = out * 10 + (dateStr[i] - '0');
+        }
+        return true;
+    };
+    int day, month, year;
+    if (!digits(0, 2, day) || !digits(3, 2, month) || !digits(6, 4, year)) return 0;
+    return year * 10000 + month * 100 + day;
 }
 
-bool FineRegistry::matchFilter(const ViolationNode* node,
-    const DriverTable& drivers,
-    const CityTable& cities,
-    const FineTable& fines) const
-{
+bool FineRegistry::matchFilter(const ViolationInfo& vi) const {
     Filter* currentFilter = violationFilters;
     while (currentFilter) {
         bool match = false;
-        ViolationInfo vi = getViolationInfo(node, drivers, cities, fines);
 
         if (currentFilter->field == "driver") {
             match = (vi.driverName == currentFilter->value);
@@ -393,8 +757,8 @@ bool FineRegistry::matchFilter(const ViolationNode* node,
                 : (amount > filterAmount);
         }
         else if (currentFilter->field == "date") {
-            int nodeDate = dateToInt(vi.date);
-            int filterDate = dateToInt(currentFilter->value);
+            int nodeDate = dateKey(vi.date);
+            int filterDate = dateKey(currentFilter->value);
 
             if (currentFilter->cmpType == 3) match = (nodeDate < filterDate);
             else if (currentFilter->cmpType == 4) match = (nodeDate > filterDate);
@@ -406,25 +770,231 @@ bool FineRegistry::matchFilter(const ViolationNode* node,
     return true;
 }
 
-FineRegistry::ViolationInfo FineRegistry::getViolationInfo(
-    const ViolationNode* node,
+// Собственные поля записи, имена связанных строк пустые
+FineRegistry::ViolationInfo FineRegistry::recordInfo(int recordId, const ViolationRow& row) {
+    ViolationInfo info{};
+    info.recordId = recordId;
+    info.driverId = row.driverId;
+    info.cityId = row.cityId;
+    info.fineId = row.fineId;
+    info.paid = row.paid();
+    info.date = row.date();
+    return info;
+}
+
+FineRegistry::ViolationInfo FineRegistry::getViolationInfo(int recordId,
+    const ViolationRow& row,
     const DriverTable& drivers,
     const CityTable& cities,
     const FineTable& fines) const
 {
-    ViolationInfo info;
-    info.recordId = node->recordId;
-    info.driverId = node->driverId;
-    info.cityId = node->cityId;
-    info.fineId = node->fineId;
-    info.paid = node->paid;
-    info.date = node->date;
+    ViolationInfo info = recordInfo(recordId, row);
 
     // Получаем детали из связанных таблиц
-    info.driverName = drivers.getDriverNameById(node->driverId);
-    info.cityName = cities.getCityNameById(node->cityId);
-    info.fineType = fines.getFineTypeById(node->fineId);
-    info.fineAmount = fines.getAmountById(node->fineId);
+    info.driverName = drivers.getDriverNameById(row.driverId);
+    info.cityName = cities.getCityNameById(row.cityId);
+    info.fineType = fines.getFineTypeById(row.fineId);
+    info.fineAmount = fines.getAmountById(row.fineId);
 
     return info;
-}
\ No newline at end of file
+}
+
+bool FineRegistry::findViolation(int recordId, ViolationInfo& out) const {
+    ViolationRow row;
+    if (!readRow(recordId, row)) return false;
+    out = recordInfo(recordId, row);
+    return true;
+}
+
+std::vector<int> FineRegistry::getAllRecordIds() const {
+    std::vector<int> ids;
+    ids.reserve(recordCount);
+    for (int id = maxRecordId; id > 0; id = previousRecord(id)) ids.push_back(id);
+    return ids;
+}
+
+size_t FineRegistry::storageBytes() const {
+    size_t bytes = blocks.capacity() * sizeof(blocks[0]);
+    for (const auto& block : blocks)
+        if (block) bytes += SEGMENT_RECORDS * sizeof(ViolationRow);
+    return bytes;
+}
+//========== ХОЛОДНЫЙ ЯРУС ==========
+
+int FineRegistry::packDate(int key) {
+    int year = key / 10000, month = key / 100 % 100, day = key % 100;
+    if (year < 1900 || year > 2099 || month < 1 || month > 12 || day < 1 || day > 31) return -1;
+    return (year - 1900) * 372 + (month - 1) * 31 + (day - 1);
+}
+
+int FineRegistry::unpackDate(int code) {
+    return (code / 372 + 1900) * 10000 + (code % 372 / 31 + 1) * 100 + code % 31 + 1;
+}
+
+// Оплачена, дата раньше границы и однозначно восстанавливается из кода
+bool FineRegistry::coldEligible(const ViolationRow& row, ColdBlock::Row& out) {
+    if (coldCutoff == 0 || !row.paid()) return false;
+    int key = dateKey(row.date());
+    int code = packDate(key);
+    if (code < 0 || key >= coldCutoff) return false;
+    // Таблица кодов растёт в обе стороны от первого встреченного
+    if (coldDates.empty()) coldDateBase = code;
+    if (code < coldDateBase) {
+        coldDates.insert(coldDates.begin(), coldDateBase - code, 0);
+        coldDateBase = code;
+    }
+    if (code - coldDateBase >= static_cast<int>(coldDates.size())) coldDates.resize(code - coldDateBase + 1);
+    uint32_t& known = coldDates[code - coldDateBase];
+    uint32_t handle = row.dateAndFlags & ViolationRow::DATE_MASK;
+    if (known == 0) known = handle;
+    else if (known != handle) return false;
+    out = { row.driverId, row.cityId, row.fineId, code };
+    return true;
+}
+
+FineRegistry::ViolationRow FineRegistry::hotRow(const ColdBlock::Row& row) const {
+    ViolationRow out;
+    out.driverId = row.driverId;
+    out.cityId = row.cityId;
+    out.fineId = row.fineId;
+    out.dateAndFlags = ViolationRow::LIVE | ViolationRow::PAID | coldDates[row.date - coldDateBase];
+    return out;
+}
+
+int32_t FineRegistry::coldValue(ColdBlock::Column column, const ColdBlock::Row& row) {
+    switch (column) {
+    case ColdBlock::Column::DRIVER: return row.driverId;
+    case ColdBlock::Column::CITY:   return row.cityId;
+    case ColdBlock::Column::FINE:   return row.fineId;
+    default:                        return row.date;
+    }
+}
+
+// Новый блок сегмента (пустой список — блока нет) со своим фильтром ключей
+void FineRegistry::setCold(int segment, const std::vector<ColdBlock::Entry>& entries) {
+    if (static_cast<size_t>(segment) >= cold.size()) cold.resize(segment + 1);
+    if (entries.empty()) {
+        cold[segment].reset();
+        return;
+    }
+    auto frozen = std::make_unique<ColdSegment>(entries);
+    frozen->identities.reset(entries.size());
+    for (const ColdBlock::Entry& e : entries) {
+        const ColdBlock::Row& r = e.row;
+        frozen->identities.insert(identityHash(r.driverId, r.cityId, r.fineId, unpackDate(r.date)));
+    }
+    cold[segment] = std::move(frozen);
+}
+
+// Подходящие горячие строки сегмента — к его холодному блоку (блок
+// строится заново); опустевший горячий блок освобождается
+size_t FineRegistry::freezeSegment(int segment) {
+    if (coldCutoff == 0 || static_cast<size_t>(segment) >= blocks.size() || !blocks[segment]) return 0;
+    ViolationRow* rows = blocks[segment].get();
+    std::vector<ColdBlock::Entry> moved;
+    ColdBlock::Row packed;
+    for (int i = 0; i < SEGMENT_RECORDS; ++i) {
+        if (rows[i].live() && coldEligible(rows[i], packed)) moved.push_back({ i, packed });
+    }
+    if (moved.empty()) return 0;
+
+    int live = 0;
+    for (int i = 0; i < SEGMENT_RECORDS; ++i) live += rows[i].live();
+    for (const ColdBlock::Entry& e : moved) {
+        ViolationRow& row = rows[e.slot];
+        unlinkRow(segment * SEGMENT_RECORDS + e.slot + 1, row, unpackDate(e.row.date));
+        row.dateAndFlags = 0;
+    }
+    if (live == static_cast<int>(moved.size())) blocks[segment].reset();
+    coldCount += static_cast<int>(moved.size());
+
+    if (const ColdSegment* frozen = coldSegment(segment)) {
+        std::vector<ColdBlock::Entry> entries = frozen->rows.entries();
+        entries.insert(entries.end(), moved.begin(), moved.end());
+        sort(entries.begin(), entries.end(),
+            [](const ColdBlock::Entry& a, const ColdBlock::Entry& b) { return a.slot < b.slot; });
+        setCold(segment, entries);
+    }
+    else {
+        setCold(segment, moved);
+    }
+    return moved.size();
+}
+
+template <class Pred>
+size_t FineRegistry::thawSegment(int segment, Pred pred) {
+    const ColdSegment* frozen = coldSegment(segment);
+    if (!frozen) return 0;
+    std::vector<ColdBlock::Entry> keep, thawed;
+    frozen->rows.forEach([&](int slot, const ColdBlock::Row& r) {
+        (pred(slot, r) ? thawed : keep).push_back({ slot, r });
+    });
+    if (thawed.empty()) return 0;
+    if (static_cast<size_t>(segment) >= blocks.size()) blocks.resize(segment + 1);
+    if (!blocks[segment]) blocks[segment].reset(new ViolationRow[SEGMENT_RECORDS]());
+    for (const ColdBlock::Entry& e : thawed) {
+        ViolationRow& row = blocks[segment][e.slot];
+        row = hotRow(e.row);
+        linkRow(segment * SEGMENT_RECORDS + e.slot + 1, row, unpackDate(e.row.date));
+    }
+    coldCount -= static_cast<int>(thawed.size());
+    setCold(segment, keep);
+    return thawed.size();
+}
+
+size_t FineRegistry::compactCold() {
+    FINALDB_METRIC_SCOPE("registry.compactCold");
+    int before = coldCount;
+    deferLinks = true;
+    for (int segment = 0; segment < static_cast<int>(cold.size()); ++segment) {
+        const ColdSegment* frozen = cold[segment].get();
+        if (!frozen || (coldCutoff != 0 && unpackDate(frozen->rows.maxValue(ColdBlock::Column::DATE)) < coldCutoff))
+            continue;
+        thawSegment(segment, [this](int, const ColdBlock::Row& r) {
+            return coldCutoff == 0 || unpackDate(r.date) >= coldCutoff;
+        });
+    }
+    size_t moved = 0;
+    for (int segment = 0; segment < static_cast<int>(blocks.size()); ++segment) moved += freezeSegment(segment);
+    deferLinks = false;
+    if (coldCount != before || moved != 0) linkAll();
+    FINALDB_METRIC_ROWS(recordCount, moved);
+    return moved;
+}
+
+size_t FineRegistry::coldBytes() const {
+    size_t bytes = cold.capacity() * sizeof(cold[0]) + coldDates.capacity() * sizeof(uint32_t);
+    for (const auto& frozen : cold)
+        if (frozen) bytes += sizeof(ColdSegment) - sizeof(ColdBlock) + frozen->rows.bytes() + frozen->identities.bytes();
+    return bytes;
+}
+
+void FineRegistry::collectCold(ColdBlock::Column column, int lo, int hi, std::vector<int>& out) const {
+    bool byDate = column == ColdBlock::Column::DATE;
+    for (size_t segment = 0; segment < cold.size(); ++segment) {
+        const ColdSegment* frozen = cold[segment].get();
+        if (!frozen) continue;
+        int first = frozen->rows.minValue(column), last = frozen->rows.maxValue(column);
+        if (byDate) {
+            first = unpackDate(first);
+            last = unpackDate(last);
+        }
+        if (last < lo || first > hi) continue;
+        int base = static_cast<int>(segment) * SEGMENT_RECORDS + 1;
+        frozen->rows.forEach([&](int slot, const ColdBlock::Row& r) {
+            int value = byDate ? unpackDate(r.date) : coldValue(column, r);
+            if (value >= lo && value <= hi) out.push_back(base + slot);
+        });
+    }
+}
+
+void FineRegistry::thawReferences(ColdBlock::Column column, int key) {
+    for (int segment = 0; segment < static_cast<int>(cold.size()); ++segment) {
+        const ColdSegment* frozen = cold[segment].get();
+        if (!frozen) continue;
+        if (column == ColdBlock::Column::FINE ? !frozen->rows.hasFine(key)
+            : key < frozen->rows.minValue(column) || key > frozen->rows.maxValue(column))
+            continue;
+        thawSegment(segment, [&](int, const ColdBlock::Row& r) { return coldValue(column, r) == key; });
+    }
+}
@@ -1,29 +1,45 @@
 ﻿#pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <map>
+#include <set>
+#include "BloomFilter.h"
+#include "ColdBlock.h"
 #include "IntHashMap.h"
+#include "IntMultiIndex.h"
 #include "DriverTable.h"
 #include "CityTable.h"
 #include "FineTable.h"
+#include "StringPool.h"
+#include "DebtLedger.h"
+#include "ViolationRollup.h"
+
+class ChangeStream;
 
 class FineRegistry {
 private:
-    // Узел списка нарушений
-    struct ViolationNode {
-        int    recordId;
-        int    driverId;
-        int    cityId;
-        int    fineId;
-        bool   paid;
-        std::string date;
-        ViolationNode* next;
-        ViolationNode(int recordId, int driverId, int cityId,
-            int fineId, bool paid, const std::string& date,
-            ViolationNode* next)
-            : recordId(recordId), driverId(driverId), cityId(cityId),
-            fineId(fineId), paid(paid), date(date), next(next) {
+    // Строка нарушения — 16 байт. recordId не хранится: это номер слота.
+    // Дата — id строки в глобальном пуле (до 2^27 строк), в старших
+    // битах того же слова — флаги занятости слота и оплаты.
+    struct ViolationRow {
+        static const uint32_t LIVE = 1u << 31;
+        static const uint32_t PAID = 1u << 30;
+        static const uint32_t DATE_MASK = PAID - 1;
+
+        int32_t  driverId;
+        int32_t  cityId;
+        int32_t  fineId;
+        uint32_t dateAndFlags;       // 0 — слот свободен
+
+        bool live() const { return (dateAndFlags & LIVE) != 0; }
+        bool paid() const { return (dateAndFlags & PAID) != 0; }
+        std::string_view date() const { return StringPool::instance().view(dateAndFlags & DATE_MASK); }
+        void setPaid(bool value) { dateAndFlags = value ? (dateAndFlags | PAID) : (dateAndFlags & ~PAID); }
+        void setDate(std::string_view text) {
+            dateAndFlags = (dateAndFlags & ~DATE_MASK) | InternedString(text).handle();
         }
     };
 public:
@@ -33,14 +49,12 @@ public:
         int cityId;
         int fineId;
         bool paid;
-        // Дополнительная информация
-        std::string date;
-        std::string driverName;
-        std::string cityName;
-        std::string fineType;
+        // Дополнительная информация — view в глобальный пул строк
+        std::string_view date;
+        std::string_view driverName;
+        std::string_view cityName;
+        std::string_view fineType;
         double fineAmount;
-        ViolationNode* next;
-
     };
 
     struct Filter {
@@ -52,20 +66,113 @@ public:
 
 private:
 
-    // Основные поля
-    ViolationNode* head;             // заголовочный узел
-    IntHashMap recordToNodeMap;      // поиск по recordId
-    mutable ViolationNode* currentIterator; // итератор
+    // Основные поля: строки лежат блоками по SEGMENT_RECORDS, блок — сегмент
+    // файла, строка recordId — слот (recordId - 1) % SEGMENT_RECORDS.
+    // Поиск по recordId — индексация, без хеш-таблицы и указателей.
+    std::vector<std::unique_ptr<ViolationRow[]>> blocks;
+    mutable int currentIterator;     // recordId следующей записи, 0 — конец
+    int recordCount;
+    int maxRecordId = 0;             // новый recordId — без прохода по списку
+
+    // Вторичные индексы (используются планировщиком запросов)
+    IntMultiIndex dateIndex;         // дата (YYYYMMDD) → recordId
+    IntMultiIndex driverIndex;       // driverId → recordId
+    IntMultiIndex cityIndex;         // cityId → recordId
+    IntMultiIndex fineIndex;         // fineId → recordId
+    // Счётчики по дням/месяцам/годам × город × штраф
+    ViolationRollup rollup;
+    // Неоплаченные нарушения и долг по водителям
+    DebtLedger debts;
+    ChangeStream* changes = nullptr;
+
+    // Ключи (водитель, город, штраф, дата) для поиска повторов при слиянии
+    // и импорте. Фильтр сохраняется в registry.bloom вместе с отметкой —
+    // суммой хешей ключей живых записей; если при загрузке она не совпала
+    // с прочитанными строками, фильтр строится заново.
+    BloomFilter identities;
+    uint64_t identityDigest = 0;
+    mutable bool identitiesDirty = false;
+
+    // Холодный ярус: оплаченные записи с датой раньше coldCutoff лежат
+    // в сжатых неизменяемых блоках по сегментам и не входят во вторичные
+    // индексы (rollup, долги и фильтр повторов их учитывают). Читаются
+    // по месту; перед правкой записи или проходом по индексу ключа строки
+    // возвращаются в горячий ярус. На диске ярусы не различаются.
+    struct ColdSegment {
+        ColdBlock rows;
+        BloomFilter identities;      // ключи строк блока — для findIdentical
+        explicit ColdSegment(const std::vector<ColdBlock::Entry>& entries) : rows(entries) {}
+    };
+    std::vector<std::unique_ptr<ColdSegment>> cold;
+    // Упакованная дата холодной строки (код - coldDateBase) → строка пула
+    std::vector<uint32_t> coldDates;
+    int coldDateBase = 0;
+    int coldCutoff = 0;
+    int coldCount = 0;
+
+    const ColdSegment* coldSegment(int segment) const;
+    bool coldEligible(const ViolationRow& row, ColdBlock::Row& out);
+    ViolationRow hotRow(const ColdBlock::Row& row) const;
+    void setCold(int segment, const std::vector<ColdBlock::Entry>& entries);
+    size_t freezeSegment(int segment);
+    // Строки сегмента, для которых pred(slot, row), — в горячий ярус
+    template <class Pred>
+    size_t thawSegment(int segment, Pred pred);
+    static int32_t coldValue(ColdBlock::Column column, const ColdBlock::Row& row);
+    static int unpackDate(int code);
 
     // Ширины колонок (для форматированного вывода, не менялись)
     int recordIdWidth, driverIdWidth, cityIdWidth, fineIdWidth, paidWidth, dateWidth;
 
     // Вспомогательные методы
     void parseLine(const std::string& line);
-    void addViolationNode(int recordId, int driverId, int cityId,
-        int fineId, bool paid, const std::string& date);
+    void addViolationRow(int recordId, int driverId, int cityId,
+        int fineId, bool paid, std::string_view date);
+    void indexRow(int recordId, const ViolationRow& row);
+    void unindexRow(int recordId, const ViolationRow& row);
+    // Только вторичные индексы (без rollup и долгов); при загрузке
+    // откладываются до linkAll — холодные строки в индексы не попадают
+    void linkRow(int recordId, const ViolationRow& row, int day);
+    void unlinkRow(int recordId, const ViolationRow& row, int day);
+    void linkAll();
+    bool deferLinks = false;
+    // Вклад строки в rollup и долги: -1 перед изменением водителя, города,
+    // штрафа, даты или оплаты, +1 после
+    void countRow(const ViolationRow& row, int delta) { countRow(row, dateKey(row.date()), delta); }
+    void countRow(const ViolationRow& row, int day, int delta);
+    // Живая строка горячего яруса или nullptr
+    ViolationRow* findRow(int recordId);
+    const ViolationRow* findRow(int recordId) const;
+    // Копия живой строки из любого яруса
+    bool readRow(int recordId, ViolationRow& out) const;
+    bool isLive(int recordId) const;
+    // Строка для правки: холодная сначала возвращается в горячий ярус
+    ViolationRow* editableRow(int recordId);
+    // Ближайшая живая запись с recordId меньше данного (0 — нет)
+    int previousRecord(int recordId) const;
+    static ViolationInfo recordInfo(int recordId, const ViolationRow& row);
+    static uint64_t identityHash(int driverId, int cityId, int fineId, int day);
+    uint64_t identityStamp() const;
+    void rebuildIdentities();
+    static std::string bloomFileName(const std::string& registryFile);
+    bool capturing() const;          // у потока изменений есть подписчики
+    void emitUpdate(const ViolationInfo& before, int recordId, const ViolationRow& row);
+
+    // Хранение по сегментам: запись recordId (> 0) лежит в сегменте
+    // (recordId - 1) / SEGMENT_RECORDS, файл registry.NNNNNN.txt;
+    // registry.txt — манифест со списком сегментов. Сохраняются только
+    // сегменты с изменёнными записями.
+    mutable std::set<int> dirtySegments;
+    mutable std::set<int> storedSegments;    // сегменты, записанные на диск
+    mutable bool manifestDirty = false;
+    static int segmentOf(int recordId) { return recordId > 0 ? (recordId - 1) / SEGMENT_RECORDS : 0; }
+    static std::string segmentFileName(int segment);
+    void touch(int recordId) { dirtySegments.insert(segmentOf(recordId)); }
+    bool saveSegment(int segment) const;
+    void saveManifest() const;
     Filter* violationFilters = nullptr;
-    bool matchFilter(const ViolationNode* node,
+    bool matchFilter(const ViolationInfo& vi) const;
+    ViolationInfo getViolationInfo(int recordId, const ViolationRow& row,
         const DriverTable& drivers,
         const CityTable& cities,
         const FineTable& fines) const;
@@ -77,10 +184,16 @@ public:
 
     // Основные операции
     bool loadFromFile();
+    // Читает и манифест с сегментами, и старый формат одним файлом
+    // (он переводится в сегменты при следующем сохранении)
     bool loadFromFile(const std::string& filename);
+    // Пишет только изменённые сегменты; манифест — если менялся их список
     void saveToFile() const;
-    void addViolation(int driverId, int cityId, int fineId, const std::string& date);
+    bool isModified() const { return !dirtySegments.empty() || manifestDirty || identitiesDirty; }
+    // Возвращает recordId новой записи
+    int addViolation(int driverId, int cityId, int fineId, std::string_view date);
     void markAsPaid(int recordId);
+    bool deleteViolation(int recordId);
 
     // Итератор по списку нарушений (возвращает подробную информацию)
     void violationIteratorReset() const;
@@ -88,6 +201,8 @@ public:
     ViolationInfo violationIteratorNext(const DriverTable& drivers,
         const CityTable& cities,
         const FineTable& fines) const;
+    // То же без имён из связанных таблиц — только собственные поля записи
+    ViolationInfo violationIteratorNextRecord() const;
 
     // Получить одно нарушение по recordId
     ViolationInfo getViolationById(int recordId,
@@ -102,9 +217,11 @@ public:
     int getFilterCount() const;
     std::string getFilterDescription(int index) const;
 
-    // Обновление ссылок при удалении водителя или города
+    // Обновление ссылок при удалении водителя, города или штрафа (→ -1).
+    // Через вторичные индексы: затрагиваются только зависимые записи.
     void updateDriverReferences(int deletedDriverId);
     void updateCityReferences(int deletedCityId);
+    void updateFineReferences(int deletedFineId);
 
     // Обновление городов в уже существующих нарушениях (меняется driverId → cityId)
     void updateViolationsCity(int driverId, int newCityId);
@@ -115,14 +232,70 @@ public:
     bool updateViolationDate(int recordId, const std::string& newDate);
     bool updateViolationPaid(int recordId, bool paid);
 
-    ViolationInfo getViolationInfo(
-        const ViolationNode* node,         // Было ViolationMode* → ошибка!
-        const DriverTable& drivers,
-        const CityTable& cities,
-        const FineTable& fines
-    ) const;
-    
     std::vector<ViolationInfo> applyFilters(const DriverTable& drivers,
         const CityTable& cities,
         const FineTable& fines) const;
+
+    // Только собственные поля записи, без имён из связанных таблиц
+    bool findViolation(int recordId, ViolationInfo& out) const;
+    // Запись с теми же водителем, городом, штрафом и датой (для слияния
+    // и импорта): фильтр Блума отсекает почти все новые ключи, остальные
+    // проверяются по индексу водителя. 0 — нет; при повторах — наибольший recordId
+    int findIdentical(int driverId, int cityId, int fineId, std::string_view date) const;
+    struct IdentityStats {
+        uint64_t probes = 0;
+        uint64_t skipped = 0;          // фильтр ответил "нет"
+        uint64_t falsePositives = 0;   // "может быть", а записи нет
+    };
+    IdentityStats getIdentityStats() const { return identityStats; }
+    const BloomFilter& getIdentityFilter() const { return identities; }
+    std::vector<int> getAllRecordIds() const;
+    int getRecordCount() const { return recordCount; }
+    // Наибольший recordId (записи с меньшими ID могли быть удалены)
+    int getMaxRecordId() const { return maxRecordId; }
+    // Байт под строки записей (без вторичных индексов)
+    size_t storageBytes() const;
+    static size_t rowSize() { return sizeof(ViolationRow); }
+    // Записей в сегменте файла и в блоке строк в памяти
+    static const int SEGMENT_RECORDS = 4096;
+
+    const IntMultiIndex& getDateIndex() const { return dateIndex; }
+    const IntMultiIndex& getDriverIndex() const { return driverIndex; }
+    const IntMultiIndex& getCityIndex() const { return cityIndex; }
+    const IntMultiIndex& getFineIndex() const { return fineIndex; }
+    const ViolationRollup& getRollup() const { return rollup; }
+    const DebtLedger& getDebts() const { return debts; }
+    // Ставки для долгов: при загрузке справочника штрафов и после смены суммы
+    void priceFines(const FineTable* fines) { debts.attach(fines); }
+    void repriceFine(int fineId) { debts.repriceFine(fineId); }
+    // Поток изменений (CDC); nullptr — события не выпускаются
+    void setChangeStream(ChangeStream* stream) { changes = stream; }
+
+    // Холодный ярус. cutoff — YYYYMMDD: оплаченные записи с датой раньше
+    // уходят в сжатые блоки при загрузке и compactCold(); 0 — ярус выключен
+    void setColdCutoff(int cutoff) { coldCutoff = cutoff; }
+    int getColdCutoff() const { return coldCutoff; }
+    // Подходящие записи горячего яруса — в холодный, переставшие подходить
+    // (граница сдвинута назад или ярус выключен) — обратно; возвращает
+    // число записей, ушедших в холодный ярус
+    size_t compactCold();
+    int getColdCount() const { return coldCount; }
+    size_t coldBytes() const;
+    // recordId холодных записей со значением колонки в [lo, hi]
+    // (дата — YYYYMMDD); дополняют выборки по вторичным индексам
+    void collectCold(ColdBlock::Column column, int lo, int hi, std::vector<int>& out) const;
+    // Холодные записи, ссылающиеся на водителя, город или штраф key, —
+    // в горячий ярус, чтобы индекс по key был полным
+    void thawReferences(ColdBlock::Column column, int key);
+    // YYYYMMDD → код даты 1900–2099 (-1 вне диапазона или некорректна)
+    static int packDate(int key);
+
+    // Начальная ёмкость фильтра; при перестройке — вдвое больше числа записей
+    static const size_t MIN_IDENTITY_CAPACITY = 4096;
+
+    // "DD.MM.YYYY" → YYYYMMDD (0, если дата некорректна)
+    static int dateKey(std::string_view dateStr);
+
+private:
+    mutable IdentityStats identityStats;
 };
\ No newline at end of file
@@ -1,12 +1,16 @@
 ﻿#include "FineTable.h"
+#include "ChangeStream.h"
+#include "Metrics.h"
+#include "SubstringScan.h"
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <iomanip>
+#include <algorithm>
 using namespace std;
 
 FineTable::FineTable()
-    : head(new FineNode(-1, 0.0, "", Severity::LIGHT, nullptr)),
+    : head(new FineNode(-1, 0.0, InternedString(), Severity::LIGHT, nullptr)),
     currentIterator(nullptr),
     currentFilter(nullptr),
     idWidth(5),
@@ -14,7 +18,6 @@ FineTable::FineTable()
     typeWidth(30),
     severityWidth(8)
 {
-    loadFromFile();
 }
 
 FineTable::~FineTable() {
@@ -56,6 +59,9 @@ bool FineTable::loadFromFile(const std::string& filename) {
     head->next = nullptr;
     idToFineMap.clear();
     typeToIdMap.clear();
+    typeSearchIndex.clear();
+    typeHeapDirty = true;
+    modified = false;
 
     std::string line;
     while (std::getline(file, line)) parseLine(line);
@@ -78,16 +84,18 @@ void FineTable::parseLine(const std::string& line) {
     addFineNode(id, amount, type, severity);
 }
 
-void FineTable::addFineNode(int id, double amount, const std::string& type,
+void FineTable::addFineNode(int id, double amount, std::string_view type,
     Severity severity)
 {
-    FineNode* newNode = new FineNode(id, amount, type, severity, head->next);
+    FineNode* newNode = new FineNode(id, amount, InternedString(type), severity, head->next);
     head->next = newNode;
     idToFineMap.insert(id, newNode);
-    typeToIdMap[type] = id;
+    typeToIdMap[newNode->type.view()] = id;
+    typeSearchIndex.insert(id, newNode->type.view());
+    typeHeapDirty = true;
 }
 
-void FineTable::addFine(const std::string& type, double amount,
+void FineTable::addFine(std::string_view type, double amount,
     Severity severity)
 {
     if (typeToIdMap.count(type))
@@ -98,6 +106,8 @@ void FineTable::addFine(const std::string& type, double amount,
         if (pair.second >= newId) newId = pair.second + 1;
     }
     addFineNode(newId, amount, type, severity);
+    modified = true;
+    if (capturing()) changes->emitInsert(cloneInfo(idToFineMap.find<FineNode>(newId)));
 }
 
 void FineTable::deleteFine(const std::string& type) {
@@ -108,9 +118,13 @@ void FineTable::deleteFine(const std::string& type) {
     FineNode* curr = head->next;
     while (curr) {
         if (curr->id == id) {
+            if (capturing()) changes->emitDelete(cloneInfo(curr));
             prev->next = curr->next;
             idToFineMap.remove(id);
             typeToIdMap.erase(type);
+            typeSearchIndex.remove(id, curr->type);
+            typeHeapDirty = true;
+            modified = true;
             delete curr;
             return;
         }
@@ -129,12 +143,13 @@ void FineTable::saveToFile() const {
     while (curr) {
         file << curr->id << ' '
             << curr->amount << ' '
-            << quoted(curr->type) << ' '
+            << quoted(curr->type.view()) << ' '
             << quoted(severityToString(curr->severity))
             << '\n';
         curr = curr->next;
     }
     file.close();
+    modified = false;
 }
 
 void FineTable::fineIteratorReset() const {
@@ -156,7 +171,7 @@ FineTable::FineInfo FineTable::fineIteratorNext() const {
     return info;
 }
 
-int FineTable::getFineIdByType(const std::string& type) const {
+int FineTable::getFineIdByType(std::string_view type) const {
     auto it = typeToIdMap.find(type);
     return (it != typeToIdMap.end()) ? it->second : -1;
 }
@@ -175,32 +190,51 @@ std::string FineTable::severityToString(Severity severity) {
     }
 }
 
-std::string FineTable::getFineTypeById(int id) const {
+std::string_view FineTable::getFineTypeById(int id) const {
     FineNode* node = idToFineMap.find<FineNode>(id);
-    return node ? node->type : "";
+    return node ? node->type.view() : std::string_view();
+}
+
+bool FineTable::getFineById(int id, FineInfo& out) const {
+    FineNode* node = idToFineMap.find<FineNode>(id);
+    if (!node) return false;
+    out = cloneInfo(node);
+    return true;
 }
 
 bool FineTable::updateFineType(int id, const std::string& newType) {
     if (typeToIdMap.count(newType)) return false;
     FineNode* node = idToFineMap.find<FineNode>(id);
     if (!node) return false;
-    typeToIdMap.erase(node->type);
-    node->type = newType;
-    typeToIdMap[newType] = id;
+    FineInfo before = cloneInfo(node);
+    typeToIdMap.erase(node->type.view());
+    typeSearchIndex.remove(id, node->type.view());
+    node->type = InternedString(newType);
+    typeToIdMap[node->type.view()] = id;
+    typeSearchIndex.insert(id, node->type.view());
+    typeHeapDirty = true;
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
 bool FineTable::updateFineAmount(int id, double newAmount) {
     FineNode* node = idToFineMap.find<FineNode>(id);
     if (!node) return false;
+    FineInfo before = cloneInfo(node);
     node->amount = newAmount;
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
 bool FineTable::updateFineSeverity(int id, Severity newSeverity) {
     FineNode* node = idToFineMap.find<FineNode>(id);
     if (!node) return false;
+    FineInfo before = cloneInfo(node);
     node->severity = newSeverity;
+    modified = true;
+    if (capturing()) changes->emitUpdate(before, cloneInfo(node));
     return true;
 }
 
@@ -230,8 +264,9 @@ bool FineTable::matchField(const FineNode* node, const std::string& field,
     int cmpType, const std::string& value) const
 {
     if (field == "type") {
-        if (cmpType == 1) return node->type.find(value) != string::npos;
+        if (cmpType == 1) return node->type.view().find(value) != string::npos;
         if (cmpType == 2) return node->type == value;
+        if (cmpType == 5) return node->type.view().compare(0, value.size(), value) == 0;
     }
     else if (field == "amount") {
         double v = stod(value);
@@ -250,7 +285,61 @@ bool FineTable::matchField(const FineNode* node, const std::string& field,
     return false;
 }
 
+void FineTable::typeSearch(const std::string& pattern, bool prefixOnly, std::vector<int>& ids) const {
+    if (prefixOnly) {
+        typeSearchIndex.prefixMatches(pattern, ids);
+        return;
+    }
+    if (!typeSearchIndex.containsCandidates(pattern, ids)) scanTypes(pattern, ids);
+}
+
+void FineTable::scanTypes(const std::string& pattern, std::vector<int>& ids) const {
+    if (typeHeapDirty) {
+        typeHeap.clear();
+        for (FineNode* curr = head->next; curr; curr = curr->next)
+            typeHeap.add(curr->id, curr->type);
+        typeHeapDirty = false;
+    }
+    SubstringScan::scan(typeHeap, pattern, ids);
+    std::sort(ids.begin(), ids.end());
+}
+
+bool FineTable::indexCandidates(std::vector<int>& ids) const {
+    bool found = false;
+    std::vector<int> tmp;
+    for (Filter* f = currentFilter; f; f = f->next) {
+        if (f->field != "type" || (f->cmpType != 1 && f->cmpType != 5)) continue;
+        typeSearch(f->value, f->cmpType == 5, tmp);
+        if (!found || tmp.size() < ids.size()) ids.swap(tmp);
+        found = true;
+    }
+    return found;
+}
+
+bool FineTable::matchAll(const FineNode* node) const {
+    for (Filter* f = currentFilter; f; f = f->next) {
+        if (!matchField(node, f->field, f->cmpType, f->value)) return false;
+    }
+    return true;
+}
+
 FineTable::FineInfo* FineTable::applyFilters(int& outCount) const {
+    FINALDB_METRIC_SCOPE("fines.applyFilters");
+    std::vector<int> candidates;
+    if (indexCandidates(candidates)) {
+        std::vector<const FineNode*> matched;
+        for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+            FineNode* node = idToFineMap.find<FineNode>(*it);
+            if (node && matchAll(node)) matched.push_back(node);
+        }
+        outCount = static_cast<int>(matched.size());
+        FINALDB_METRIC_ROWS(candidates.size(), matched.size());
+        if (matched.empty()) return nullptr;
+        FineInfo* arr = new FineInfo[matched.size()];
+        for (size_t i = 0; i < matched.size(); ++i) arr[i] = cloneInfo(matched[i]);
+        return arr;
+    }
+
     int count = 0;
     FineNode* curr = head->next;
     while (curr) {
@@ -266,6 +355,7 @@ FineTable::FineInfo* FineTable::applyFilters(int& outCount) const {
         if (match) count++;
         curr = curr->next;
     }
+    FINALDB_METRIC_ROWS(typeToIdMap.size(), count);
     if (count == 0) {
         outCount = 0;
         return nullptr;
@@ -301,6 +391,10 @@ FineTable::FineInfo FineTable::cloneInfo(const FineNode* node) const {
     return info;
 }
 
+bool FineTable::capturing() const {
+    return changes && changes->active();
+}
+
 int FineTable::getFilterCount() const {
     int count = 0;
     Filter* f = currentFilter;
@@ -319,6 +413,7 @@ std::string FineTable::getFilterDescription(int index) const {
             ostringstream oss;
             if (f->field == "type") {
                 if (f->cmpType == 1) oss << "Type contains \"" << f->value << "\"";
+                else if (f->cmpType == 5) oss << "Type starts with \"" << f->value << "\"";
                 else oss << "Type equals \"" << f->value << "\"";
             }
             else if (f->field == "amount") {
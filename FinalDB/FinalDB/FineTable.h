@@ -1,17 +1,25 @@
 ﻿#pragma once
+#include <cstdint>
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <map>
 #include "IntHashMap.h"
+#include "NgramIndex.h"
+#include "StringPool.h"
+#include "StringHeap.h"
+#include <vector>
+
+class ChangeStream;
 
 class FineTable {
 public:
-    enum class Severity { LIGHT, MEDIUM, HEAVY };
+    enum class Severity : uint8_t { LIGHT, MEDIUM, HEAVY };
+    // type — view в глобальный пул, не копия
     struct FineInfo {
         int    id;
         double amount;
-        std::string type;
+        std::string_view type;
         Severity severity;
     };
 
@@ -21,7 +29,9 @@ public:
     bool loadFromFile();
     bool loadFromFile(const std::string& filename);
     void saveToFile() const;
-    void addFine(const std::string& type, double amount,
+    // Есть изменения, не записанные в файл
+    bool isModified() const { return modified; }
+    void addFine(std::string_view type, double amount,
         Severity severity = Severity::LIGHT);
     void deleteFine(const std::string& type);
 
@@ -38,24 +48,32 @@ public:
     bool fineIteratorHasNext() const;
     FineInfo fineIteratorNext() const;
 
-    int getFineIdByType(const std::string& type) const;
+    int getFineIdByType(std::string_view type) const;
     double getAmountById(int id) const;
 
     static std::string severityToString(Severity severity);
-    std::string getFineTypeById(int id) const;
+    std::string_view getFineTypeById(int id) const;   // view из пула, "" если нет
+    bool getFineById(int id, FineInfo& out) const;
+    // Поиск по подстроке / префиксу типа: n-граммный индекс,
+    // для образцов короче триграммы — векторный проход по куче типов.
+    void typeSearch(const std::string& pattern, bool prefixOnly, std::vector<int>& ids) const;
+    int getFineCount() const { return static_cast<int>(typeToIdMap.size()); }
 
     bool updateFineType(int id, const std::string& newType);
     bool updateFineAmount(int id, double newAmount);
     bool updateFineSeverity(int id, Severity newSeverity);
 
+    // Поток изменений (CDC); nullptr — события не выпускаются
+    void setChangeStream(ChangeStream* stream) { changes = stream; }
+
 private:
     struct FineNode {
         int    id;
         double amount;
-        std::string type;
+        InternedString type;
         Severity severity;
         FineNode* next;
-        FineNode(int id, double amount, const std::string& type,
+        FineNode(int id, double amount, InternedString type,
             Severity severity, FineNode* next)
             : id(id), amount(amount), type(type),
             severity(severity), next(next) {
@@ -64,24 +82,33 @@ private:
 
     struct Filter {
         std::string field;
-        int cmpType; // 1: contains, 2: equals, 3: <, 4: >
+        int cmpType; // 1: contains, 2: equals, 3: <, 4: >, 5: starts with
         std::string value;
         Filter* next;
     };
 
     FineNode* head;
     IntHashMap idToFineMap;
-    std::map<std::string, int> typeToIdMap;
+    std::map<std::string_view, int> typeToIdMap;   // ключи — view из пула
+    NgramIndex typeSearchIndex;      // подстрока / префикс типа
+    mutable StringHeap typeHeap;     // упакованные типы для SIMD-поиска
+    mutable bool typeHeapDirty = true;
+    mutable bool modified = false;    // сбрасывается при загрузке и сохранении
     mutable FineNode* currentIterator;
+    ChangeStream* changes = nullptr;
 
     Filter* currentFilter;
 
     int idWidth, amountWidth, typeWidth, severityWidth;
 
     void parseLine(const std::string& line);
-    void addFineNode(int id, double amount, const std::string& type,
+    void addFineNode(int id, double amount, std::string_view type,
         Severity severity);
     bool matchField(const FineNode* node, const std::string& field,
         int cmpType, const std::string& value) const;
     FineInfo cloneInfo(const FineNode* node) const;
+    bool capturing() const;          // у потока изменений есть подписчики
+    bool indexCandidates(std::vector<int>& ids) const;
+    void scanTypes(const std::string& pattern, std::vector<int>& ids) const;
+    bool matchAll(const FineNode* node) const;
 };
\ No newline at end of file
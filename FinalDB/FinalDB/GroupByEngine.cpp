@@ -0,0 +1,315 @@
+#include "GroupByEngine.h"
+#include "Metrics.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+using namespace std;
+
+namespace {
+
+struct GroupKey {
+    int v[GroupByEngine::MAX_DIMENSIONS];
+    bool operator==(const GroupKey& o) const {
+        return equal(begin(v), end(v), begin(o.v));
+    }
+};
+
+struct GroupKeyHash {
+    size_t operator()(const GroupKey& k) const {
+        uint64_t h = 0;
+        for (int x : k.v) h = (h ^ static_cast<uint32_t>(x)) * 0x100000001b3ull;
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+// Часть выбирается старшими битами: младшие использует сама хеш-таблица
+int partitionOf(size_t hash, int partitions) {
+    if (partitions == 1) return 0;
+    return static_cast<int>((static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15ull >> 32)
+        % static_cast<uint64_t>(partitions));
+}
+
+using GroupMap = unordered_map<GroupKey, GroupByEngine::Group, GroupKeyHash>;
+
+// Атрибуты справочников по ID — плотные массивы, читаются потоками без блокировок
+struct CityAttrs {
+    int grade = -1, type = -1;
+};
+struct FineAttrs {
+    bool present = false;
+    double amount = 0;
+    int severity = -1;
+};
+
+void accumulate(GroupByEngine::Group& g, bool paid, double amount, int date) {
+    ++g.count;
+    if (paid) ++g.paid;
+    g.amount += amount;
+    if (date == 0) return;
+    if (g.minDate == 0 || date < g.minDate) g.minDate = date;
+    if (date > g.maxDate) g.maxDate = date;
+}
+
+void mergeInto(GroupByEngine::Group& to, const GroupByEngine::Group& from) {
+    to.count += from.count;
+    to.paid += from.paid;
+    to.amount += from.amount;
+    if (from.minDate != 0 && (to.minDate == 0 || from.minDate < to.minDate)) to.minDate = from.minDate;
+    to.maxDate = max(to.maxDate, from.maxDate);
+}
+
+string formatDate(int key) {
+    if (key == 0) return "-";
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%02d.%02d.%04d", key % 100, key / 100 % 100, key / 10000);
+    return buf;
+}
+
+string lower(string s) {
+    for (char& c : s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+// Имена через запятую и/или пробел
+vector<string> splitNames(const string& text) {
+    vector<string> names;
+    string cur;
+    for (char c : text) {
+        if (c == ',' || isspace(static_cast<unsigned char>(c))) {
+            if (!cur.empty()) names.push_back(lower(cur));
+            cur.clear();
+        }
+        else cur += c;
+    }
+    if (!cur.empty()) names.push_back(lower(cur));
+    return names;
+}
+
+const GroupByEngine::Dimension ALL_DIMENSIONS[] = {
+    GroupByEngine::Dimension::CITY, GroupByEngine::Dimension::GRADE,
+    GroupByEngine::Dimension::SETTLEMENT, GroupByEngine::Dimension::FINE,
+    GroupByEngine::Dimension::SEVERITY, GroupByEngine::Dimension::MONTH,
+    GroupByEngine::Dimension::DRIVER
+};
+const GroupByEngine::Measure ALL_MEASURES[] = {
+    GroupByEngine::Measure::COUNT, GroupByEngine::Measure::SUM,
+    GroupByEngine::Measure::AVG, GroupByEngine::Measure::MIN_DATE,
+    GroupByEngine::Measure::MAX_DATE, GroupByEngine::Measure::PAID_RATIO
+};
+
+} // namespace
+
+GroupByEngine::GroupByEngine(const CityTable& cities, const DriverTable& drivers,
+    const FineTable& fines, const FineRegistry& registry)
+    : cities(cities), drivers(drivers), fines(fines), registry(registry) {
+}
+
+const char* GroupByEngine::dimensionName(Dimension dimension) {
+    switch (dimension) {
+    case Dimension::CITY:       return "city";
+    case Dimension::GRADE:      return "grade";
+    case Dimension::SETTLEMENT: return "settlement";
+    case Dimension::FINE:       return "fine";
+    case Dimension::SEVERITY:   return "severity";
+    case Dimension::MONTH:      return "month";
+    case Dimension::DRIVER:     return "driver";
+    }
+    return "?";
+}
+
+const char* GroupByEngine::measureName(Measure measure) {
+    switch (measure) {
+    case Measure::COUNT:      return "count";
+    case Measure::SUM:        return "sum";
+    case Measure::AVG:        return "avg";
+    case Measure::MIN_DATE:   return "min_date";
+    case Measure::MAX_DATE:   return "max_date";
+    case Measure::PAID_RATIO: return "paid_ratio";
+    }
+    return "?";
+}
+
+GroupByEngine::Spec GroupByEngine::parseSpec(const string& dimensions, const string& measures) {
+    Spec spec;
+    for (const string& name : splitNames(dimensions)) {
+        auto it = find_if(begin(ALL_DIMENSIONS), end(ALL_DIMENSIONS),
+            [&](Dimension d) { return name == dimensionName(d); });
+        if (it == end(ALL_DIMENSIONS)) throw invalid_argument("Unknown group-by dimension: " + name);
+        if (find(spec.dimensions.begin(), spec.dimensions.end(), *it) != spec.dimensions.end())
+            throw invalid_argument("Dimension listed twice: " + name);
+        spec.dimensions.push_back(*it);
+    }
+    for (const string& name : splitNames(measures)) {
+        auto it = find_if(begin(ALL_MEASURES), end(ALL_MEASURES),
+            [&](Measure m) { return name == measureName(m); });
+        if (it == end(ALL_MEASURES)) throw invalid_argument("Unknown measure: " + name);
+        if (find(spec.measures.begin(), spec.measures.end(), *it) != spec.measures.end())
+            throw invalid_argument("Measure listed twice: " + name);
+        spec.measures.push_back(*it);
+    }
+    return spec;
+}
+
+GroupByEngine::Result GroupByEngine::run(const Spec& spec) const {
+    FINALDB_METRIC_SCOPE("stats.groupBy");
+    if (spec.dimensions.size() > static_cast<size_t>(MAX_DIMENSIONS))
+        throw invalid_argument("Too many group-by dimensions");
+    Result result;
+    result.spec = spec;
+    if (result.spec.measures.empty())
+        result.spec.measures.assign(begin(ALL_MEASURES), end(ALL_MEASURES));
+
+    // Справочники — в плотные массивы до запуска потоков
+    vector<CityAttrs> cityAttrs;
+    cities.cityIteratorReset();
+    while (cities.cityIteratorHasNext()) {
+        CityTable::CityInfo c = cities.cityIteratorNext();
+        if (c.id < 0) continue;
+        if (c.id >= static_cast<int>(cityAttrs.size())) cityAttrs.resize(static_cast<size_t>(c.id) + 1);
+        cityAttrs[c.id] = { static_cast<int>(c.grade), static_cast<int>(c.type) };
+    }
+    vector<FineAttrs> fineAttrs;
+    fines.fineIteratorReset();
+    while (fines.fineIteratorHasNext()) {
+        FineTable::FineInfo f = fines.fineIteratorNext();
+        if (f.id < 0) continue;
+        if (f.id >= static_cast<int>(fineAttrs.size())) fineAttrs.resize(static_cast<size_t>(f.id) + 1);
+        fineAttrs[f.id] = { true, f.amount, static_cast<int>(f.severity) };
+    }
+
+    const int maxId = registry.getMaxRecordId();
+    const bool parallel = registry.getRecordCount() >= PARALLEL_ROWS;
+    ThreadPool pool(parallel ? 0 : 1);
+    const unsigned threads = parallel ? pool.size() : 1;
+    const int partitions = threads > 1 ? PARTITIONS : 1;
+    result.threads = threads;
+
+    // 1) Каждый поток — свой диапазон recordId, группы раскладываются по частям
+    vector<vector<GroupMap>> local(threads, vector<GroupMap>(static_cast<size_t>(partitions)));
+    vector<size_t> scanned(threads, 0);
+    const vector<Dimension>& dims = spec.dimensions;
+    auto scan = [&](unsigned t) {
+        int step = maxId / static_cast<int>(threads) + 1;
+        int from = 1 + static_cast<int>(t) * step;
+        int to = min(maxId, from + step - 1);
+        FineRegistry::ViolationInfo v;
+        GroupKey key{};
+        for (int id = from; id <= to; ++id) {
+            if (!registry.findViolation(id, v)) continue;
+            ++scanned[t];
+            const CityAttrs* city = v.cityId >= 0 && v.cityId < static_cast<int>(cityAttrs.size())
+                ? &cityAttrs[v.cityId] : nullptr;
+            const FineAttrs* fine = v.fineId >= 0 && v.fineId < static_cast<int>(fineAttrs.size())
+                && fineAttrs[v.fineId].present ? &fineAttrs[v.fineId] : nullptr;
+            int date = FineRegistry::dateKey(v.date);
+            for (size_t d = 0; d < dims.size(); ++d) {
+                int value = -1;
+                switch (dims[d]) {
+                case Dimension::CITY:       value = v.cityId; break;
+                case Dimension::GRADE:      value = city ? city->grade : -1; break;
+                case Dimension::SETTLEMENT: value = city ? city->type : -1; break;
+                case Dimension::FINE:       value = v.fineId; break;
+                case Dimension::SEVERITY:   value = fine ? fine->severity : -1; break;
+                case Dimension::MONTH:      value = date / 100; break;
+                case Dimension::DRIVER:     value = v.driverId; break;
+                }
+                key.v[d] = value;
+            }
+            GroupMap& part = local[t][partitionOf(GroupKeyHash()(key), partitions)];
+            accumulate(part[key], v.paid, fine ? fine->amount : 0, date);
+        }
+    };
+    for (unsigned t = 0; t < threads; ++t) pool.submit([&scan, t] { scan(t); });
+    pool.wait();
+
+    // 2) Части сливаются независимо: итог части — в таблице первого потока
+    pool.parallelFor(static_cast<size_t>(partitions), [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p)
+            for (unsigned t = 1; t < threads; ++t) {
+                for (const auto& entry : local[t][p]) mergeInto(local[0][p][entry.first], entry.second);
+                GroupMap().swap(local[t][p]);
+            }
+    });
+
+    for (unsigned t = 0; t < threads; ++t) result.rowsScanned += scanned[t];
+    for (GroupMap& part : local[0]) {
+        for (const auto& entry : part) {
+            result.groups.push_back(entry.second);
+            copy(begin(entry.first.v), end(entry.first.v), result.groups.back().key);
+        }
+        GroupMap().swap(part);
+    }
+    const size_t keyCount = dims.size();
+    sort(result.groups.begin(), result.groups.end(), [keyCount](const Group& a, const Group& b) {
+        if (a.count != b.count) return a.count > b.count;
+        return lexicographical_compare(a.key, a.key + keyCount, b.key, b.key + keyCount);
+    });
+
+    // Таблица для вывода: имена из справочников — только для показанных строк
+    vector<string> header;
+    for (Dimension d : dims) header.push_back(dimensionName(d));
+    for (Measure m : result.spec.measures) header.push_back(measureName(m));
+    result.table.push_back(header);
+    size_t shown = spec.limit ? min(spec.limit, result.groups.size()) : result.groups.size();
+    for (size_t i = 0; i < shown; ++i) {
+        const Group& g = result.groups[i];
+        vector<string> row;
+        for (size_t d = 0; d < keyCount; ++d) row.push_back(keyLabel(dims[d], g.key[d]));
+        for (Measure m : result.spec.measures) row.push_back(measureValue(m, g));
+        result.table.push_back(move(row));
+    }
+    FINALDB_METRIC_ROWS(result.rowsScanned, result.groups.size());
+    return result;
+}
+
+string GroupByEngine::keyLabel(Dimension dimension, int value) const {
+    switch (dimension) {
+    case Dimension::CITY: {
+        CityTable::CityInfo c;
+        return cities.getCityById(value, c) ? string(c.name) : "-";
+    }
+    case Dimension::GRADE:
+        return value < 0 ? "-" : CityTable::populationGradeToString(static_cast<CityTable::PopulationGrade>(value));
+    case Dimension::SETTLEMENT:
+        return value < 0 ? "-" : CityTable::settlementTypeToString(static_cast<CityTable::SettlementType>(value));
+    case Dimension::FINE: {
+        string_view type = fines.getFineTypeById(value);
+        return type.empty() ? "-" : string(type);
+    }
+    case Dimension::SEVERITY:
+        return value < 0 ? "-" : FineTable::severityToString(static_cast<FineTable::Severity>(value));
+    case Dimension::MONTH: {
+        if (value == 0) return "-";
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%02d.%04d", value % 100, value / 100);
+        return buf;
+    }
+    case Dimension::DRIVER: {
+        DriverTable::DriverInfo d;
+        return drivers.getDriverById(value, d) ? string(d.fullName) : "-";
+    }
+    }
+    return "-";
+}
+
+string GroupByEngine::measureValue(Measure measure, const Group& group) {
+    ostringstream oss;
+    oss << fixed << setprecision(2);
+    switch (measure) {
+    case Measure::COUNT:      oss << group.count; break;
+    case Measure::SUM:        oss << group.amount; break;
+    case Measure::AVG:        oss << (group.count ? group.amount / group.count : 0.0); break;
+    case Measure::MIN_DATE:   return formatDate(group.minDate);
+    case Measure::MAX_DATE:   return formatDate(group.maxDate);
+    case Measure::PAID_RATIO:
+        oss << setprecision(1) << (group.count ? 100.0 * group.paid / group.count : 0.0) << '%';
+        break;
+    }
+    return oss.str();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "CityTable.h"
+#include "DriverTable.h"
+#include "FineTable.h"
+#include "FineRegistry.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Отчёт "сгруппировать и посчитать" по реестру, соединённому с водителями,
+// городами и штрафами. Агрегация хешированием, разбитая по потокам:
+//   1) диапазон recordId делится между потоками; каждый поток раскладывает
+//      свои группы по PARTITIONS частичным хеш-таблицам по хешу ключа;
+//   2) частичные таблицы одной части сливаются отдельной задачей —
+//      части не пересекаются, блокировки не нужны.
+// Малые реестры считаются в одном потоке.
+class GroupByEngine {
+public:
+    enum class Dimension { CITY, GRADE, SETTLEMENT, FINE, SEVERITY, MONTH, DRIVER };
+    enum class Measure { COUNT, SUM, AVG, MIN_DATE, MAX_DATE, PAID_RATIO };
+    static const int MAX_DIMENSIONS = 7;
+
+    struct Spec {
+        std::vector<Dimension> dimensions;   // пусто — одна группа на весь реестр
+        std::vector<Measure> measures;       // пусто — все меры
+        size_t limit = 0;                    // строк в таблице, 0 — все
+    };
+
+    // Значения измерений: ID (город, штраф, водитель), номер перечисления
+    // (-1 — нет связанной строки) или YYYYMM (0 — дата некорректна)
+    struct Group {
+        int key[MAX_DIMENSIONS];
+        size_t count = 0;
+        size_t paid = 0;
+        double amount = 0;             // сумма штрафов
+        int minDate = 0, maxDate = 0;  // YYYYMMDD, 0 — нет корректных дат
+    };
+
+    struct Result {
+        Spec spec;
+        std::vector<Group> groups;     // по убыванию count, затем по ключу
+        std::vector<std::vector<std::string>> table;   // заголовок + строки до limit
+        size_t rowsScanned = 0;
+        unsigned threads = 1;
+    };
+
+    GroupByEngine(const CityTable& cities, const DriverTable& drivers,
+        const FineTable& fines, const FineRegistry& registry);
+
+    Result run(const Spec& spec) const;
+
+    // "city, month" и "count, sum, paid_ratio"; неизвестное имя или
+    // повтор измерения — invalid_argument
+    static Spec parseSpec(const std::string& dimensions, const std::string& measures);
+    static const char* dimensionName(Dimension dimension);
+    static const char* measureName(Measure measure);
+
+    // Реестры меньше — в одном потоке
+    static const int PARALLEL_ROWS = 1 << 15;
+    static const int PARTITIONS = 64;
+
+private:
+    const CityTable& cities;
+    const DriverTable& drivers;
+    const FineTable& fines;
+    const FineRegistry& registry;
+
+    std::string keyLabel(Dimension dimension, int value) const;
+    static std::string measureValue(Measure measure, const Group& group);
+};
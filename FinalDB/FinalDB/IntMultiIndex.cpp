@@ -0,0 +1,52 @@
+#include "IntMultiIndex.h"
+#include <algorithm>
+
+void IntMultiIndex::insert(int key, int rowId) {
+    buckets[key].push_back(rowId);
+}
+
+void IntMultiIndex::remove(int key, int rowId) {
+    auto it = buckets.find(key);
+    if (it == buckets.end()) return;
+    std::vector<int>& rows = it->second;
+    auto pos = std::find(rows.begin(), rows.end(), rowId);
+    if (pos == rows.end()) return;
+    // Порядок внутри корзины не важен — удаляем перестановкой с последним
+    *pos = rows.back();
+    rows.pop_back();
+    if (rows.empty()) buckets.erase(it);
+}
+
+void IntMultiIndex::clear() {
+    buckets.clear();
+}
+
+void IntMultiIndex::shrinkToFit() {
+    for (auto& bucket : buckets) bucket.second.shrink_to_fit();
+}
+
+const std::vector<int>* IntMultiIndex::find(int key) const {
+    auto it = buckets.find(key);
+    return (it != buckets.end()) ? &it->second : nullptr;
+}
+
+size_t IntMultiIndex::count(int key) const {
+    auto it = buckets.find(key);
+    return (it != buckets.end()) ? it->second.size() : 0;
+}
+
+size_t IntMultiIndex::countRange(int lo, int hi) const {
+    size_t total = 0;
+    if (lo > hi) return 0;
+    for (auto it = buckets.lower_bound(lo); it != buckets.end() && it->first <= hi; ++it) {
+        total += it->second.size();
+    }
+    return total;
+}
+
+void IntMultiIndex::collectRange(int lo, int hi, std::vector<int>& out) const {
+    if (lo > hi) return;
+    for (auto it = buckets.lower_bound(lo); it != buckets.end() && it->first <= hi; ++it) {
+        out.insert(out.end(), it->second.begin(), it->second.end());
+    }
+}
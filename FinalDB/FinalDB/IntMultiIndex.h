@@ -0,0 +1,46 @@
+#pragma once
+#include <map>
+#include <vector>
+
+// Вторичный индекс: ключ (int) → список id строк.
+// Упорядочен по ключу, поэтому поддерживает и точный поиск, и диапазоны.
+class IntMultiIndex {
+public:
+    void insert(int key, int rowId);
+    void remove(int key, int rowId);
+    void clear();
+    // Отдать лишнюю ёмкость корзин (после массовой перестройки)
+    void shrinkToFit();
+
+    // Список строк для ключа (nullptr, если ключа нет)
+    const std::vector<int>* find(int key) const;
+    size_t count(int key) const;
+
+    // Количество строк с ключами в [lo, hi] (без материализации)
+    size_t countRange(int lo, int hi) const;
+    // Добавить в out все строки с ключами в [lo, hi]
+    void collectRange(int lo, int hi, std::vector<int>& out) const;
+
+    size_t keyCount() const { return buckets.size(); }
+
+    // Обход ключей [lo, hi] по возрастанию или убыванию;
+    // visit(key, rows) возвращает false, чтобы прекратить обход
+    template <class Visit>
+    void visitRange(int lo, int hi, bool descending, Visit visit) const {
+        if (lo > hi) return;
+        auto first = buckets.lower_bound(lo);
+        auto last = buckets.upper_bound(hi);
+        if (!descending) {
+            for (auto it = first; it != last; ++it)
+                if (!visit(it->first, it->second)) return;
+            return;
+        }
+        for (auto it = last; it != first; ) {
+            --it;
+            if (!visit(it->first, it->second)) return;
+        }
+    }
+
+private:
+    std::map<int, std::vector<int>> buckets;
+};
@@ -0,0 +1,328 @@
+#include "MergeEngine.h"
+#include "Metrics.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+using namespace std;
+
+namespace {
+
+// Строки источника после чтения. Строки — view в глобальный пул,
+// поэтому сами внешние таблицы освобождаются сразу после чтения.
+struct SourceRows {
+    vector<CityTable::CityInfo> cities;
+    vector<FineTable::FineInfo> fines;
+    vector<DriverTable::DriverInfo> drivers;
+    vector<FineRegistry::ViolationInfo> violations;   // только собственные поля записи
+};
+
+struct DriverKey {
+    string_view name, birthDate;
+    int cityId;                    // ID города в основной базе
+    bool operator==(const DriverKey& o) const {
+        return cityId == o.cityId && name == o.name && birthDate == o.birthDate;
+    }
+};
+
+// Нарушение в ID основной базы
+struct ViolationKey {
+    int driverId, cityId, fineId;
+    string_view date;
+    bool operator==(const ViolationKey& o) const {
+        return driverId == o.driverId && cityId == o.cityId && fineId == o.fineId && date == o.date;
+    }
+};
+
+size_t mix(size_t h, size_t v) {
+    return h ^ (v + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+
+struct KeyHash {
+    size_t operator()(const DriverKey& k) const {
+        return mix(mix(hash<string_view>()(k.name), hash<string_view>()(k.birthDate)),
+            static_cast<size_t>(k.cityId));
+    }
+    size_t operator()(const ViolationKey& k) const {
+        return mix(mix(mix(hash<string_view>()(k.date), static_cast<size_t>(k.driverId)),
+            static_cast<size_t>(k.cityId)), static_cast<size_t>(k.fineId));
+    }
+};
+
+bool validId(int id) {
+    return id >= 0 && id <= MergeEngine::MAX_EXTERNAL_ID;
+}
+
+// Строки с ID вне [0, MAX_EXTERNAL_ID] убираются: ID из файла не
+// проверялся, а по нему индексируется перекодировка
+template <class Row>
+size_t dropInvalidIds(vector<Row>& rows) {
+    size_t before = rows.size();
+    rows.erase(remove_if(rows.begin(), rows.end(), [](const Row& r) { return !validId(r.id); }), rows.end());
+    return before - rows.size();
+}
+
+// Перекодировка под ID строк источника (все ID уже допустимы)
+template <class Row>
+void resetRemap(MergeEngine::IdRemap& ids, const vector<Row>& rows) {
+    int maxId = -1;
+    for (const Row& r : rows) maxId = max(maxId, r.id);
+    ids.reset(maxId, rows.size());
+}
+
+void loadSource(const string& suffix, SourceRows& rows, MergeEngine::SourceStats& stats) {
+    FINALDB_METRIC_SCOPE("merge.loadSource");
+    auto start = chrono::steady_clock::now();
+    CityTable cities;
+    DriverTable drivers;
+    FineTable fines;
+    FineRegistry registry;
+    bool ok = cities.loadFromFile("cities" + suffix + ".txt");
+    ok = drivers.loadFromFile("drivers" + suffix + ".txt") && ok;
+    ok = fines.loadFromFile("fines" + suffix + ".txt") && ok;
+    ok = registry.loadFromFile("registry" + suffix + ".txt") && ok;
+
+    cities.cityIteratorReset();
+    while (cities.cityIteratorHasNext()) rows.cities.push_back(cities.cityIteratorNext());
+    fines.fineIteratorReset();
+    while (fines.fineIteratorHasNext()) rows.fines.push_back(fines.fineIteratorNext());
+    drivers.driverIteratorReset();
+    while (drivers.driverIteratorHasNext()) rows.drivers.push_back(drivers.driverIteratorNext());
+    rows.violations.reserve(static_cast<size_t>(registry.getRecordCount()));
+    registry.violationIteratorReset();
+    while (registry.violationIteratorHasNext()) rows.violations.push_back(registry.violationIteratorNextRecord());
+    stats.invalidIds = dropInvalidIds(rows.cities) + dropInvalidIds(rows.fines) + dropInvalidIds(rows.drivers);
+
+    stats.loaded = ok;
+    stats.cities = rows.cities.size();
+    stats.drivers = rows.drivers.size();
+    stats.fines = rows.fines.size();
+    stats.violations = rows.violations.size();
+    stats.loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    FINALDB_METRIC_ROWS(stats.cities + stats.drivers + stats.fines + stats.violations, 0);
+}
+
+} // namespace
+
+MergeEngine::Report MergeEngine::merge(const vector<string>& suffixes,
+    const function<void()>& prepareMain, CityTable& cities,
+    DriverTable& drivers, FineTable& fines, FineRegistry& registry)
+{
+    Report report;
+    report.sources.resize(suffixes.size());
+    vector<SourceRows> sourceRows(suffixes.size());
+
+    // 1) Источники — на пуле; основная база — здесь же. Нарушения основной
+    //    базы не перебираются: повторы ищет registry.findIdentical
+    {
+        FINALDB_METRIC_SCOPE("merge.load");
+        ThreadPool pool(static_cast<unsigned>(max<size_t>(1,
+            min<size_t>(suffixes.size(), thread::hardware_concurrency()))));
+        for (size_t i = 0; i < suffixes.size(); ++i) {
+            report.sources[i].suffix = suffixes[i];
+            pool.submit([&, i] { loadSource(suffixes[i], sourceRows[i], report.sources[i]); });
+        }
+        prepareMain();
+        pool.wait();
+    }
+
+    // 2) Города: атрибуты — из последнего источника, затем перекодировка
+    {
+        FINALDB_METRIC_SCOPE("merge.cities");
+        unordered_map<string_view, const CityTable::CityInfo*> latest;
+        vector<string_view> order;
+        for (const SourceRows& rows : sourceRows) {
+            for (const auto& c : rows.cities) {
+                auto it = latest.emplace(c.name, &c);
+                if (it.second) order.push_back(c.name);
+                else it.first->second = &c;
+            }
+        }
+        for (string_view name : order) {
+            const CityTable::CityInfo& c = *latest[name];
+            int id = cities.getCityIdByName(name);
+            CityTable::CityInfo cur;
+            if (id == -1) {
+                cities.addCity(name, c.population, c.grade, c.type);
+                ++report.citiesAdded;
+            }
+            else if (cities.getCityById(id, cur)
+                && (cur.population != c.population || cur.grade != c.grade || cur.type != c.type)) {
+                cities.updateCityPopulation(id, c.population);
+                cities.updateCityGrade(id, c.grade);
+                cities.updateCityType(id, c.type);
+                ++report.citiesUpdated;
+            }
+        }
+        for (size_t i = 0; i < sourceRows.size(); ++i) {
+            IdRemap& ids = report.sources[i].cityRemap;
+            resetRemap(ids, sourceRows[i].cities);
+            for (const auto& c : sourceRows[i].cities) ids.set(c.id, cities.getCityIdByName(c.name));
+        }
+    }
+
+    // 3) Штрафы — так же, по типу
+    {
+        FINALDB_METRIC_SCOPE("merge.fines");
+        unordered_map<string_view, const FineTable::FineInfo*> latest;
+        vector<string_view> order;
+        for (const SourceRows& rows : sourceRows) {
+            for (const auto& f : rows.fines) {
+                auto it = latest.emplace(f.type, &f);
+                if (it.second) order.push_back(f.type);
+                else it.first->second = &f;
+            }
+        }
+        for (string_view type : order) {
+            const FineTable::FineInfo& f = *latest[type];
+            int id = fines.getFineIdByType(type);
+            FineTable::FineInfo cur;
+            if (id == -1) {
+                fines.addFine(type, f.amount, f.severity);
+                ++report.finesAdded;
+            }
+            else if (fines.getFineById(id, cur) && (cur.amount != f.amount || cur.severity != f.severity)) {
+                fines.updateFineAmount(id, f.amount);
+                registry.repriceFine(id);
+                fines.updateFineSeverity(id, f.severity);
+                ++report.finesUpdated;
+            }
+        }
+        for (size_t i = 0; i < sourceRows.size(); ++i) {
+            IdRemap& ids = report.sources[i].fineRemap;
+            resetRemap(ids, sourceRows[i].fines);
+            for (const auto& f : sourceRows[i].fines) ids.set(f.id, fines.getFineIdByType(f.type));
+        }
+    }
+
+    // 4) Водители: ключ — ФИО, дата рождения и уже перекодированный город
+    {
+        FINALDB_METRIC_SCOPE("merge.drivers");
+        unordered_map<DriverKey, int, KeyHash> known;
+        for (size_t i = 0; i < sourceRows.size(); ++i) {
+            SourceStats& stats = report.sources[i];
+            IdRemap& ids = stats.driverRemap;
+            resetRemap(ids, sourceRows[i].drivers);
+            for (const auto& d : sourceRows[i].drivers) {
+                DriverKey key{ d.fullName, d.birthDate, stats.cityRemap.get(d.cityId) };
+                auto it = known.find(key);
+                if (it == known.end()) {
+                    int id = drivers.getDriverId(key.name, key.birthDate, key.cityId);
+                    if (id == -1) {
+                        try {
+                            id = drivers.addDriver(string(key.name), string(key.birthDate), key.cityId);
+                            ++report.driversAdded;
+                        }
+                        catch (const invalid_argument&) {
+                            ++report.driversRejected;
+                        }
+                    }
+                    it = known.emplace(key, id).first;
+                }
+                ids.set(d.id, it->second);
+            }
+        }
+    }
+
+    // 5) Нарушения: ID переводятся индексацией массивов, свод — по ключу
+    //    в ID основной базы; оплата — из последнего источника
+    {
+        FINALDB_METRIC_SCOPE("merge.violations");
+        struct ViolationDelta {
+            bool paid;
+            int mainRecordId;          // -1 — новая запись
+        };
+        unordered_map<ViolationKey, ViolationDelta, KeyHash> delta;
+        vector<ViolationKey> order;
+        size_t scanned = 0;
+        for (size_t i = 0; i < sourceRows.size(); ++i) {
+            SourceStats& stats = report.sources[i];
+            for (const auto& v : sourceRows[i].violations) {
+                ++scanned;
+                ViolationKey key{ stats.driverRemap.get(v.driverId), stats.cityRemap.get(v.cityId),
+                    stats.fineRemap.get(v.fineId), v.date };
+                // Без водителя или штрафа в основной базе запись дала бы висячую ссылку
+                if (key.driverId == -1 || key.fineId == -1) {
+                    ++stats.rejectedViolations;
+                    continue;
+                }
+                auto it = delta.find(key);
+                if (it != delta.end()) {
+                    it->second.paid = v.paid;
+                    ++stats.duplicateViolations;
+                    continue;
+                }
+                int mainId = registry.findIdentical(key.driverId, key.cityId, key.fineId, key.date);
+                if (mainId == 0) mainId = -1;
+                delta.emplace(key, ViolationDelta{ v.paid, mainId });
+                order.push_back(key);
+                if (mainId == -1) ++stats.newViolations;
+                else ++stats.duplicateViolations;
+            }
+            sourceRows[i] = SourceRows();
+        }
+        FineRegistry::ViolationInfo existing;
+        for (const ViolationKey& key : order) {
+            const ViolationDelta& v = delta[key];
+            if (v.mainRecordId != -1) {
+                registry.findViolation(v.mainRecordId, existing);
+                if (existing.paid != v.paid) {
+                    registry.updateViolationPaid(v.mainRecordId, v.paid);
+                    ++report.violationsUpdated;
+                }
+                continue;
+            }
+            int recordId = registry.addViolation(key.driverId, key.cityId, key.fineId, key.date);
+            if (v.paid) registry.markAsPaid(recordId);
+            ++report.violationsAdded;
+        }
+        FINALDB_METRIC_ROWS(scanned, report.violationsAdded + report.violationsUpdated);
+    }
+    return report;
+}
+
+// Массив — пока наибольший ID не больше DENSE_FACTOR строк на строку
+// источника (с запасом на небольшие таблицы)
+void MergeEngine::IdRemap::reset(int maxId, size_t rows) {
+    const size_t DENSE_FACTOR = 4, DENSE_SLACK = 1024;
+    size_t size = static_cast<size_t>(maxId + 1);
+    sparse = size > rows * DENSE_FACTOR + DENSE_SLACK;
+    byId.clear();
+    dense.assign(sparse ? 0 : size, NO_ROW);
+}
+
+void MergeEngine::IdRemap::set(int externalId, int mainId) {
+    if (sparse) byId[externalId] = mainId;
+    else dense[static_cast<size_t>(externalId)] = mainId;
+}
+
+int MergeEngine::IdRemap::get(int externalId) const {
+    if (sparse) {
+        auto it = byId.find(externalId);
+        return it != byId.end() ? it->second : -1;
+    }
+    if (externalId < 0 || externalId >= static_cast<int>(dense.size())) return -1;
+    return max(dense[static_cast<size_t>(externalId)], -1);
+}
+
+bool MergeEngine::writeRemap(const Report& report, const string& filename) {
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error opening file for writing: " << filename << "\n";
+        return false;
+    }
+    auto writeIds = [&file](const char* table, const IdRemap& ids) {
+        ids.forEach([&](int id, int mainId) { file << table << ' ' << id << ' ' << mainId << '\n'; });
+    };
+    for (const SourceStats& s : report.sources) {
+        file << "source " << s.suffix << '\n';
+        writeIds("city", s.cityRemap);
+        writeIds("driver", s.driverRemap);
+        writeIds("fine", s.fineRemap);
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "CityTable.h"
+#include "DriverTable.h"
+#include "FineTable.h"
+#include "FineRegistry.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Слияние нескольких внешних баз (наборы файлов cities<suffix>.txt и т.д.)
+// с основной:
+//   1) наборы читаются параллельно, по задаче на источник;
+//   2) справочники сводятся по естественным ключам (город — название,
+//      штраф — тип, водитель — ФИО + дата рождения + город) и применяются;
+//      при расхождении атрибутов побеждает более поздний источник, как
+//      при слиянии источников по одному;
+//   3) для каждого источника строятся плотные массивы перекодировки
+//      внешний ID → ID основной базы (для разреженных ID — хеш-таблица),
+//      и нарушения переводятся индексацией, без поиска по именам; строки
+//      справочников с ID вне [0, MAX_EXTERNAL_ID] пропускаются;
+//   4) нарушения сводятся по ключу (водитель, город, штраф, дата) в ID
+//      основной базы и применяются за один проход; есть ли ключ в основной
+//      базе, отвечает FineRegistry::findIdentical (фильтр Блума, затем
+//      индекс водителя) — нарушения основной базы не перебираются.
+//      Нарушения, чей водитель или штраф не сопоставлен (addDriver
+//      отверг водителя, нет строки во внешней таблице), не переносятся
+//      и считаются в SourceStats::rejectedViolations.
+// Запись на диск — забота вызывающего (один commit на всё слияние).
+class MergeEngine {
+public:
+    static constexpr int NO_ROW = -2;     // в массиве перекодировки: такого внешнего ID нет
+    static constexpr int MAX_EXTERNAL_ID = 1 << 30;   // больше — испорченный файл
+
+    // Перекодировка внешний ID → ID основной базы. Массив до наибольшего
+    // ID, если ID плотные; иначе (ID намного больше числа строк) —
+    // хеш-таблица, чтобы один большой ID не раздувал массив
+    class IdRemap {
+    public:
+        void reset(int maxId, size_t rows);
+        void set(int externalId, int mainId);
+        // -1 — не сопоставлен или такой строки нет
+        int get(int externalId) const;
+
+        // visit(externalId, mainId) по возрастанию externalId
+        template <class Visit>
+        void forEach(Visit visit) const {
+            if (!sparse) {
+                for (size_t id = 0; id < dense.size(); ++id)
+                    if (dense[id] != NO_ROW) visit(static_cast<int>(id), dense[id]);
+                return;
+            }
+            std::vector<std::pair<int, int>> sorted(byId.begin(), byId.end());
+            std::sort(sorted.begin(), sorted.end());
+            for (const auto& p : sorted) visit(p.first, p.second);
+        }
+
+    private:
+        bool sparse = false;
+        std::vector<int> dense;            // NO_ROW — строки нет
+        std::unordered_map<int, int> byId;
+    };
+
+    // Статистика и перекодировка одного источника
+    struct SourceStats {
+        std::string suffix;
+        bool loaded = false;           // прочитаны все четыре файла
+        double loadMs = 0;
+        size_t cities = 0, drivers = 0, fines = 0, violations = 0;   // строк в источнике
+        size_t newViolations = 0;      // нет ни в основной базе, ни в прежних источниках
+        size_t duplicateViolations = 0;   // уже были: обновляется только оплата
+        size_t rejectedViolations = 0;    // водитель или штраф не сопоставлен — не переносятся
+        size_t invalidIds = 0;         // строки справочников с ID вне [0, MAX_EXTERNAL_ID] — пропущены
+        IdRemap cityRemap, driverRemap, fineRemap;
+    };
+
+    struct Report {
+        std::vector<SourceStats> sources;
+        size_t citiesAdded = 0, citiesUpdated = 0;
+        size_t finesAdded = 0, finesUpdated = 0;
+        size_t driversAdded = 0, driversRejected = 0;   // rejected — не прошли проверки addDriver
+        size_t violationsAdded = 0, violationsUpdated = 0;
+        std::string remapFile;         // куда записана перекодировка, "" — не записана
+
+        size_t mutations() const {
+            return citiesAdded + citiesUpdated + finesAdded + finesUpdated
+                + driversAdded + violationsAdded + violationsUpdated;
+        }
+    };
+
+    // prepareMain вызывается в текущем потоке, пока читаются источники
+    // (например, ленивая загрузка основной базы)
+    static Report merge(const std::vector<std::string>& suffixes,
+        const std::function<void()>& prepareMain, CityTable& cities,
+        DriverTable& drivers, FineTable& fines, FineRegistry& registry);
+
+    // Перекодировка всех источников для аудита:
+    // "source <suffix>", затем строки "<city|driver|fine> <внешний ID> <ID в основной>"
+    static bool writeRemap(const Report& report, const std::string& filename);
+};
@@ -0,0 +1,131 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+using namespace std;
+
+Metrics::Slot::Slot(const string& name) : name(name) {
+    for (auto& b : buckets) b.store(0, memory_order_relaxed);
+}
+
+void Metrics::Slot::record(uint64_t ns) {
+    calls.fetch_add(1, memory_order_relaxed);
+    totalNs.fetch_add(ns, memory_order_relaxed);
+    buckets[bucketIndex(ns)].fetch_add(1, memory_order_relaxed);
+    uint64_t prev = maxNs.load(memory_order_relaxed);
+    while (ns > prev && !maxNs.compare_exchange_weak(prev, ns, memory_order_relaxed)) {
+    }
+}
+
+// Корзина, в которую попадает p-я доля вызовов (p в [0, 1], ближайший ранг)
+uint64_t Metrics::Slot::percentileNs(double p) const {
+    uint64_t total = 0;
+    for (const auto& b : buckets) total += b.load(memory_order_relaxed);
+    if (total == 0) return 0;
+    uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(p * total)));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen >= rank) return min(bucketValue(i), maxNs.load(memory_order_relaxed));
+    }
+    return maxNs.load(memory_order_relaxed);
+}
+
+// Значения < 8 — точные корзины; дальше старший бит задаёт группу,
+// следующие 3 бита — корзину внутри группы
+int Metrics::bucketIndex(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return static_cast<int>(ns);
+    int msb = 63;
+    while (!(ns >> msb)) --msb;
+    int shift = msb - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<int>((ns >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Metrics::bucketValue(int index) {
+    if (index < SUB_BUCKETS) return static_cast<uint64_t>(index);
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t low = static_cast<uint64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return low + ((uint64_t(1) << shift) >> 1);
+}
+
+// Как и пул строк, реестр метрик живёт до конца программы
+Metrics& Metrics::instance() {
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+Metrics::Slot& Metrics::slot(const string& name) {
+    lock_guard<std::mutex> lock(mutex);
+    for (Slot* s : slots)
+        if (s->name == name) return *s;
+    slots.push_back(new Slot(name));
+    return *slots.back();
+}
+
+vector<Metrics::Summary> Metrics::snapshot() const {
+    vector<Summary> result;
+    lock_guard<std::mutex> lock(mutex);
+    for (const Slot* s : slots) {
+        uint64_t calls = s->calls.load(memory_order_relaxed);
+        if (calls == 0) continue;
+        Summary sum;
+        sum.name = s->name;
+        sum.calls = calls;
+        sum.totalMs = s->totalNs.load(memory_order_relaxed) / 1e6;
+        sum.p50Us = s->percentileNs(0.50) / 1e3;
+        sum.p99Us = s->percentileNs(0.99) / 1e3;
+        sum.maxUs = s->maxNs.load(memory_order_relaxed) / 1e3;
+        sum.rowsScanned = s->rowsScanned.load(memory_order_relaxed);
+        sum.rowsReturned = s->rowsReturned.load(memory_order_relaxed);
+        result.push_back(sum);
+    }
+    sort(result.begin(), result.end(),
+        [](const Summary& a, const Summary& b) { return a.name < b.name; });
+    return result;
+}
+
+void Metrics::reset() {
+    lock_guard<std::mutex> lock(mutex);
+    for (Slot* s : slots) {
+        s->calls.store(0, memory_order_relaxed);
+        s->totalNs.store(0, memory_order_relaxed);
+        s->maxNs.store(0, memory_order_relaxed);
+        s->rowsScanned.store(0, memory_order_relaxed);
+        s->rowsReturned.store(0, memory_order_relaxed);
+        for (auto& b : s->buckets) b.store(0, memory_order_relaxed);
+    }
+}
+
+// Имена метрик — латиница, точки и подчёркивания, экранирование не нужно
+void Metrics::writeJson(ostream& out) const {
+    out << "{\n  \"enabled\": " << (enabled() ? "true" : "false") << ",\n  \"metrics\": [";
+    bool first = true;
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out << fixed << setprecision(3);
+    for (const Summary& s : snapshot()) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "    { \"name\": \"" << s.name << "\", \"calls\": " << s.calls
+            << ", \"total_ms\": " << s.totalMs
+            << ", \"p50_us\": " << s.p50Us << ", \"p99_us\": " << s.p99Us
+            << ", \"max_us\": " << s.maxUs
+            << ", \"rows_scanned\": " << s.rowsScanned
+            << ", \"rows_returned\": " << s.rowsReturned << " }";
+    }
+    out << (first ? "]\n}\n" : "\n  ]\n}\n");
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool Metrics::dumpJson(const string& filename) const {
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error opening metrics file: " << filename << "\n";
+        return false;
+    }
+    writeJson(file);
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Встроенные метрики горячих путей: число вызовов, гистограмма задержек
+// (p50/p99), строки просмотренные/возвращённые.
+// Сборка с FINALDB_METRICS=0 убирает замеры целиком — макросы ниже
+// раскрываются в пустоту, класс Metrics остаётся только для меню/дампа.
+#ifndef FINALDB_METRICS
+#define FINALDB_METRICS 1
+#endif
+
+class Metrics {
+public:
+    // Лог-линейная гистограмма в наносекундах: 8 корзин на каждую степень
+    // двойки, погрешность перцентиля не больше 12.5%
+    static const int SUB_BUCKET_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Одна точка замера (операция). Создаётся один раз, не удаляется.
+    struct Slot {
+        std::string name;
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> totalNs{ 0 };
+        std::atomic<uint64_t> maxNs{ 0 };
+        std::atomic<uint64_t> rowsScanned{ 0 };
+        std::atomic<uint64_t> rowsReturned{ 0 };
+        std::atomic<uint64_t> buckets[BUCKET_COUNT];
+
+        explicit Slot(const std::string& name);
+        void record(uint64_t ns);
+        void rows(uint64_t scanned, uint64_t returned) {
+            rowsScanned.fetch_add(scanned, std::memory_order_relaxed);
+            rowsReturned.fetch_add(returned, std::memory_order_relaxed);
+        }
+        uint64_t percentileNs(double p) const;
+    };
+
+    // Снимок одной метрики для вывода
+    struct Summary {
+        std::string name;
+        uint64_t calls;
+        double totalMs;
+        double p50Us, p99Us, maxUs;
+        uint64_t rowsScanned, rowsReturned;
+    };
+
+    static Metrics& instance();
+
+    // Точка замера по имени; ссылка действительна до конца программы
+    Slot& slot(const std::string& name);
+
+    std::vector<Summary> snapshot() const;   // только вызывавшиеся, по имени
+    void reset();
+    void writeJson(std::ostream& out) const;
+    bool dumpJson(const std::string& filename) const;
+
+    static bool enabled() { return FINALDB_METRICS != 0; }
+    static int bucketIndex(uint64_t ns);
+    static uint64_t bucketValue(int index);   // середина корзины
+
+    // Замер области видимости: время пишется в деструкторе
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Slot& slot)
+            : slot(slot), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            slot.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count()));
+        }
+        void rows(uint64_t scanned, uint64_t returned) { slot.rows(scanned, returned); }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Slot& slot;
+        std::chrono::steady_clock::time_point start;
+    };
+
+private:
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    mutable std::mutex mutex;
+    std::vector<Slot*> slots;
+};
+
+#if FINALDB_METRICS
+// Замер до конца текущей области; имя — строковый литерал.
+// Точка замера ищется один раз на место вызова (static).
+#define FINALDB_METRIC_SCOPE(name) \
+    static Metrics::Slot& finaldbMetricSlot = Metrics::instance().slot(name); \
+    Metrics::ScopedTimer finaldbMetricScope(finaldbMetricSlot)
+// Строки просмотренные/возвращённые для FINALDB_METRIC_SCOPE этой функции
+#define FINALDB_METRIC_ROWS(scanned, returned) \
+    finaldbMetricScope.rows(static_cast<uint64_t>(scanned), static_cast<uint64_t>(returned))
+#else
+#define FINALDB_METRIC_SCOPE(name) ((void)0)
+#define FINALDB_METRIC_ROWS(scanned, returned) ((void)0)
+#endif
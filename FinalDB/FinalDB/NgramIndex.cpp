@@ -0,0 +1,93 @@
+#include "NgramIndex.h"
+#include <algorithm>
+#include <iterator>
+
+// Уникальные триграммы строки, упакованные в 24 бита
+void NgramIndex::gramsOf(std::string_view text, std::vector<uint32_t>& grams) {
+    grams.clear();
+    if (text.size() < GRAM) return;
+    for (size_t i = 0; i + GRAM <= text.size(); ++i) {
+        uint32_t g = (static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16)
+            | (static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8)
+            | static_cast<uint32_t>(static_cast<unsigned char>(text[i + 2]));
+        grams.push_back(g);
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+void NgramIndex::insert(int id, std::string_view text) {
+    std::vector<uint32_t> grams;
+    gramsOf(text, grams);
+    for (uint32_t g : grams) {
+        std::vector<int>& list = postings[g];
+        // id обычно растут, поэтому вставка почти всегда в конец
+        if (list.empty() || list.back() < id) list.push_back(id);
+        else {
+            auto pos = std::lower_bound(list.begin(), list.end(), id);
+            if (pos == list.end() || *pos != id) list.insert(pos, id);
+        }
+    }
+    sorted.emplace(text, id);
+}
+
+void NgramIndex::remove(int id, std::string_view text) {
+    std::vector<uint32_t> grams;
+    gramsOf(text, grams);
+    for (uint32_t g : grams) {
+        auto it = postings.find(g);
+        if (it == postings.end()) continue;
+        std::vector<int>& list = it->second;
+        auto pos = std::lower_bound(list.begin(), list.end(), id);
+        if (pos != list.end() && *pos == id) list.erase(pos);
+        if (list.empty()) postings.erase(it);
+    }
+    auto range = sorted.equal_range(text);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == id) {
+            sorted.erase(it);
+            break;
+        }
+    }
+}
+
+void NgramIndex::clear() {
+    postings.clear();
+    sorted.clear();
+}
+
+bool NgramIndex::containsCandidates(const std::string& pattern, std::vector<int>& out) const {
+    out.clear();
+    std::vector<uint32_t> grams;
+    gramsOf(pattern, grams);
+    if (grams.empty()) return false;
+
+    // Пересекаем, начиная с самого короткого списка
+    std::vector<const std::vector<int>*> lists;
+    for (uint32_t g : grams) {
+        auto it = postings.find(g);
+        if (it == postings.end()) return true;   // триграммы нет ни у кого
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const std::vector<int>* a, const std::vector<int>* b) { return a->size() < b->size(); });
+
+    out = *lists[0];
+    std::vector<int> tmp;
+    for (size_t i = 1; i < lists.size() && !out.empty(); ++i) {
+        tmp.clear();
+        std::set_intersection(out.begin(), out.end(),
+            lists[i]->begin(), lists[i]->end(), std::back_inserter(tmp));
+        out.swap(tmp);
+    }
+    return true;
+}
+
+void NgramIndex::prefixMatches(const std::string& prefix, std::vector<int>& out) const {
+    out.clear();
+    for (auto it = sorted.lower_bound(prefix); it != sorted.end(); ++it) {
+        if (it->first.compare(0, prefix.size(), prefix) != 0) break;
+        out.push_back(it->second);
+    }
+    std::sort(out.begin(), out.end());
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Индекс для поиска по подстроке и по префиксу.
+// Подстрока: триграмма → отсортированный список id; кандидаты —
+// пересечение списков всех триграмм образца (нужна проверка find'ом).
+// Префикс: отсортированный словарь строк, ответ точный.
+// Строки словаря — view; они должны жить не меньше индекса (пул строк).
+class NgramIndex {
+public:
+    static const size_t GRAM = 3;
+
+    void insert(int id, std::string_view text);
+    void remove(int id, std::string_view text);
+    void clear();
+
+    // Кандидаты на "содержит pattern". false — образец короче триграммы,
+    // и индекс сузить поиск не может (нужен полный проход).
+    bool containsCandidates(const std::string& pattern, std::vector<int>& out) const;
+    // Все id, чьи строки начинаются с prefix (отсортированы)
+    void prefixMatches(const std::string& prefix, std::vector<int>& out) const;
+
+private:
+    std::unordered_map<uint32_t, std::vector<int>> postings;
+    std::multimap<std::string_view, int> sorted;
+
+    static void gramsOf(std::string_view text, std::vector<uint32_t>& grams);
+};
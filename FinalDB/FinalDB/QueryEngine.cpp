@@ -0,0 +1,925 @@
+#include "QueryEngine.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+static string toLower(const string& s) {
+    string r = s;
+    for (char& c : r) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return r;
+}
+
+// Названия значений перечислений в порядке их ординалов
+static const char* const gradeNames[] = { "Small", "Medium", "Large" };
+static const char* const typeNames[] = { "City", "Town", "Village" };
+static const char* const severityNames[] = { "Light", "Medium", "Heavy" };
+
+static string formatAmount(double amount) {
+    ostringstream oss;
+    oss << amount;
+    return oss.str();
+}
+
+QueryEngine::QueryEngine(const CityTable& cities, const DriverTable& drivers,
+    const FineTable& fines, const FineRegistry& registry)
+    : cities(cities), drivers(drivers), fines(fines), registry(registry)
+{
+}
+
+// ======= Схема: таблицы и колонки =======
+QueryEngine::Target QueryEngine::parseTarget(const std::string& name) {
+    if (name == "cities") return Target::CITIES;
+    if (name == "drivers") return Target::DRIVERS;
+    if (name == "fines") return Target::FINES;
+    if (name == "violations" || name == "registry") return Target::VIOLATIONS;
+    throw invalid_argument("Query: unknown table '" + name + "'");
+}
+
+QueryEngine::Column QueryEngine::resolveColumn(Target target, const std::string& field) {
+    string f = toLower(field);
+
+    // Полные имена вида table.column
+    bool allowCity = target != Target::FINES;
+    bool allowDriver = target == Target::DRIVERS || target == Target::VIOLATIONS;
+    bool allowFine = target == Target::FINES || target == Target::VIOLATIONS;
+    if (allowCity) {
+        if (f == "city.id") return Column::CITY_ID;
+        if (f == "city.name") return Column::CITY_NAME;
+        if (f == "city.population") return Column::CITY_POPULATION;
+        if (f == "city.grade") return Column::CITY_GRADE;
+        if (f == "city.type") return Column::CITY_TYPE;
+    }
+    if (allowDriver) {
+        if (f == "driver.id") return Column::DRIVER_ID;
+        if (f == "driver.name" || f == "driver.fullname") return Column::DRIVER_NAME;
+        if (f == "driver.birthdate") return Column::DRIVER_BIRTH;
+    }
+    if (allowFine) {
+        if (f == "fine.id") return Column::FINE_ID;
+        if (f == "fine.type") return Column::FINE_TYPE;
+        if (f == "fine.amount") return Column::FINE_AMOUNT;
+        if (f == "fine.severity") return Column::FINE_SEVERITY;
+    }
+
+    // Короткие имена — зависят от таблицы
+    switch (target) {
+    case Target::CITIES:
+        if (f == "id") return Column::CITY_ID;
+        if (f == "name") return Column::CITY_NAME;
+        if (f == "population") return Column::CITY_POPULATION;
+        if (f == "grade") return Column::CITY_GRADE;
+        if (f == "type") return Column::CITY_TYPE;
+        break;
+    case Target::DRIVERS:
+        if (f == "id") return Column::DRIVER_ID;
+        if (f == "name" || f == "fullname") return Column::DRIVER_NAME;
+        if (f == "birthdate") return Column::DRIVER_BIRTH;
+        if (f == "cityid") return Column::CITY_ID;
+        if (f == "city") return Column::CITY_NAME;
+        break;
+    case Target::FINES:
+        if (f == "id") return Column::FINE_ID;
+        if (f == "type") return Column::FINE_TYPE;
+        if (f == "amount") return Column::FINE_AMOUNT;
+        if (f == "severity") return Column::FINE_SEVERITY;
+        break;
+    case Target::VIOLATIONS:
+        if (f == "id" || f == "recordid") return Column::RECORD_ID;
+        if (f == "paid") return Column::RECORD_PAID;
+        if (f == "date") return Column::RECORD_DATE;
+        if (f == "amount") return Column::FINE_AMOUNT;
+        if (f == "driver") return Column::DRIVER_NAME;
+        if (f == "driverid") return Column::DRIVER_ID;
+        if (f == "city") return Column::CITY_NAME;
+        if (f == "cityid") return Column::CITY_ID;
+        if (f == "fine" || f == "finetype") return Column::FINE_TYPE;
+        if (f == "fineid") return Column::FINE_ID;
+        if (f == "severity") return Column::FINE_SEVERITY;
+        break;
+    }
+    throw invalid_argument("Query: unknown field '" + field + "'");
+}
+
+QueryEngine::ColumnType QueryEngine::columnType(Column column) {
+    switch (column) {
+    case Column::CITY_NAME:
+    case Column::DRIVER_NAME:
+    case Column::FINE_TYPE:
+        return ColumnType::TEXT;
+    case Column::CITY_GRADE:
+    case Column::CITY_TYPE:
+    case Column::FINE_SEVERITY:
+        return ColumnType::ENUM;
+    case Column::DRIVER_BIRTH:
+    case Column::RECORD_DATE:
+        return ColumnType::DATE;
+    default:
+        return ColumnType::NUMBER;
+    }
+}
+
+char QueryEngine::columnTable(Column column) {
+    switch (column) {
+    case Column::CITY_ID: case Column::CITY_NAME: case Column::CITY_POPULATION:
+    case Column::CITY_GRADE: case Column::CITY_TYPE:
+        return 'c';
+    case Column::DRIVER_ID: case Column::DRIVER_NAME: case Column::DRIVER_BIRTH:
+        return 'd';
+    case Column::FINE_ID: case Column::FINE_TYPE: case Column::FINE_AMOUNT:
+    case Column::FINE_SEVERITY:
+        return 'f';
+    default:
+        return 'v';
+    }
+}
+
+// ======= Привязка условия к колонкам =======
+QueryEngine::BoundValue QueryEngine::bindValue(Column column, const QueryValue& value) const {
+    BoundValue bv{ 0.0, value.text };
+    switch (columnType(column)) {
+    case ColumnType::TEXT:
+        break;
+    case ColumnType::DATE:
+        bv.number = FineRegistry::dateKey(value.text);
+        if (bv.number == 0)
+            throw invalid_argument("Query: invalid date '" + value.text + "' (expected DD.MM.YYYY)");
+        break;
+    case ColumnType::ENUM: {
+        const char* const* names = (column == Column::CITY_GRADE) ? gradeNames
+            : (column == Column::CITY_TYPE) ? typeNames : severityNames;
+        string v = toLower(value.text);
+        for (int i = 0; i < 3; ++i) {
+            if (v == toLower(names[i])) {
+                bv.number = i;
+                bv.text = names[i];
+                return bv;
+            }
+        }
+        throw invalid_argument("Query: unknown value '" + value.text + "'");
+    }
+    case ColumnType::NUMBER:
+        if (column == Column::RECORD_PAID && !value.isNumber) {
+            string v = toLower(value.text);
+            if (v == "yes" || v == "true") bv.number = 1;
+            else if (v == "no" || v == "false") bv.number = 0;
+            else throw invalid_argument("Query: paid expects yes/no or 1/0");
+            break;
+        }
+        if (!value.isNumber)
+            throw invalid_argument("Query: number expected, got '" + value.text + "'");
+        bv.number = value.number;
+        break;
+    }
+    return bv;
+}
+
+QueryEngine::BoundExpr QueryEngine::bind(Target target, const QueryExpr& expr) const {
+    BoundExpr b;
+    b.kind = expr.kind;
+    b.op = expr.op;
+    b.column = Column::RECORD_ID;
+    b.text = expr.toString();
+    if (expr.kind == QueryExpr::Kind::AND || expr.kind == QueryExpr::Kind::OR
+        || expr.kind == QueryExpr::Kind::NOT) {
+        for (auto& child : expr.children) b.children.push_back(bind(target, child));
+        return b;
+    }
+    b.column = resolveColumn(target, expr.field);
+    if ((expr.kind == QueryExpr::Kind::CONTAINS || expr.kind == QueryExpr::Kind::STARTS)
+        && columnType(b.column) != ColumnType::TEXT) {
+        throw invalid_argument("Query: CONTAINS/STARTS apply only to text fields");
+    }
+    for (auto& v : expr.values) b.values.push_back(bindValue(b.column, v));
+    return b;
+}
+
+// ======= Чтение строк =======
+bool QueryEngine::loadRow(Target target, int id, Row& row) const {
+    row.hasCity = row.hasDriver = row.hasFine = row.hasViolation = false;
+    switch (target) {
+    case Target::CITIES:
+        row.hasCity = cities.getCityById(id, row.city);
+        return row.hasCity;
+    case Target::DRIVERS:
+        row.hasDriver = drivers.getDriverById(id, row.driver);
+        if (row.hasDriver) row.hasCity = cities.getCityById(row.driver.cityId, row.city);
+        return row.hasDriver;
+    case Target::FINES:
+        row.hasFine = fines.getFineById(id, row.fine);
+        return row.hasFine;
+    case Target::VIOLATIONS:
+        row.hasViolation = registry.findViolation(id, row.violation);
+        if (!row.hasViolation) return false;
+        row.hasDriver = drivers.getDriverById(row.violation.driverId, row.driver);
+        row.hasCity = cities.getCityById(row.violation.cityId, row.city);
+        row.hasFine = fines.getFineById(row.violation.fineId, row.fine);
+        return true;
+    }
+    return false;
+}
+
+bool QueryEngine::columnValue(const Row& row, Column column, double& number, std::string_view& text) const {
+    switch (column) {
+    case Column::CITY_ID:
+        // Внешний ключ берём из самой строки — так находится и "пустой" город (-1)
+        if (row.hasViolation) { number = row.violation.cityId; return true; }
+        if (row.hasDriver) { number = row.driver.cityId; return true; }
+        if (!row.hasCity) return false;
+        number = row.city.id;
+        return true;
+    case Column::CITY_NAME:       if (!row.hasCity) return false; text = row.city.name; return true;
+    case Column::CITY_POPULATION: if (!row.hasCity) return false; number = row.city.population; return true;
+    case Column::CITY_GRADE:      if (!row.hasCity) return false; number = static_cast<int>(row.city.grade); return true;
+    case Column::CITY_TYPE:       if (!row.hasCity) return false; number = static_cast<int>(row.city.type); return true;
+    case Column::DRIVER_ID:
+        if (row.hasViolation) { number = row.violation.driverId; return true; }
+        if (!row.hasDriver) return false;
+        number = row.driver.id;
+        return true;
+    case Column::DRIVER_NAME:     if (!row.hasDriver) return false; text = row.driver.fullName; return true;
+    case Column::DRIVER_BIRTH:
+        if (!row.hasDriver) return false;
+        number = FineRegistry::dateKey(row.driver.birthDate);
+        return number != 0;
+    case Column::FINE_ID:
+        if (row.hasViolation) { number = row.violation.fineId; return true; }
+        if (!row.hasFine) return false;
+        number = row.fine.id;
+        return true;
+    case Column::FINE_TYPE:       if (!row.hasFine) return false; text = row.fine.type; return true;
+    case Column::FINE_AMOUNT:     if (!row.hasFine) return false; number = row.fine.amount; return true;
+    case Column::FINE_SEVERITY:   if (!row.hasFine) return false; number = static_cast<int>(row.fine.severity); return true;
+    case Column::RECORD_ID:       if (!row.hasViolation) return false; number = row.violation.recordId; return true;
+    case Column::RECORD_PAID:     if (!row.hasViolation) return false; number = row.violation.paid ? 1 : 0; return true;
+    case Column::RECORD_DATE:
+        if (!row.hasViolation) return false;
+        number = FineRegistry::dateKey(row.violation.date);
+        return number != 0;
+    }
+    return false;
+}
+
+static bool compareValues(QueryExpr::Op op, int cmp) {
+    switch (op) {
+    case QueryExpr::Op::EQ: return cmp == 0;
+    case QueryExpr::Op::NE: return cmp != 0;
+    case QueryExpr::Op::LT: return cmp < 0;
+    case QueryExpr::Op::LE: return cmp <= 0;
+    case QueryExpr::Op::GT: return cmp > 0;
+    case QueryExpr::Op::GE: return cmp >= 0;
+    }
+    return false;
+}
+
+bool QueryEngine::evaluate(const BoundExpr& expr, const Row& row) const {
+    switch (expr.kind) {
+    case QueryExpr::Kind::AND:
+        for (auto& c : expr.children) if (!evaluate(c, row)) return false;
+        return true;
+    case QueryExpr::Kind::OR:
+        for (auto& c : expr.children) if (evaluate(c, row)) return true;
+        return false;
+    case QueryExpr::Kind::NOT:
+        return !evaluate(expr.children[0], row);
+    default:
+        break;
+    }
+
+    double number = 0.0;
+    string_view text;
+    if (!columnValue(row, expr.column, number, text)) return false;
+    bool isText = columnType(expr.column) == ColumnType::TEXT;
+
+    auto cmpWith = [&](const BoundValue& v) {
+        if (isText) return text.compare(v.text);
+        return (number < v.number) ? -1 : (number > v.number ? 1 : 0);
+    };
+
+    switch (expr.kind) {
+    case QueryExpr::Kind::COMPARE:
+        return compareValues(expr.op, cmpWith(expr.values[0]));
+    case QueryExpr::Kind::IN:
+        for (auto& v : expr.values) if (cmpWith(v) == 0) return true;
+        return false;
+    case QueryExpr::Kind::BETWEEN:
+        return cmpWith(expr.values[0]) >= 0 && cmpWith(expr.values[1]) <= 0;
+    case QueryExpr::Kind::CONTAINS:
+        return text.find(expr.values[0].text) != string::npos;
+    case QueryExpr::Kind::STARTS:
+        return text.compare(0, expr.values[0].text.size(), expr.values[0].text) == 0;
+    default:
+        return false;
+    }
+}
+
+// ======= Планировщик =======
+size_t QueryEngine::tableSize(Target target) const {
+    switch (target) {
+    case Target::CITIES:     return cities.getCityCount();
+    case Target::DRIVERS:    return drivers.getDriverCount();
+    case Target::FINES:      return fines.getFineCount();
+    case Target::VIOLATIONS: return registry.getRecordCount();
+    }
+    return 0;
+}
+
+// Условие целиком относится к одной связанной таблице (c / d / f)?
+bool QueryEngine::singleDimension(const BoundExpr& expr, char& table) const {
+    if (!expr.children.empty()) {
+        char first = 0;
+        for (auto& c : expr.children) {
+            char t;
+            if (!singleDimension(c, t)) return false;
+            if (first && t != first) return false;
+            first = t;
+        }
+        table = first;
+        return first != 0;
+    }
+    table = columnTable(expr.column);
+    return table != 'v';
+}
+
+static bool isEqualityLookup(const QueryExpr::Kind kind, QueryExpr::Op op) {
+    return kind == QueryExpr::Kind::IN || (kind == QueryExpr::Kind::COMPARE && op == QueryExpr::Op::EQ);
+}
+
+bool QueryEngine::planPredicate(Target target, const BoundExpr& expr, AccessPath& path) const {
+    using Kind = AccessPath::Kind;
+
+    if (expr.kind == QueryExpr::Kind::AND) {
+        bool found = false;
+        for (auto& c : expr.children) {
+            AccessPath p;
+            if (planPredicate(target, c, p) && (!found || p.estimate < path.estimate)) {
+                path = p;
+                found = true;
+            }
+        }
+        return found;
+    }
+    if (expr.kind == QueryExpr::Kind::OR) {
+        AccessPath u;
+        u.kind = Kind::UNION;
+        for (auto& c : expr.children) {
+            AccessPath p;
+            if (!planPredicate(target, c, p)) return false;
+            u.estimate += p.estimate;
+            u.parts.push_back(p);
+        }
+        u.description = "union of " + to_string(u.parts.size()) + " index paths";
+        path = u;
+        return true;
+    }
+    if (expr.kind == QueryExpr::Kind::NOT) {
+        return target == Target::VIOLATIONS && planSemiJoin(expr, path);
+    }
+
+    bool equality = isEqualityLookup(expr.kind, expr.op);
+    Column col = expr.column;
+
+    // Прямые ключи таблицы: id и уникальные/индексированные имена
+    if (equality && target != Target::VIOLATIONS) {
+        vector<int> ids;
+        string how;
+        for (auto& v : expr.values) {
+            int key = static_cast<int>(v.number);
+            if (target == Target::CITIES && col == Column::CITY_ID) {
+                if (cities.cityExists(key)) ids.push_back(key);
+                how = "id hash";
+            }
+            else if (target == Target::CITIES && col == Column::CITY_NAME) {
+                int id = cities.getCityIdByName(v.text);
+                if (id != -1) ids.push_back(id);
+                how = "name index";
+            }
+            else if (target == Target::DRIVERS && col == Column::DRIVER_ID) {
+                DriverTable::DriverInfo di;
+                if (drivers.getDriverById(key, di)) ids.push_back(key);
+                how = "id hash";
+            }
+            else if (target == Target::DRIVERS && col == Column::DRIVER_NAME) {
+                for (auto& d : drivers.findAllByName(v.text)) ids.push_back(d.id);
+                how = "name index";
+            }
+            else if (target == Target::FINES && col == Column::FINE_ID) {
+                FineTable::FineInfo fi;
+                if (fines.getFineById(key, fi)) ids.push_back(key);
+                how = "id hash";
+            }
+            else if (target == Target::FINES && col == Column::FINE_TYPE) {
+                int id = fines.getFineIdByType(v.text);
+                if (id != -1) ids.push_back(id);
+                how = "type index";
+            }
+            else {
+                return false;
+            }
+        }
+        path.kind = Kind::ID_LIST;
+        path.keys = ids;
+        path.estimate = ids.size();
+        path.description = how + " lookup " + expr.text;
+        return true;
+    }
+
+    // Подстрока / префикс имени — n-граммный индекс таблицы
+    // (короткий образец — SIMD-проход по упакованной куче)
+    if ((expr.kind == QueryExpr::Kind::CONTAINS || expr.kind == QueryExpr::Kind::STARTS)
+        && target != Target::VIOLATIONS) {
+        bool prefix = expr.kind == QueryExpr::Kind::STARTS;
+        const string& pattern = expr.values[0].text;
+        if (target == Target::CITIES && col == Column::CITY_NAME)
+            cities.nameSearch(pattern, prefix, path.keys);
+        else if (target == Target::DRIVERS && col == Column::DRIVER_NAME)
+            drivers.nameSearch(pattern, prefix, path.keys);
+        else if (target == Target::FINES && col == Column::FINE_TYPE)
+            fines.typeSearch(pattern, prefix, path.keys);
+        else
+            return false;
+        path.kind = Kind::ID_LIST;
+        path.estimate = path.keys.size();
+        const char* how = prefix ? "prefix index "
+            : pattern.size() >= NgramIndex::GRAM ? "trigram index "
+            : "simd scan ";
+        path.description = string(how) + expr.text;
+        return true;
+    }
+
+    if (target != Target::VIOLATIONS) return false;
+
+    // Реестр: первичный ключ
+    if (equality && col == Column::RECORD_ID) {
+        FineRegistry::ViolationInfo vi;
+        for (auto& v : expr.values) {
+            int key = static_cast<int>(v.number);
+            if (registry.findViolation(key, vi)) path.keys.push_back(key);
+        }
+        path.kind = Kind::ID_LIST;
+        path.estimate = path.keys.size();
+        path.description = "record id hash lookup " + expr.text;
+        return true;
+    }
+
+    // Реестр: индекс по дате
+    if (col == Column::RECORD_DATE) {
+        const IntMultiIndex& idx = registry.getDateIndex();
+        if (expr.kind == QueryExpr::Kind::IN) {
+            AccessPath u;
+            u.kind = Kind::UNION;
+            for (auto& v : expr.values) {
+                AccessPath p;
+                p.kind = Kind::DATE_RANGE;
+                p.lo = p.hi = static_cast<int>(v.number);
+                p.estimate = idx.count(p.lo);
+                u.estimate += p.estimate;
+                u.parts.push_back(p);
+            }
+            u.description = "date index lookup " + expr.text;
+            path = u;
+            return true;
+        }
+        int lo = 1, hi = INT_MAX;
+        if (expr.kind == QueryExpr::Kind::BETWEEN) {
+            lo = static_cast<int>(expr.values[0].number);
+            hi = static_cast<int>(expr.values[1].number);
+        }
+        else if (expr.kind == QueryExpr::Kind::COMPARE) {
+            int k = static_cast<int>(expr.values[0].number);
+            switch (expr.op) {
+            case QueryExpr::Op::EQ: lo = hi = k; break;
+            case QueryExpr::Op::LT: hi = k - 1; break;
+            case QueryExpr::Op::LE: hi = k; break;
+            case QueryExpr::Op::GT: lo = k + 1; break;
+            case QueryExpr::Op::GE: lo = k; break;
+            default: return false;
+            }
+        }
+        else {
+            return false;
+        }
+        path.kind = Kind::DATE_RANGE;
+        path.lo = lo;
+        path.hi = hi;
+        path.estimate = idx.countRange(lo, hi);
+        path.description = "date index range " + expr.text;
+        return true;
+    }
+
+    // Реестр: вторичные индексы по внешним ключам
+    if (equality && (col == Column::DRIVER_ID || col == Column::CITY_ID || col == Column::FINE_ID)) {
+        const IntMultiIndex& idx = (col == Column::DRIVER_ID) ? registry.getDriverIndex()
+            : (col == Column::CITY_ID) ? registry.getCityIndex() : registry.getFineIndex();
+        path.kind = (col == Column::DRIVER_ID) ? Kind::DRIVER_INDEX
+            : (col == Column::CITY_ID) ? Kind::CITY_INDEX : Kind::FINE_INDEX;
+        for (auto& v : expr.values) {
+            int key = static_cast<int>(v.number);
+            path.keys.push_back(key);
+            path.estimate += idx.count(key);
+        }
+        path.description = "secondary index lookup " + expr.text;
+        return true;
+    }
+
+    return planSemiJoin(expr, path);
+}
+
+// Условие может выполниться у нарушения без строки в связанной таблице
+// (ключ -1 после SET_NULL или на удалённую запись)? Значение id-колонки
+// такого нарушения — сам ключ, остальные колонки пусты.
+bool QueryEngine::holdsForMissing(const BoundExpr& expr) const {
+    // Ключ висячей ссылки может быть любым — такое условие одной
+    // "пустой" строкой не проверить
+    if (usesForeignKey(expr)) return true;
+    Row missing;
+    return evaluate(expr, missing);
+}
+
+bool QueryEngine::usesForeignKey(const BoundExpr& expr) {
+    for (auto& c : expr.children)
+        if (usesForeignKey(c)) return true;
+    return expr.children.empty()
+        && (expr.column == Column::CITY_ID || expr.column == Column::DRIVER_ID || expr.column == Column::FINE_ID);
+}
+
+// Semi-join: условие на связанную таблицу вычисляется по ней самой
+// (маленькой), а найденные ключи подставляются во вторичный индекс реестра.
+// Ключи берутся только у существующих строк, поэтому условия, верные и
+// для отсутствующей строки, так не планируются — их проверяет полный проход.
+bool QueryEngine::planSemiJoin(const BoundExpr& expr, AccessPath& path) const {
+    char table;
+    if (!singleDimension(expr, table) || holdsForMissing(expr)) return false;
+
+    Target dim = (table == 'c') ? Target::CITIES : (table == 'd') ? Target::DRIVERS : Target::FINES;
+    vector<AccessPath> dimPaths;
+    collectCandidates(dim, expr, dimPaths);
+    AccessPath dimPath;
+    for (auto& p : dimPaths) {
+        if (dimPath.kind == AccessPath::Kind::FULL_SCAN || p.estimate < dimPath.estimate) dimPath = p;
+    }
+    vector<int> dimIds;
+    materialize(dim, dimPath, dimIds);
+
+    const IntMultiIndex& idx = (table == 'c') ? registry.getCityIndex()
+        : (table == 'd') ? registry.getDriverIndex() : registry.getFineIndex();
+    path.kind = (table == 'c') ? AccessPath::Kind::CITY_INDEX
+        : (table == 'd') ? AccessPath::Kind::DRIVER_INDEX : AccessPath::Kind::FINE_INDEX;
+    path.keys.clear();
+    path.estimate = 0;
+    Row row;
+    for (int id : dimIds) {
+        if (loadRow(dim, id, row) && evaluate(expr, row)) {
+            path.keys.push_back(id);
+            path.estimate += idx.count(id);
+        }
+    }
+    const char* dimName = (table == 'c') ? "cities" : (table == 'd') ? "drivers" : "fines";
+    const char* idxName = (table == 'c') ? "city" : (table == 'd') ? "driver" : "fine";
+    path.description = string("semi-join ") + dimName + " " + expr.text + " -> "
+        + idxName + " index (" + to_string(path.keys.size()) + " keys)";
+    return true;
+}
+
+void QueryEngine::collectCandidates(Target target, const BoundExpr& expr, std::vector<AccessPath>& out) const {
+    AccessPath p;
+    if (expr.kind == QueryExpr::Kind::AND) {
+        // Всё условие целиком может уйти в одну связанную таблицу
+        char table;
+        if (target == Target::VIOLATIONS && singleDimension(expr, table) && planSemiJoin(expr, p)) {
+            out.push_back(p);
+        }
+        for (auto& c : expr.children) {
+            AccessPath cp;
+            if (planPredicate(target, c, cp)) out.push_back(cp);
+        }
+        return;
+    }
+    if (planPredicate(target, expr, p)) out.push_back(p);
+}
+
+void QueryEngine::fullScanIds(Target target, std::vector<int>& ids) const {
+    switch (target) {
+    case Target::CITIES:
+        cities.cityIteratorReset();
+        while (cities.cityIteratorHasNext()) ids.push_back(cities.cityIteratorNext().id);
+        break;
+    case Target::DRIVERS:
+        drivers.driverIteratorReset();
+        while (drivers.driverIteratorHasNext()) ids.push_back(drivers.driverIteratorNext().id);
+        break;
+    case Target::FINES:
+        fines.fineIteratorReset();
+        while (fines.fineIteratorHasNext()) ids.push_back(fines.fineIteratorNext().id);
+        break;
+    case Target::VIOLATIONS:
+        ids = registry.getAllRecordIds();
+        break;
+    }
+}
+
+void QueryEngine::materialize(Target target, const AccessPath& path, std::vector<int>& ids) const {
+    switch (path.kind) {
+    case AccessPath::Kind::FULL_SCAN:
+        fullScanIds(target, ids);
+        break;
+    case AccessPath::Kind::ID_LIST:
+        ids.insert(ids.end(), path.keys.begin(), path.keys.end());
+        break;
+    case AccessPath::Kind::DRIVER_INDEX:
+    case AccessPath::Kind::CITY_INDEX:
+    case AccessPath::Kind::FINE_INDEX: {
+        const IntMultiIndex& idx = (path.kind == AccessPath::Kind::DRIVER_INDEX) ? registry.getDriverIndex()
+            : (path.kind == AccessPath::Kind::CITY_INDEX) ? registry.getCityIndex() : registry.getFineIndex();
+        ColdBlock::Column column = (path.kind == AccessPath::Kind::DRIVER_INDEX) ? ColdBlock::Column::DRIVER
+            : (path.kind == AccessPath::Kind::CITY_INDEX) ? ColdBlock::Column::CITY : ColdBlock::Column::FINE;
+        for (int key : path.keys) {
+            const vector<int>* rows = idx.find(key);
+            if (rows) ids.insert(ids.end(), rows->begin(), rows->end());
+            // Холодные записи в индексах не лежат — дочитываются из блоков
+            if (registry.getColdCount()) registry.collectCold(column, key, key, ids);
+        }
+        break;
+    }
+    case AccessPath::Kind::DATE_RANGE:
+        registry.getDateIndex().collectRange(path.lo, path.hi, ids);
+        if (registry.getColdCount()) registry.collectCold(ColdBlock::Column::DATE, path.lo, path.hi, ids);
+        break;
+    case AccessPath::Kind::UNION:
+        for (auto& p : path.parts) materialize(target, p, ids);
+        break;
+    }
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+}
+
+// ======= Упорядочение =======
+std::vector<QueryEngine::BoundOrder> QueryEngine::bindOrder(Target target,
+    const std::vector<QueryOrder>& keys) const
+{
+    vector<BoundOrder> order;
+    for (auto& k : keys) {
+        order.push_back({ resolveColumn(target, k.field), k.descending,
+            k.field + (k.descending ? " DESC" : " ASC") });
+    }
+    return order;
+}
+
+QueryEngine::OrderMethod QueryEngine::chooseOrder(Target target,
+    const std::vector<BoundOrder>& order, const AccessPath& chosen, const Query& query) const
+{
+    if (order.empty()) return OrderMethod::NONE;
+    // Собственный id таблицы: ids пути доступа уже идут по возрастанию
+    Column first = order[0].column;
+    bool primaryKey = (target == Target::CITIES && first == Column::CITY_ID)
+        || (target == Target::DRIVERS && first == Column::DRIVER_ID)
+        || (target == Target::FINES && first == Column::FINE_ID)
+        || (target == Target::VIOLATIONS && first == Column::RECORD_ID);
+    if (primaryKey) return OrderMethod::PRIMARY_KEY;
+    // Индекс дат упорядочен — выгоден, если иначе пришлось бы читать всё
+    // (холодных записей в нём нет — тогда обычная сортировка)
+    if (target == Target::VIOLATIONS && first == Column::RECORD_DATE && registry.getColdCount() == 0
+        && (chosen.kind == AccessPath::Kind::FULL_SCAN || chosen.kind == AccessPath::Kind::DATE_RANGE)) {
+        return OrderMethod::DATE_INDEX;
+    }
+    if (query.hasLimit && query.limit < chosen.estimate) return OrderMethod::TOP_N;
+    return OrderMethod::SORT;
+}
+
+QueryEngine::SortRow QueryEngine::sortRow(int id, const Row& row,
+    const std::vector<BoundOrder>& order) const
+{
+    SortRow r{ id, vector<SortValue>(order.size()) };
+    for (size_t i = 0; i < order.size(); ++i) {
+        SortValue& v = r.keys[i];
+        v.number = 0.0;
+        v.present = columnValue(row, order[i].column, v.number, v.text);
+    }
+    return r;
+}
+
+// Сравнение по ключам ORDER BY; пустые значения — в конце, при
+// равенстве — по id, чтобы порядок не зависел от способа сортировки
+namespace {
+    struct SortLess {
+        const vector<bool>* descending;
+        const vector<bool>* text;     // текстовая колонка — сравнение строк
+
+        template <class SortRow>
+        bool operator()(const SortRow& a, const SortRow& b) const {
+            for (size_t i = 0; i < a.keys.size(); ++i) {
+                const auto& x = a.keys[i];
+                const auto& y = b.keys[i];
+                if (x.present != y.present) return x.present;
+                if (!x.present) continue;
+                int cmp = (*text)[i] ? x.text.compare(y.text)
+                    : (x.number < y.number ? -1 : (x.number > y.number ? 1 : 0));
+                if (cmp != 0) return (*descending)[i] ? cmp > 0 : cmp < 0;
+            }
+            return a.id < b.id;
+        }
+    };
+}
+
+// Куски сортируются на пуле, затем сливаются попарно, тоже на пуле
+template <class T, class Less>
+static void parallelSort(vector<T>& items, Less less, size_t minRows) {
+    if (items.size() < minRows) {
+        sort(items.begin(), items.end(), less);
+        return;
+    }
+    ThreadPool pool;
+    size_t parts = pool.size();
+    vector<size_t> bounds(parts + 1);
+    for (size_t i = 0; i <= parts; ++i) bounds[i] = items.size() * i / parts;
+    auto at = [&](size_t part) { return items.begin() + static_cast<ptrdiff_t>(bounds[part]); };
+    pool.parallelFor(parts, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) sort(at(p), at(p + 1), less);
+    });
+    for (size_t width = 1; width < parts; width *= 2) {
+        size_t pairs = (parts + 2 * width - 1) / (2 * width);
+        pool.parallelFor(pairs, [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                size_t lo = p * 2 * width;
+                size_t mid = min(lo + width, parts), hi = min(lo + 2 * width, parts);
+                if (mid < hi) inplace_merge(at(lo), at(mid), at(hi), less);
+            }
+        });
+    }
+}
+
+// ======= Вывод =======
+std::vector<std::string> QueryEngine::headerFor(Target target) const {
+    switch (target) {
+    case Target::CITIES:  return { "ID", "Name", "Population", "Grade", "Type" };
+    case Target::DRIVERS: return { "ID", "Full Name", "Birth Date", "City" };
+    case Target::FINES:   return { "ID", "Type", "Amount", "Severity" };
+    default:              return { "ID", "Driver", "City", "Fine", "Date", "Paid", "Amount" };
+    }
+}
+
+// Строки результата копируются только здесь, при выводе
+std::vector<std::string> QueryEngine::formatRow(Target target, const Row& row) const {
+    const string_view none;
+    switch (target) {
+    case Target::CITIES:
+        return { to_string(row.city.id), string(row.city.name), to_string(row.city.population),
+            CityTable::populationGradeToString(row.city.grade),
+            CityTable::settlementTypeToString(row.city.type) };
+    case Target::DRIVERS:
+        return { to_string(row.driver.id), string(row.driver.fullName), string(row.driver.birthDate),
+            string(row.hasCity ? row.city.name : none) };
+    case Target::FINES:
+        return { to_string(row.fine.id), string(row.fine.type), formatAmount(row.fine.amount),
+            FineTable::severityToString(row.fine.severity) };
+    default:
+        return { to_string(row.violation.recordId),
+            string(row.hasDriver ? row.driver.fullName : none),
+            string(row.hasCity ? row.city.name : none),
+            string(row.hasFine ? row.fine.type : none),
+            string(row.violation.date),
+            row.violation.paid ? "Yes" : "No",
+            row.hasFine ? formatAmount(row.fine.amount) : "0" };
+    }
+}
+
+// ======= Выполнение =======
+QueryResult QueryEngine::execute(const std::string& text) const {
+    Query query = QueryParser::parse(text);
+    Target target = parseTarget(query.target);
+
+    BoundExpr where;
+    vector<AccessPath> candidates;
+    if (query.hasWhere) {
+        where = bind(target, query.where);
+        if (!fullScanOnly) collectCandidates(target, where, candidates);
+    }
+
+    size_t rows = tableSize(target);
+    AccessPath chosen;
+    chosen.estimate = rows;
+    chosen.description = "full scan";
+    for (auto& p : candidates) {
+        if (p.estimate < chosen.estimate) chosen = p;
+    }
+
+    ostringstream plan;
+    plan << "Table: " << query.target << " (" << rows << " rows)\n";
+    if (!candidates.empty()) {
+        plan << "Candidate access paths:\n";
+        for (auto& p : candidates) {
+            plan << "  - " << p.description << ", ~" << p.estimate << " rows\n";
+        }
+    }
+    plan << "Chosen: " << chosen.description << ", ~" << chosen.estimate << " rows\n";
+    plan << "Filter: " << (query.hasWhere ? where.text : "none") << "\n";
+
+    vector<BoundOrder> order = bindOrder(target, query.orderBy);
+    OrderMethod method = chooseOrder(target, order, chosen, query);
+    if (!order.empty()) {
+        plan << "Order: ";
+        for (size_t i = 0; i < order.size(); ++i) plan << (i ? ", " : "") << order[i].text;
+        switch (method) {
+        case OrderMethod::PRIMARY_KEY: plan << " via id order"; break;
+        case OrderMethod::DATE_INDEX:  plan << " via date index walk"; break;
+        case OrderMethod::TOP_N:       plan << " via top-" << query.limit << " heap"; break;
+        default:
+            plan << " via " << (chosen.estimate >= PARALLEL_SORT_ROWS ? "parallel sort" : "sort");
+            break;
+        }
+        plan << "\n";
+    }
+    if (query.hasLimit) plan << "Limit: " << query.limit << "\n";
+
+    QueryResult result;
+    result.columns = headerFor(target);
+    result.explainOnly = query.explain;
+    if (query.explain) {
+        result.plan = plan.str();
+        return result;
+    }
+
+    size_t limit = query.hasLimit ? query.limit : SIZE_MAX;
+    Row row;
+    auto matches = [&](int id) {
+        ++result.rowsExamined;
+        return loadRow(target, id, row) && (!query.hasWhere || evaluate(where, row));
+    };
+
+    vector<bool> descending, textKey;
+    for (auto& o : order) {
+        descending.push_back(o.descending);
+        textKey.push_back(columnType(o.column) == ColumnType::TEXT);
+    }
+    SortLess less{ &descending, &textKey };
+
+    vector<int> ids;
+    if (method == OrderMethod::DATE_INDEX) {
+        // Корзины индекса — уже по дате; внутри корзины — по остальным ключам
+        vector<int> ordered;
+        vector<SortRow> bucket;
+        auto visit = [&](int, const vector<int>& rows) {
+            bucket.clear();
+            for (int id : rows)
+                if (matches(id)) bucket.push_back(sortRow(id, row, order));
+            sort(bucket.begin(), bucket.end(), less);
+            for (auto& r : bucket) ordered.push_back(r.id);
+            return ordered.size() < limit;
+        };
+        const IntMultiIndex& idx = registry.getDateIndex();
+        bool full = chosen.kind == AccessPath::Kind::FULL_SCAN;
+        idx.visitRange(full ? 1 : chosen.lo, full ? INT_MAX : chosen.hi, order[0].descending, visit);
+        if (full && ordered.size() < limit) idx.visitRange(0, 0, false, visit);   // даты без значения
+        if (ordered.size() > limit) ordered.resize(limit);
+        ids.swap(ordered);
+    }
+    else {
+        materialize(target, chosen, ids);
+        if (method == OrderMethod::NONE || method == OrderMethod::PRIMARY_KEY) {
+            if (method == OrderMethod::PRIMARY_KEY && order[0].descending) reverse(ids.begin(), ids.end());
+            vector<int> selected;
+            for (size_t i = 0; i < ids.size() && selected.size() < limit; ++i)
+                if (matches(ids[i])) selected.push_back(ids[i]);
+            ids.swap(selected);
+        }
+        else {
+            vector<SortRow> sorted;
+            if (method == OrderMethod::TOP_N) {
+                // Куча из limit лучших строк: на вершине — худшая из них
+                for (int id : ids) {
+                    if (limit == 0 || !matches(id)) continue;
+                    SortRow r = sortRow(id, row, order);
+                    if (sorted.size() < limit) {
+                        sorted.push_back(move(r));
+                        push_heap(sorted.begin(), sorted.end(), less);
+                    }
+                    else if (less(r, sorted.front())) {
+                        pop_heap(sorted.begin(), sorted.end(), less);
+                        sorted.back() = move(r);
+                        push_heap(sorted.begin(), sorted.end(), less);
+                    }
+                }
+                sort_heap(sorted.begin(), sorted.end(), less);
+            }
+            else {
+                for (int id : ids)
+                    if (matches(id)) sorted.push_back(sortRow(id, row, order));
+                parallelSort(sorted, less, PARALLEL_SORT_ROWS);
+                if (sorted.size() > limit) sorted.resize(limit);
+            }
+            ids.clear();
+            for (auto& r : sorted) ids.push_back(r.id);
+        }
+    }
+
+    for (int id : ids) {
+        if (loadRow(target, id, row)) result.rows.push_back(formatRow(target, row));
+    }
+    plan << "Examined: " << result.rowsExamined << ", returned: " << result.rows.size() << "\n";
+    result.plan = plan.str();
+    return result;
+}
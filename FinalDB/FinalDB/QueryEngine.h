@@ -0,0 +1,141 @@
+#pragma once
+#include "CityTable.h"
+#include "DriverTable.h"
+#include "FineTable.h"
+#include "FineRegistry.h"
+#include "QueryParser.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Результат выполнения запроса
+struct QueryResult {
+    std::vector<std::string> columns;
+    std::vector<std::vector<std::string>> rows;
+    std::string plan;        // текст плана (заполняется всегда)
+    bool explainOnly = false;
+    size_t rowsExamined = 0; // строк прочитано по выбранному пути доступа
+};
+
+// Планировщик и исполнитель запросов над четырьмя таблицами.
+// Вместо полного прохода выбирает путь доступа по индексам:
+// id, имя/тип, дата нарушения, а для violations — вторичные индексы
+// реестра (driverId / cityId / fineId), в т.ч. через semi-join по
+// условиям на связанные таблицы (например, city.grade = Large).
+// ORDER BY по id таблицы и по дате нарушения идёт обходом индекса с
+// остановкой на LIMIT; иначе — частичная сортировка кучей на LIMIT строк
+// или параллельная сортировка всех подходящих строк.
+class QueryEngine {
+public:
+    QueryEngine(const CityTable& cities, const DriverTable& drivers,
+        const FineTable& fines, const FineRegistry& registry);
+
+    QueryResult execute(const std::string& text) const;
+
+    // Только полный проход, без индексов и semi-join: эталон для сверки
+    // результатов выбранных планов
+    void setFullScanOnly(bool on) { fullScanOnly = on; }
+
+private:
+    enum class Target { CITIES, DRIVERS, FINES, VIOLATIONS };
+
+    enum class Column {
+        CITY_ID, CITY_NAME, CITY_POPULATION, CITY_GRADE, CITY_TYPE,
+        DRIVER_ID, DRIVER_NAME, DRIVER_BIRTH,
+        FINE_ID, FINE_TYPE, FINE_AMOUNT, FINE_SEVERITY,
+        RECORD_ID, RECORD_PAID, RECORD_DATE
+    };
+    enum class ColumnType { NUMBER, TEXT, ENUM, DATE };
+
+    // Условие, привязанное к колонкам конкретной таблицы
+    struct BoundValue {
+        double number;
+        std::string text;
+    };
+    struct BoundExpr {
+        QueryExpr::Kind kind;
+        QueryExpr::Op op;
+        Column column;
+        std::vector<BoundValue> values;
+        std::vector<BoundExpr> children;
+        std::string text;        // исходное условие (для EXPLAIN)
+    };
+
+    // Одна строка вместе со связанными записями
+    struct Row {
+        CityTable::CityInfo city;
+        DriverTable::DriverInfo driver;
+        FineTable::FineInfo fine;
+        FineRegistry::ViolationInfo violation;
+        bool hasCity = false, hasDriver = false, hasFine = false, hasViolation = false;
+    };
+
+    // Ключ ORDER BY, привязанный к колонке
+    struct BoundOrder {
+        Column column;
+        bool descending;
+        std::string text;        // для EXPLAIN
+    };
+    // Значение ключа сортировки; строки без значения идут в конец
+    struct SortValue {
+        bool present;
+        double number;
+        std::string_view text;   // view в пул строк
+    };
+    struct SortRow {
+        int id;
+        std::vector<SortValue> keys;
+    };
+    enum class OrderMethod { NONE, PRIMARY_KEY, DATE_INDEX, TOP_N, SORT };
+
+    // Меньше — сортировка в одном потоке
+    static const size_t PARALLEL_SORT_ROWS = 1 << 16;
+
+    // Путь доступа к строкам
+    struct AccessPath {
+        enum class Kind { FULL_SCAN, ID_LIST, DRIVER_INDEX, CITY_INDEX, FINE_INDEX, DATE_RANGE, UNION };
+        Kind kind = Kind::FULL_SCAN;
+        std::vector<int> keys;            // id строк или ключи индекса
+        int lo = 0, hi = 0;               // для DATE_RANGE
+        std::vector<AccessPath> parts;    // для UNION
+        size_t estimate = 0;
+        std::string description;
+    };
+
+    const CityTable& cities;
+    const DriverTable& drivers;
+    const FineTable& fines;
+    const FineRegistry& registry;
+    bool fullScanOnly = false;
+
+    static Target parseTarget(const std::string& name);
+    static Column resolveColumn(Target target, const std::string& field);
+    static ColumnType columnType(Column column);
+    static char columnTable(Column column);   // 'c', 'd', 'f', 'v'
+
+    BoundExpr bind(Target target, const QueryExpr& expr) const;
+    BoundValue bindValue(Column column, const QueryValue& value) const;
+
+    bool loadRow(Target target, int id, Row& row) const;
+    bool columnValue(const Row& row, Column column, double& number, std::string_view& text) const;
+    bool evaluate(const BoundExpr& expr, const Row& row) const;
+
+    size_t tableSize(Target target) const;
+    bool singleDimension(const BoundExpr& expr, char& table) const;
+    bool planPredicate(Target target, const BoundExpr& expr, AccessPath& path) const;
+    bool planSemiJoin(const BoundExpr& expr, AccessPath& path) const;
+    bool holdsForMissing(const BoundExpr& expr) const;
+    static bool usesForeignKey(const BoundExpr& expr);
+    void collectCandidates(Target target, const BoundExpr& expr, std::vector<AccessPath>& out) const;
+    void materialize(Target target, const AccessPath& path, std::vector<int>& ids) const;
+    void fullScanIds(Target target, std::vector<int>& ids) const;
+
+    std::vector<BoundOrder> bindOrder(Target target, const std::vector<QueryOrder>& keys) const;
+    OrderMethod chooseOrder(Target target, const std::vector<BoundOrder>& order,
+        const AccessPath& chosen, const Query& query) const;
+    SortRow sortRow(int id, const Row& row, const std::vector<BoundOrder>& order) const;
+
+    std::vector<std::string> headerFor(Target target) const;
+    std::vector<std::string> formatRow(Target target, const Row& row) const;
+};
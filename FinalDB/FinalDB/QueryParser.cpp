@@ -0,0 +1,316 @@
+#include "QueryParser.h"
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+static bool equalsIgnoreCase(const string& a, const char* b) {
+    size_t i = 0;
+    for (; i < a.size() && b[i]; ++i) {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+    return i == a.size() && b[i] == '\0';
+}
+
+static bool isWordChar(char c) {
+    return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '-';
+}
+
+static QueryValue makeValue(const string& text, bool quoted) {
+    QueryValue v{ text, 0.0, false };
+    if (!quoted && !text.empty()) {
+        char* end = nullptr;
+        double d = strtod(text.c_str(), &end);
+        if (end && *end == '\0') {
+            v.number = d;
+            v.isNumber = true;
+        }
+    }
+    return v;
+}
+
+// ===== Текстовое представление условия (для EXPLAIN) =====
+static const char* opToString(QueryExpr::Op op) {
+    switch (op) {
+    case QueryExpr::Op::EQ: return "=";
+    case QueryExpr::Op::NE: return "!=";
+    case QueryExpr::Op::LT: return "<";
+    case QueryExpr::Op::LE: return "<=";
+    case QueryExpr::Op::GT: return ">";
+    case QueryExpr::Op::GE: return ">=";
+    }
+    return "?";
+}
+
+static string valueToString(const QueryValue& v) {
+    if (v.isNumber) return v.text;
+    return "\"" + v.text + "\"";
+}
+
+string QueryExpr::toString() const {
+    ostringstream oss;
+    switch (kind) {
+    case Kind::AND:
+    case Kind::OR:
+        oss << "(";
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (i) oss << (kind == Kind::AND ? " AND " : " OR ");
+            oss << children[i].toString();
+        }
+        oss << ")";
+        break;
+    case Kind::NOT:
+        oss << "NOT " << children[0].toString();
+        break;
+    case Kind::COMPARE:
+        oss << field << " " << opToString(op) << " " << valueToString(values[0]);
+        break;
+    case Kind::IN:
+        oss << field << " IN (";
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i) oss << ", ";
+            oss << valueToString(values[i]);
+        }
+        oss << ")";
+        break;
+    case Kind::BETWEEN:
+        oss << field << " BETWEEN " << valueToString(values[0])
+            << " AND " << valueToString(values[1]);
+        break;
+    case Kind::CONTAINS:
+        oss << field << " CONTAINS " << valueToString(values[0]);
+        break;
+    case Kind::STARTS:
+        oss << field << " STARTS WITH " << valueToString(values[0]);
+        break;
+    }
+    return oss.str();
+}
+
+// ===== Лексический анализ =====
+QueryParser::QueryParser(const std::string& text) : pos(0) {
+    tokenize(text);
+}
+
+void QueryParser::tokenize(const std::string& text) {
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        }
+        else if (c == '"' || c == '\'') {
+            size_t end = text.find(c, i + 1);
+            if (end == string::npos)
+                throw invalid_argument("Query: unterminated string literal");
+            tokens.push_back({ Token::Type::STRING, text.substr(i + 1, end - i - 1) });
+            i = end + 1;
+        }
+        else if (isWordChar(c)) {
+            size_t start = i;
+            while (i < text.size() && isWordChar(text[i])) ++i;
+            tokens.push_back({ Token::Type::WORD, text.substr(start, i - start) });
+        }
+        else if ((c == '<' || c == '>' || c == '!') && i + 1 < text.size()
+            && (text[i + 1] == '=' || (c == '<' && text[i + 1] == '>'))) {
+            tokens.push_back({ Token::Type::SYMBOL, text.substr(i, 2) });
+            i += 2;
+        }
+        else if (c == '(' || c == ')' || c == ',' || c == '=' || c == '<' || c == '>') {
+            tokens.push_back({ Token::Type::SYMBOL, string(1, c) });
+            ++i;
+        }
+        else {
+            throw invalid_argument(string("Query: unexpected character '") + c + "'");
+        }
+    }
+    tokens.push_back({ Token::Type::END, "" });
+}
+
+const QueryParser::Token& QueryParser::peek() const {
+    return tokens[pos];
+}
+
+QueryParser::Token QueryParser::next() {
+    Token t = tokens[pos];
+    if (t.type != Token::Type::END) ++pos;
+    return t;
+}
+
+bool QueryParser::peekKeyword(const char* keyword) const {
+    return peek().type == Token::Type::WORD && equalsIgnoreCase(peek().text, keyword);
+}
+
+bool QueryParser::acceptKeyword(const char* keyword) {
+    if (!peekKeyword(keyword)) return false;
+    ++pos;
+    return true;
+}
+
+bool QueryParser::acceptSymbol(const char* symbol) {
+    if (peek().type != Token::Type::SYMBOL || peek().text != symbol) return false;
+    ++pos;
+    return true;
+}
+
+void QueryParser::expectSymbol(const char* symbol) {
+    if (!acceptSymbol(symbol))
+        throw invalid_argument(string("Query: expected '") + symbol + "' near '" + peek().text + "'");
+}
+
+// ===== Синтаксический анализ =====
+Query QueryParser::parse(const std::string& text) {
+    QueryParser parser(text);
+    return parser.parseQuery();
+}
+
+Query QueryParser::parseQuery() {
+    Query q;
+    q.explain = acceptKeyword("explain");
+    if (peek().type != Token::Type::WORD)
+        throw invalid_argument("Query: expected table name (cities, drivers, fines, violations)");
+    q.target = next().text;
+    for (char& c : q.target) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    if (acceptKeyword("where")) {
+        q.hasWhere = true;
+        q.where = parseOr();
+    }
+    if (acceptKeyword("order")) {
+        if (!acceptKeyword("by"))
+            throw invalid_argument("Query: expected BY after ORDER");
+        q.orderBy.push_back(parseOrderKey());
+        while (acceptSymbol(",")) q.orderBy.push_back(parseOrderKey());
+    }
+    if (acceptKeyword("limit")) {
+        const Token& t = peek();
+        char* end = nullptr;
+        long n = t.type == Token::Type::WORD ? strtol(t.text.c_str(), &end, 10) : -1;
+        if (!end || *end != '\0' || n < 0)
+            throw invalid_argument("Query: expected row count after LIMIT near '" + t.text + "'");
+        next();
+        q.hasLimit = true;
+        q.limit = static_cast<size_t>(n);
+    }
+    if (peek().type != Token::Type::END)
+        throw invalid_argument("Query: unexpected '" + peek().text + "'");
+    return q;
+}
+
+QueryExpr QueryParser::parseOr() {
+    QueryExpr left = parseAnd();
+    if (!peekKeyword("or")) return left;
+    QueryExpr node;
+    node.kind = QueryExpr::Kind::OR;
+    node.children.push_back(std::move(left));
+    while (acceptKeyword("or")) {
+        node.children.push_back(parseAnd());
+    }
+    return node;
+}
+
+QueryExpr QueryParser::parseAnd() {
+    QueryExpr left = parseFactor();
+    if (!peekKeyword("and")) return left;
+    QueryExpr node;
+    node.kind = QueryExpr::Kind::AND;
+    node.children.push_back(std::move(left));
+    while (acceptKeyword("and")) {
+        node.children.push_back(parseFactor());
+    }
+    return node;
+}
+
+QueryExpr QueryParser::parseFactor() {
+    if (acceptKeyword("not")) {
+        QueryExpr node;
+        node.kind = QueryExpr::Kind::NOT;
+        node.children.push_back(parseFactor());
+        return node;
+    }
+    if (acceptSymbol("(")) {
+        QueryExpr inner = parseOr();
+        expectSymbol(")");
+        return inner;
+    }
+    return parsePredicate();
+}
+
+QueryExpr QueryParser::parsePredicate() {
+    if (peek().type != Token::Type::WORD)
+        throw invalid_argument("Query: expected field name near '" + peek().text + "'");
+    QueryExpr node;
+    node.field = next().text;
+
+    bool negate = false;
+    if (acceptKeyword("not")) {
+        if (!peekKeyword("in"))
+            throw invalid_argument("Query: expected IN after NOT");
+        negate = true;
+    }
+
+    if (acceptKeyword("in")) {
+        node.kind = QueryExpr::Kind::IN;
+        expectSymbol("(");
+        node.values.push_back(parseValue());
+        while (acceptSymbol(",")) node.values.push_back(parseValue());
+        expectSymbol(")");
+    }
+    else if (acceptKeyword("between")) {
+        node.kind = QueryExpr::Kind::BETWEEN;
+        node.values.push_back(parseValue());
+        if (!acceptKeyword("and"))
+            throw invalid_argument("Query: expected AND in BETWEEN");
+        node.values.push_back(parseValue());
+    }
+    else if (acceptKeyword("contains")) {
+        node.kind = QueryExpr::Kind::CONTAINS;
+        node.values.push_back(parseValue());
+    }
+    else if (acceptKeyword("starts")) {
+        acceptKeyword("with");
+        node.kind = QueryExpr::Kind::STARTS;
+        node.values.push_back(parseValue());
+    }
+    else {
+        node.kind = QueryExpr::Kind::COMPARE;
+        if (acceptSymbol("=")) node.op = QueryExpr::Op::EQ;
+        else if (acceptSymbol("!=") || acceptSymbol("<>")) node.op = QueryExpr::Op::NE;
+        else if (acceptSymbol("<=")) node.op = QueryExpr::Op::LE;
+        else if (acceptSymbol(">=")) node.op = QueryExpr::Op::GE;
+        else if (acceptSymbol("<")) node.op = QueryExpr::Op::LT;
+        else if (acceptSymbol(">")) node.op = QueryExpr::Op::GT;
+        else throw invalid_argument("Query: expected operator after '" + node.field + "'");
+        node.values.push_back(parseValue());
+    }
+
+    if (negate) {
+        QueryExpr wrapper;
+        wrapper.kind = QueryExpr::Kind::NOT;
+        wrapper.children.push_back(std::move(node));
+        return wrapper;
+    }
+    return node;
+}
+
+QueryOrder QueryParser::parseOrderKey() {
+    if (peek().type != Token::Type::WORD)
+        throw invalid_argument("Query: expected field name in ORDER BY near '" + peek().text + "'");
+    QueryOrder key;
+    key.field = next().text;
+    if (acceptKeyword("desc")) key.descending = true;
+    else acceptKeyword("asc");
+    return key;
+}
+
+QueryValue QueryParser::parseValue() {
+    const Token& t = peek();
+    if (t.type == Token::Type::STRING) {
+        return makeValue(next().text, true);
+    }
+    if (t.type == Token::Type::WORD) {
+        return makeValue(next().text, false);
+    }
+    throw invalid_argument("Query: expected value near '" + t.text + "'");
+}
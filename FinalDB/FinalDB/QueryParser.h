@@ -0,0 +1,87 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Литерал в условии запроса
+struct QueryValue {
+    std::string text;
+    double number;
+    bool isNumber;
+};
+
+// Узел дерева условия WHERE
+struct QueryExpr {
+    enum class Kind { AND, OR, NOT, COMPARE, IN, BETWEEN, CONTAINS, STARTS };
+    enum class Op { EQ, NE, LT, LE, GT, GE };
+
+    Kind kind = Kind::COMPARE;
+    Op op = Op::EQ;
+    std::string field;                 // для предикатов
+    std::vector<QueryValue> values;    // операнды предиката
+    std::vector<QueryExpr> children;   // для AND / OR / NOT
+
+    std::string toString() const;
+};
+
+// Ключ сортировки ORDER BY
+struct QueryOrder {
+    std::string field;
+    bool descending = false;
+};
+
+// Разобранный запрос:
+//   [EXPLAIN] <cities|drivers|fines|violations> [WHERE <условие>]
+//   [ORDER BY field [ASC|DESC] {, field [ASC|DESC]}] [LIMIT n]
+struct Query {
+    bool explain = false;
+    std::string target;
+    bool hasWhere = false;
+    QueryExpr where;
+    std::vector<QueryOrder> orderBy;
+    bool hasLimit = false;
+    size_t limit = 0;
+};
+
+// Рекурсивный разбор языка запросов.
+// Грамматика условия:
+//   expr      := term { OR term }
+//   term      := factor { AND factor }
+//   factor    := NOT factor | '(' expr ')' | predicate
+//   predicate := field (=|!=|<>|<|<=|>|>=) value
+//              | field [NOT] IN '(' value {, value} ')'
+//              | field BETWEEN value AND value
+//              | field CONTAINS value
+//              | field STARTS [WITH] value
+// Ошибки синтаксиса бросают std::invalid_argument.
+class QueryParser {
+public:
+    static Query parse(const std::string& text);
+
+private:
+    struct Token {
+        enum class Type { WORD, STRING, SYMBOL, END };
+        Type type;
+        std::string text;
+    };
+
+    std::vector<Token> tokens;
+    size_t pos;
+
+    explicit QueryParser(const std::string& text);
+
+    void tokenize(const std::string& text);
+    const Token& peek() const;
+    Token next();
+    bool acceptKeyword(const char* keyword);
+    bool acceptSymbol(const char* symbol);
+    void expectSymbol(const char* symbol);
+    bool peekKeyword(const char* keyword) const;
+
+    Query parseQuery();
+    QueryExpr parseOr();
+    QueryExpr parseAnd();
+    QueryExpr parseFactor();
+    QueryExpr parsePredicate();
+    QueryValue parseValue();
+    QueryOrder parseOrderKey();
+};
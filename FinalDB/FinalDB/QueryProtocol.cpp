@@ -0,0 +1,320 @@
+#include "QueryProtocol.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace QueryProtocol {
+
+Writer::Writer(uint8_t code) {
+    buffer.assign(4, '\0');
+    buffer.push_back(static_cast<char>(code));
+}
+
+Writer& Writer::u8(uint8_t value) {
+    buffer.push_back(static_cast<char>(value));
+    return *this;
+}
+
+Writer& Writer::u32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) buffer.push_back(static_cast<char>(value >> (8 * i)));
+    return *this;
+}
+
+Writer& Writer::u64(uint64_t value) {
+    for (int i = 0; i < 8; ++i) buffer.push_back(static_cast<char>(value >> (8 * i)));
+    return *this;
+}
+
+Writer& Writer::f64(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return u64(bits);
+}
+
+Writer& Writer::str(string_view value) {
+    u32(static_cast<uint32_t>(value.size()));
+    buffer.append(value.data(), value.size());
+    return *this;
+}
+
+const string& Writer::finish() {
+    uint32_t size = static_cast<uint32_t>(buffer.size() - 4);
+    for (int i = 0; i < 4; ++i) buffer[i] = static_cast<char>(size >> (8 * i));
+    return buffer;
+}
+
+const char* Reader::take(size_t size) {
+    if (static_cast<size_t>(end - pos) < size) throw invalid_argument("Truncated frame");
+    const char* data = pos;
+    pos += size;
+    return data;
+}
+
+uint8_t Reader::u8() {
+    return static_cast<uint8_t>(*take(1));
+}
+
+uint32_t Reader::u32() {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(take(4));
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t Reader::u64() {
+    uint64_t low = u32();
+    return low | (static_cast<uint64_t>(u32()) << 32);
+}
+
+double Reader::f64() {
+    uint64_t bits = u64();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+string_view Reader::str() {
+    uint32_t size = u32();
+    return string_view(take(size), size);
+}
+
+size_t frameLength(const char* data, size_t size) {
+    if (size < 4) return 0;
+    uint32_t body = Reader(data, 4).u32();
+    if (body > MAX_FRAME) throw invalid_argument("Frame too large");
+    return size >= 4 + static_cast<size_t>(body) ? 4 + body : 0;
+}
+
+// ======= Сокеты =======
+
+bool initSockets() {
+#ifdef _WIN32
+    static bool ready = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return ready;
+#else
+    return true;
+#endif
+}
+
+void closeSocket(Socket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool setNonBlocking(Socket socket) {
+#ifdef _WIN32
+    u_long on = 1;
+    return ioctlsocket(socket, FIONBIO, &on) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+namespace {
+
+const char UNIX_PREFIX[] = "unix:";
+
+// Запись в закрытый сокет не должна завершать процесс сигналом SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+long ioResult(long n) {
+    if (n >= 0) return n;
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK ? WOULD_BLOCK : IO_ERROR;
+#else
+    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) return WOULD_BLOCK;
+    return IO_ERROR;
+#endif
+}
+
+bool isUnixAddress(const string& address) {
+    return address.compare(0, sizeof(UNIX_PREFIX) - 1, UNIX_PREFIX) == 0;
+}
+
+// "host:port" или "port" (localhost)
+addrinfo* resolve(const string& address, bool passive) {
+    size_t colon = address.rfind(':');
+    string host = colon == string::npos ? "127.0.0.1" : address.substr(0, colon);
+    string port = colon == string::npos ? address : address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (passive) hints.ai_flags = AI_PASSIVE;
+    addrinfo* list = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &list) != 0) {
+        cerr << "Cannot resolve address: " << address << "\n";
+        return nullptr;
+    }
+    return list;
+}
+
+// Ответ на каждый кадр нужен сразу: без задержки Нейгла
+void setNoDelay(Socket socket) {
+    int on = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+}
+
+#ifndef _WIN32
+Socket unixSocket(const string& address, sockaddr_un& addr) {
+    string path = address.substr(sizeof(UNIX_PREFIX) - 1);
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        cerr << "Invalid socket path: " << address << "\n";
+        return BAD_SOCKET;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return ::socket(AF_UNIX, SOCK_STREAM, 0);
+}
+#endif
+
+} // namespace
+
+Socket listenOn(const string& address) {
+    if (!initSockets()) return BAD_SOCKET;
+    if (isUnixAddress(address)) {
+#ifdef _WIN32
+        cerr << "Unix sockets are not supported: " << address << "\n";
+        return BAD_SOCKET;
+#else
+        sockaddr_un addr;
+        Socket s = unixSocket(address, addr);
+        if (s == BAD_SOCKET) return BAD_SOCKET;
+        unlink(addr.sun_path);   // файл от прошлого запуска
+        if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, SOMAXCONN) != 0) {
+            cerr << "Cannot listen on " << address << "\n";
+            closeSocket(s);
+            return BAD_SOCKET;
+        }
+        return s;
+#endif
+    }
+    addrinfo* list = resolve(address, true);
+    if (!list) return BAD_SOCKET;
+    Socket s = ::socket(list->ai_family, list->ai_socktype, list->ai_protocol);
+    int on = 1;
+    if (s != BAD_SOCKET)
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+    bool ok = s != BAD_SOCKET
+        && ::bind(s, list->ai_addr, static_cast<int>(list->ai_addrlen)) == 0
+        && ::listen(s, SOMAXCONN) == 0;
+    freeaddrinfo(list);
+    if (!ok) {
+        cerr << "Cannot listen on " << address << "\n";
+        if (s != BAD_SOCKET) closeSocket(s);
+        return BAD_SOCKET;
+    }
+    return s;
+}
+
+Socket connectTo(const string& address) {
+    if (!initSockets()) return BAD_SOCKET;
+    if (isUnixAddress(address)) {
+#ifdef _WIN32
+        cerr << "Unix sockets are not supported: " << address << "\n";
+        return BAD_SOCKET;
+#else
+        sockaddr_un addr;
+        Socket s = unixSocket(address, addr);
+        if (s == BAD_SOCKET) return BAD_SOCKET;
+        if (::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            cerr << "Cannot connect to " << address << "\n";
+            closeSocket(s);
+            return BAD_SOCKET;
+        }
+        return s;
+#endif
+    }
+    addrinfo* list = resolve(address, false);
+    if (!list) return BAD_SOCKET;
+    Socket s = ::socket(list->ai_family, list->ai_socktype, list->ai_protocol);
+    bool ok = s != BAD_SOCKET && ::connect(s, list->ai_addr, static_cast<int>(list->ai_addrlen)) == 0;
+    freeaddrinfo(list);
+    if (!ok) {
+        cerr << "Cannot connect to " << address << "\n";
+        if (s != BAD_SOCKET) closeSocket(s);
+        return BAD_SOCKET;
+    }
+    setNoDelay(s);
+    return s;
+}
+
+Socket acceptClient(Socket listener) {
+    Socket s = ::accept(listener, nullptr, nullptr);
+    if (s == BAD_SOCKET) return BAD_SOCKET;
+    setNonBlocking(s);
+    setNoDelay(s);   // для Unix-сокета просто не действует
+    return s;
+}
+
+long sendSome(Socket socket, const char* data, size_t size) {
+    return ioResult(::send(socket, data, static_cast<int>(size), SEND_FLAGS));
+}
+
+long recvSome(Socket socket, char* data, size_t size) {
+    return ioResult(::recv(socket, data, static_cast<int>(size), 0));
+}
+
+// ======= Клиент =======
+
+QueryClient::QueryClient(const string& address)
+    : socket(connectTo(address)) {
+}
+
+QueryClient::~QueryClient() {
+    if (socket != BAD_SOCKET) closeSocket(socket);
+}
+
+bool QueryClient::send(const string& frame) {
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        int n = ::send(socket, frame.data() + sent, static_cast<int>(frame.size() - sent), SEND_FLAGS);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool QueryClient::receive(string& body) {
+    auto readExact = [this](char* data, size_t size) {
+        size_t got = 0;
+        while (got < size) {
+            int n = ::recv(socket, data + got, static_cast<int>(size - got), 0);
+            if (n <= 0) return false;
+            got += static_cast<size_t>(n);
+        }
+        return true;
+    };
+    char header[4];
+    if (!readExact(header, 4)) return false;
+    uint32_t size = Reader(header, 4).u32();
+    if (size > MAX_FRAME) return false;
+    body.resize(size);
+    return readExact(&body[0], size);
+}
+
+} // namespace QueryProtocol
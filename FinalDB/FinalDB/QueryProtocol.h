@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Двоичный протокол сервера запросов (QueryServer).
+// Кадр: uint32 длина тела, затем тело. Тело запроса — код операции
+// и аргументы, тело ответа — Status и данные (FAILED — текст ошибки).
+// Числа little-endian, double — 8 байт IEEE, строка — uint32 длина и байты.
+//
+//   PING                                 → —
+//   QUERY         str текст запроса      → u32 прочитано строк, u32 колонок,
+//                                          имена, u32 строк, значения
+//   GET_VIOLATION i32 recordId           → i32 recordId, driverId, cityId, fineId,
+//                                          u8 paid, str дата, водитель, город,
+//                                          тип штрафа, f64 сумма
+//   ADD_VIOLATION i32 driverId, fineId,
+//                 str дата               → i32 recordId
+//   MARK_PAID     i32 recordId           → —
+//   STATS                                → u32 городов, водителей, штрафов,
+//                                          нарушений, i32 max recordId,
+//                                          u32 должников, u64 запросов сервера
+//   DEBT          i32 driverId           → u32 неоплаченных, i64 копеек
+namespace QueryProtocol {
+
+enum class Op : uint8_t { PING = 1, QUERY, GET_VIOLATION, ADD_VIOLATION, MARK_PAID, STATS, DEBT };
+enum class Status : uint8_t { OK = 0, FAILED = 1 };
+
+const uint32_t MAX_FRAME = 16u << 20;   // больший кадр — ошибка протокола
+
+// Сборка кадра: длина проставляется в finish()
+class Writer {
+public:
+    explicit Writer(uint8_t code);
+    explicit Writer(Op op) : Writer(static_cast<uint8_t>(op)) {}
+    explicit Writer(Status status) : Writer(static_cast<uint8_t>(status)) {}
+
+    Writer& u8(uint8_t value);
+    Writer& u32(uint32_t value);
+    Writer& i32(int32_t value) { return u32(static_cast<uint32_t>(value)); }
+    Writer& u64(uint64_t value);
+    Writer& i64(int64_t value) { return u64(static_cast<uint64_t>(value)); }
+    Writer& f64(double value);
+    Writer& str(std::string_view value);
+
+    const std::string& finish();
+
+private:
+    std::string buffer;
+};
+
+// Разбор тела кадра; выход за границу → invalid_argument
+class Reader {
+public:
+    Reader(const char* data, size_t size) : pos(data), end(data + size) {}
+
+    uint8_t u8();
+    uint32_t u32();
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    uint64_t u64();
+    int64_t i64() { return static_cast<int64_t>(u64()); }
+    double f64();
+    std::string_view str();
+    bool atEnd() const { return pos == end; }
+
+private:
+    const char* take(size_t size);
+    const char* pos;
+    const char* end;
+};
+
+// Полная длина первого кадра в буфере (с заголовком); 0 — кадр ещё не
+// пришёл целиком. Длина больше MAX_FRAME → invalid_argument.
+size_t frameLength(const char* data, size_t size);
+
+// Сокеты: "host:port" (TCP) или "unix:/path" (Unix domain socket, кроме Windows)
+#ifdef _WIN32
+using Socket = std::uintptr_t;
+const Socket BAD_SOCKET = ~static_cast<Socket>(0);
+#else
+using Socket = int;
+const Socket BAD_SOCKET = -1;
+#endif
+
+bool initSockets();                      // WSAStartup в Windows; один раз
+void closeSocket(Socket socket);
+bool setNonBlocking(Socket socket);
+// BAD_SOCKET — ошибка, сообщение в cerr
+Socket listenOn(const std::string& address);
+Socket connectTo(const std::string& address);
+Socket acceptClient(Socket listener);    // BAD_SOCKET — очередь пуста
+
+// Для неблокирующих сокетов: > 0 — передано байт, 0 — соединение закрыто
+// (recv), WOULD_BLOCK — подождать готовности, IO_ERROR — ошибка
+const long WOULD_BLOCK = -1;
+const long IO_ERROR = -2;
+long sendSome(Socket socket, const char* data, size_t size);
+long recvSome(Socket socket, char* data, size_t size);
+
+// Блокирующий клиент: кадры можно слать подряд (конвейер) и читать
+// ответы в том же порядке
+class QueryClient {
+public:
+    explicit QueryClient(const std::string& address);
+    ~QueryClient();
+
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    bool isConnected() const { return socket != BAD_SOCKET; }
+    bool send(const std::string& frame);
+    // Тело следующего ответа; false — соединение закрыто
+    bool receive(std::string& body);
+    bool call(const std::string& frame, std::string& body) { return send(frame) && receive(body); }
+
+private:
+    Socket socket;
+};
+
+} // namespace QueryProtocol
@@ -0,0 +1,415 @@
+#include "QueryServer.h"
+#include "Metrics.h"
+#include "Validation.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+using namespace std;
+using namespace QueryProtocol;
+
+namespace {
+
+const uint64_t LISTENER = 0;
+const uint64_t WAKE = 1;
+const size_t READ_CHUNK = 64 * 1024;
+// Пока клиент не забрал столько ответов, новые кадры не выполняются
+const size_t MAX_PENDING_OUTPUT = 4u << 20;
+
+struct PollEvent {
+    uint64_t token;
+    bool readable;
+    bool writable;
+};
+
+// UDP-сокет, подключённый сам к себе: send() будит цикл событий из
+// других потоков и из обработчика сигнала
+Socket makeWakeSocket() {
+    Socket s = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == BAD_SOCKET) return BAD_SOCKET;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size = sizeof(addr);
+    if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || getsockname(s, reinterpret_cast<sockaddr*>(&addr), &size) != 0
+        || ::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || !setNonBlocking(s)) {
+        closeSocket(s);
+        return BAD_SOCKET;
+    }
+    return s;
+}
+
+} // namespace
+
+// Ожидание готовности сокетов: epoll в Linux, WSAPoll в Windows.
+// Чтение отслеживается всегда, запись — пока есть неотправленное.
+class QueryServer::Poller {
+public:
+#ifdef _WIN32
+    bool ok() const { return true; }
+
+    void add(Socket s, uint64_t token) {
+        WSAPOLLFD fd{};
+        fd.fd = s;
+        fd.events = POLLRDNORM;
+        fds.push_back(fd);
+        tokens.push_back(token);
+    }
+
+    void watchWrite(Socket s, uint64_t, bool on) {
+        for (WSAPOLLFD& fd : fds)
+            if (fd.fd == s) fd.events = static_cast<short>(on ? POLLRDNORM | POLLWRNORM : POLLRDNORM);
+    }
+
+    void remove(Socket s) {
+        for (size_t i = 0; i < fds.size(); ++i) {
+            if (fds[i].fd != s) continue;
+            fds[i] = fds.back();
+            fds.pop_back();
+            tokens[i] = tokens.back();
+            tokens.pop_back();
+            return;
+        }
+    }
+
+    void wait(vector<PollEvent>& events) {
+        events.clear();
+        if (WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), -1) <= 0) return;
+        for (size_t i = 0; i < fds.size(); ++i) {
+            short r = fds[i].revents;
+            if (!r) continue;
+            // Ошибка и обрыв — как чтение: recv вернёт 0 или ошибку
+            events.push_back({ tokens[i], (r & (POLLRDNORM | POLLERR | POLLHUP)) != 0, (r & POLLWRNORM) != 0 });
+        }
+    }
+
+private:
+    vector<WSAPOLLFD> fds;
+    vector<uint64_t> tokens;
+#else
+    Poller() : epollFd(epoll_create1(0)) {}
+    ~Poller() {
+        if (epollFd != -1) ::close(epollFd);
+    }
+
+    bool ok() const { return epollFd != -1; }
+
+    void add(Socket s, uint64_t token) {
+        control(EPOLL_CTL_ADD, s, token, EPOLLIN);
+    }
+
+    void watchWrite(Socket s, uint64_t token, bool on) {
+        control(EPOLL_CTL_MOD, s, token, on ? EPOLLIN | EPOLLOUT : EPOLLIN);
+    }
+
+    void remove(Socket s) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, s, nullptr);
+    }
+
+    void wait(vector<PollEvent>& events) {
+        epoll_event ready[256];
+        events.clear();
+        int n = epoll_wait(epollFd, ready, 256, -1);
+        for (int i = 0; i < n; ++i) {
+            uint32_t e = ready[i].events;
+            events.push_back({ ready[i].data.u64, (e & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0, (e & EPOLLOUT) != 0 });
+        }
+    }
+
+private:
+    void control(int op, Socket s, uint64_t token, uint32_t mask) {
+        epoll_event event{};
+        event.events = mask;
+        event.data.u64 = token;
+        epoll_ctl(epollFd, op, s, &event);
+    }
+
+    int epollFd;
+#endif
+};
+
+QueryServer::QueryServer(DatabaseManager& db, unsigned threads)
+    : db(db), poller(new Poller()), workers(threads) {
+}
+
+QueryServer::~QueryServer() {
+    workers.wait();   // задачи пишут в completions и будят цикл
+    for (auto& c : connections) closeSocket(c.second.socket);
+    if (listener != BAD_SOCKET) closeSocket(listener);
+    if (wakeSocket != BAD_SOCKET) closeSocket(wakeSocket);
+#ifndef _WIN32
+    if (!unixPath.empty()) unlink(unixPath.c_str());
+#endif
+}
+
+bool QueryServer::listen(const string& address) {
+    if (!poller->ok()) {
+        cerr << "Cannot create event loop\n";
+        return false;
+    }
+    listener = listenOn(address);
+    if (listener == BAD_SOCKET) return false;
+    wakeSocket = makeWakeSocket();
+    if (wakeSocket == BAD_SOCKET) {
+        cerr << "Cannot create wake socket\n";
+        return false;
+    }
+    setNonBlocking(listener);
+    if (address.compare(0, 5, "unix:") == 0) unixPath = address.substr(5);
+    poller->add(listener, LISTENER);
+    poller->add(wakeSocket, WAKE);
+    running = true;
+    return true;
+}
+
+void QueryServer::stop() {
+    running = false;
+    wake();
+}
+
+void QueryServer::wake() {
+    char byte = 0;
+    sendSome(wakeSocket, &byte, 1);
+}
+
+QueryServer::Stats QueryServer::getStats() const {
+    Stats stats;
+    stats.connections = acceptedCount.load();
+    stats.requests = requestCount.load();
+    stats.failed = failedCount.load();
+    return stats;
+}
+
+void QueryServer::run() {
+    vector<PollEvent> events;
+    while (running) {
+        poller->wait(events);
+        for (const PollEvent& e : events) {
+            if (e.token == LISTENER) {
+                accept();
+            }
+            else if (e.token == WAKE) {
+                char drain[64];
+                while (recvSome(wakeSocket, drain, sizeof(drain)) > 0) {}
+                finishBatches();
+            }
+            else {
+                // Соединение могло закрыться раньше в этой же пачке событий
+                if (e.writable && !writeTo(e.token)) continue;
+                if (e.readable) readFrom(e.token);
+            }
+        }
+    }
+}
+
+void QueryServer::accept() {
+    while (true) {
+        Socket s = acceptClient(listener);
+        if (s == BAD_SOCKET) return;
+        uint64_t id = nextConnection++;
+        Connection& c = connections[id];
+        c.socket = s;
+        poller->add(s, id);
+        acceptedCount.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void QueryServer::readFrom(uint64_t id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) return;
+    Connection& c = it->second;
+    char buffer[READ_CHUNK];
+    while (true) {
+        long n = recvSome(c.socket, buffer, sizeof(buffer));
+        if (n == WOULD_BLOCK) break;
+        if (n <= 0) {            // клиент закрыл соединение или ошибка
+            close(id);
+            return;
+        }
+        c.input.append(buffer, static_cast<size_t>(n));
+    }
+    dispatch(id);
+}
+
+// Все полные кадры соединения — одной задачей в пул
+void QueryServer::dispatch(uint64_t id) {
+    Connection& c = connections.at(id);
+    if (c.busy || c.output.size() - c.sent > MAX_PENDING_OUTPUT) return;
+    size_t end = 0;
+    try {
+        while (size_t frame = frameLength(c.input.data() + end, c.input.size() - end)) end += frame;
+    }
+    catch (const exception& e) {
+        cerr << "Connection " << id << " closed: " << e.what() << "\n";
+        close(id);
+        return;
+    }
+    if (end == 0) return;
+    string frames = c.input.substr(0, end);
+    c.input.erase(0, end);
+    c.busy = true;
+    workers.submit([this, id, frames = move(frames)] {
+        string responses;
+        for (size_t pos = 0; pos < frames.size(); ) {
+            size_t size = frameLength(frames.data() + pos, frames.size() - pos) - 4;
+            responses += handle(frames.data() + pos + 4, size);
+            pos += 4 + size;
+        }
+        {
+            lock_guard<std::mutex> lock(completionsMutex);
+            completions.push_back({ id, move(responses) });
+        }
+        wake();
+    });
+}
+
+void QueryServer::finishBatches() {
+    vector<Completion> done;
+    {
+        lock_guard<std::mutex> lock(completionsMutex);
+        done.swap(completions);
+    }
+    for (Completion& d : done) {
+        auto it = connections.find(d.connection);
+        if (it == connections.end()) continue;   // клиент ушёл, не дождавшись
+        Connection& c = it->second;
+        c.busy = false;
+        c.output += d.responses;
+        if (writeTo(d.connection)) dispatch(d.connection);
+    }
+}
+
+bool QueryServer::writeTo(uint64_t id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) return false;
+    Connection& c = it->second;
+    while (c.sent < c.output.size()) {
+        long n = sendSome(c.socket, c.output.data() + c.sent, c.output.size() - c.sent);
+        if (n == WOULD_BLOCK) break;
+        if (n <= 0) {
+            close(id);
+            return false;
+        }
+        c.sent += static_cast<size_t>(n);
+    }
+    bool pending = c.sent < c.output.size();
+    if (!pending) {
+        c.output.clear();
+        c.sent = 0;
+    }
+    if (pending != c.writeWatched) {
+        poller->watchWrite(c.socket, id, pending);
+        c.writeWatched = pending;
+    }
+    // Ответы забраны — можно выполнять кадры, отложенные из-за очереди
+    if (!pending && !c.busy && !c.input.empty()) dispatch(id);
+    return connections.count(id) != 0;
+}
+
+void QueryServer::close(uint64_t id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) return;
+    poller->remove(it->second.socket);
+    closeSocket(it->second.socket);
+    connections.erase(it);
+}
+
+// ======= Выполнение запросов =======
+
+namespace {
+
+void writeViolation(Writer& out, const FineRegistry::ViolationInfo& v) {
+    out.i32(v.recordId).i32(v.driverId).i32(v.cityId).i32(v.fineId).u8(v.paid ? 1 : 0)
+        .str(v.date).str(v.driverName).str(v.cityName).str(v.fineType).f64(v.fineAmount);
+}
+
+} // namespace
+
+string QueryServer::handle(const char* body, size_t size) {
+    FINALDB_METRIC_SCOPE("server.request");
+    requestCount.fetch_add(1, memory_order_relaxed);
+    try {
+        Reader in(body, size);
+        Op op = static_cast<Op>(in.u8());
+        Writer out(Status::OK);
+        switch (op) {
+        case Op::PING:
+            break;
+        case Op::QUERY: {
+            string text(in.str());
+            auto lock = db.lockTables();
+            QueryResult result = db.runQuery(text);
+            out.u32(static_cast<uint32_t>(result.rowsExamined));
+            out.u32(static_cast<uint32_t>(result.columns.size()));
+            for (const string& column : result.columns) out.str(column);
+            out.u32(static_cast<uint32_t>(result.rows.size()));
+            for (const auto& row : result.rows)
+                for (const string& value : row) out.str(value);
+            break;
+        }
+        case Op::GET_VIOLATION: {
+            int recordId = in.i32();
+            auto lock = db.lockTables();
+            FineRegistry::ViolationInfo v = db.getRegistry().getViolationById(recordId,
+                db.getDrivers(), db.getCities(), db.getFines());
+            if (v.recordId != recordId || recordId <= 0) throw invalid_argument("Violation not found");
+            writeViolation(out, v);
+            break;
+        }
+        case Op::ADD_VIOLATION: {
+            int driverId = in.i32();
+            int fineId = in.i32();
+            string_view date = in.str();
+            if (!Validation::isDate(date)) throw invalid_argument("Invalid date format");
+            auto lock = db.lockTables();
+            DriverTable::DriverInfo driver;
+            if (!db.getDrivers().getDriverById(driverId, driver)) throw invalid_argument("Driver not found");
+            if (db.getFines().getFineTypeById(fineId).empty()) throw invalid_argument("Fine not found");
+            out.i32(db.getRegistry().addViolation(driverId, driver.cityId, fineId, date));
+            db.commit();
+            break;
+        }
+        case Op::MARK_PAID: {
+            int recordId = in.i32();
+            auto lock = db.lockTables();
+            FineRegistry::ViolationInfo v;
+            if (!db.getRegistry().findViolation(recordId, v)) throw invalid_argument("Violation not found");
+            db.markFineAsPaid(recordId);
+            break;
+        }
+        case Op::STATS: {
+            auto lock = db.lockTables();
+            out.u32(db.getCities().getCityCount());
+            out.u32(db.getDrivers().getDriverCount());
+            out.u32(db.getFines().getFineCount());
+            out.u32(db.getRegistry().getRecordCount());
+            out.i32(db.getRegistry().getMaxRecordId());
+            out.u32(static_cast<uint32_t>(db.getRegistry().getDebts().debtorCount()));
+            out.u64(requestCount.load(memory_order_relaxed));
+            break;
+        }
+        case Op::DEBT: {
+            DebtLedger::Debt debt = db.driverDebt(in.i32());
+            out.u32(debt.unpaid).i64(debt.cents);
+            break;
+        }
+        default:
+            throw invalid_argument("Unknown operation");
+        }
+        return out.finish();
+    }
+    catch (const exception& e) {
+        failedCount.fetch_add(1, memory_order_relaxed);
+        return Writer(Status::FAILED).str(e.what()).finish();
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "DatabaseManager.h"
+#include "QueryProtocol.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Сервер запросов: база загружается один раз, клиенты работают с ней
+// по протоколу QueryProtocol.h через TCP или Unix-сокет.
+// Один поток ведёт цикл событий (epoll в Linux, WSAPoll в Windows):
+// принимает соединения и читает/пишет сокеты без блокировки. Пришедшие
+// целиком кадры соединения уходят одной задачей в пул потоков; следующая
+// пачка — после ответа на предыдущую, поэтому ответы идут в порядке
+// запросов. Таблицы читаются и меняются под lockTables(), изменения
+// фиксируются commit(), как в интерфейсе.
+class QueryServer {
+public:
+    struct Stats {
+        uint64_t connections = 0;    // принято за всё время
+        uint64_t requests = 0;
+        uint64_t failed = 0;         // ответов FAILED
+    };
+
+    explicit QueryServer(DatabaseManager& db, unsigned threads = 0);   // 0 — по числу ядер
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // "host:port" или "unix:/path"; false — ошибка в cerr
+    bool listen(const std::string& address);
+    // Цикл событий до stop()
+    void run();
+    // Из любого потока и из обработчика сигнала
+    void stop();
+
+    Stats getStats() const;
+
+    // Тело кадра запроса → кадр ответа; ошибки — ответ FAILED
+    std::string handle(const char* body, size_t size);
+
+private:
+    struct Connection {
+        QueryProtocol::Socket socket;
+        std::string input;           // принятые байты, в т.ч. неполный кадр
+        std::string output;          // ещё не отправленные ответы
+        size_t sent = 0;             // отправлено из output
+        bool busy = false;           // пачка кадров в пуле
+        bool writeWatched = false;
+    };
+    struct Completion {
+        uint64_t connection;
+        std::string responses;
+    };
+    class Poller;
+
+    void accept();
+    void readFrom(uint64_t id);
+    void dispatch(uint64_t id);
+    bool writeTo(uint64_t id);       // false — соединение закрыто
+    void finishBatches();
+    void close(uint64_t id);
+    void wake();
+
+    DatabaseManager& db;
+    std::unique_ptr<Poller> poller;
+    QueryProtocol::Socket listener = QueryProtocol::BAD_SOCKET;
+    QueryProtocol::Socket wakeSocket = QueryProtocol::BAD_SOCKET;   // UDP сам себе
+    std::string unixPath;            // файл Unix-сокета удаляется при остановке
+    std::unordered_map<uint64_t, Connection> connections;
+    uint64_t nextConnection = 2;     // 0 — listener, 1 — wakeSocket
+    std::atomic<bool> running{ false };
+
+    std::mutex completionsMutex;
+    std::vector<Completion> completions;
+
+    std::atomic<uint64_t> acceptedCount{ 0 };
+    std::atomic<uint64_t> requestCount{ 0 };
+    std::atomic<uint64_t> failedCount{ 0 };
+
+    ThreadPool workers;              // последним: задачи пула используют поля выше
+};
@@ -0,0 +1,178 @@
+#include "ReferentialIntegrity.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+ReferentialIntegrity::ReferentialIntegrity(CityTable& cities, DriverTable& drivers,
+    FineTable& fines, FineRegistry& registry)
+    : cities(cities), drivers(drivers), fines(fines), registry(registry)
+{
+    for (OnDelete& p : policies) p = OnDelete::SET_NULL;
+    loadPolicies();
+}
+
+bool ReferentialIntegrity::loadPolicies() {
+    return loadPolicies("integrity.txt");
+}
+
+// Файла может не быть — тогда везде SET_NULL (прежнее поведение)
+bool ReferentialIntegrity::loadPolicies(const std::string& filename) {
+    ifstream file(filename);
+    if (!file.is_open()) return false;
+    string line;
+    while (getline(file, line)) {
+        istringstream iss(line);
+        string relation, policy;
+        if (!(iss >> relation >> policy)) continue;
+        for (int i = 0; i < RELATION_COUNT; ++i) {
+            OnDelete parsed;
+            if (relationToString(static_cast<Relation>(i)) == relation && parsePolicy(policy, parsed))
+                policies[i] = parsed;
+        }
+    }
+    return true;
+}
+
+void ReferentialIntegrity::savePolicies() const {
+    ofstream file("integrity.txt");
+    if (!file.is_open()) {
+        cerr << "Error saving integrity settings\n";
+        return;
+    }
+    for (int i = 0; i < RELATION_COUNT; ++i)
+        file << relationToString(static_cast<Relation>(i)) << ' ' << policyToString(policies[i]) << '\n';
+}
+
+ReferentialIntegrity::OnDelete ReferentialIntegrity::getPolicy(Relation relation) const {
+    return policies[static_cast<int>(relation)];
+}
+
+void ReferentialIntegrity::setPolicy(Relation relation, OnDelete policy) {
+    policies[static_cast<int>(relation)] = policy;
+}
+
+std::string ReferentialIntegrity::relationToString(Relation relation) {
+    switch (relation) {
+    case Relation::CITY_DRIVER:      return "city.driver";
+    case Relation::CITY_VIOLATION:   return "city.violation";
+    case Relation::DRIVER_VIOLATION: return "driver.violation";
+    default:                         return "fine.violation";
+    }
+}
+
+std::string ReferentialIntegrity::policyToString(OnDelete policy) {
+    switch (policy) {
+    case OnDelete::CASCADE:  return "cascade";
+    case OnDelete::RESTRICT: return "restrict";
+    default:                 return "set-null";
+    }
+}
+
+bool ReferentialIntegrity::parsePolicy(const std::string& text, OnDelete& out) {
+    if (text == "set-null") out = OnDelete::SET_NULL;
+    else if (text == "cascade") out = OnDelete::CASCADE;
+    else if (text == "restrict") out = OnDelete::RESTRICT;
+    else return false;
+    return true;
+}
+
+// RESTRICT для нарушений водителя (проверка перед каскадом)
+void ReferentialIntegrity::checkDriver(int driverId) const {
+    registry.thawReferences(ColdBlock::Column::DRIVER, driverId);   // индекс — по всем записям
+    size_t refs = registry.getDriverIndex().count(driverId);
+    if (refs > 0 && getPolicy(Relation::DRIVER_VIOLATION) == OnDelete::RESTRICT)
+        throw invalid_argument("Driver is referenced by " + to_string(refs)
+            + " violation(s) (driver.violation is restrict)");
+}
+
+// Политика relation для нарушений с данным ключом индекса
+void ReferentialIntegrity::applyToViolations(Relation relation, const IntMultiIndex& index,
+    int key, DeleteReport& report)
+{
+    const vector<int>* ids = index.find(key);
+    if (!ids || ids->empty()) return;
+    int n = static_cast<int>(ids->size());
+
+    if (getPolicy(relation) == OnDelete::CASCADE) {
+        vector<int> dependents(*ids);   // индекс меняется при удалении
+        for (int recordId : dependents) registry.deleteViolation(recordId);
+        report.violationsDeleted += n;
+        return;
+    }
+    // SET_NULL (RESTRICT сюда не доходит — проверен заранее)
+    switch (relation) {
+    case Relation::CITY_VIOLATION:   registry.updateCityReferences(key);   break;
+    case Relation::DRIVER_VIOLATION: registry.updateDriverReferences(key); break;
+    case Relation::FINE_VIOLATION:   registry.updateFineReferences(key);   break;
+    default: return;
+    }
+    report.violationsNulled += n;
+}
+
+void ReferentialIntegrity::removeDriver(int driverId, DeleteReport& report) {
+    applyToViolations(Relation::DRIVER_VIOLATION, registry.getDriverIndex(), driverId, report);
+    drivers.deleteDriverById(driverId);
+}
+
+ReferentialIntegrity::DeleteReport ReferentialIntegrity::deleteCity(int cityId) {
+    DeleteReport report;
+    if (!cities.cityExists(cityId)) return report;
+
+    const vector<int>* cityDrivers = drivers.getCityIndex().find(cityId);
+    size_t driverRefs = cityDrivers ? cityDrivers->size() : 0;
+    registry.thawReferences(ColdBlock::Column::CITY, cityId);
+    size_t violationRefs = registry.getCityIndex().count(cityId);
+
+    if (driverRefs > 0 && getPolicy(Relation::CITY_DRIVER) == OnDelete::RESTRICT)
+        throw invalid_argument("City is referenced by " + to_string(driverRefs)
+            + " driver(s) (city.driver is restrict)");
+    if (violationRefs > 0 && getPolicy(Relation::CITY_VIOLATION) == OnDelete::RESTRICT)
+        throw invalid_argument("City is referenced by " + to_string(violationRefs)
+            + " violation(s) (city.violation is restrict)");
+    // Каскад на водителей не должен упереться в RESTRICT их нарушений
+    if (driverRefs > 0 && getPolicy(Relation::CITY_DRIVER) == OnDelete::CASCADE)
+        for (int driverId : *cityDrivers) checkDriver(driverId);
+
+    applyToViolations(Relation::CITY_VIOLATION, registry.getCityIndex(), cityId, report);
+
+    if (driverRefs > 0) {
+        if (getPolicy(Relation::CITY_DRIVER) == OnDelete::CASCADE) {
+            vector<int> dependents(*cityDrivers);
+            for (int driverId : dependents) removeDriver(driverId, report);
+            report.driversDeleted += static_cast<int>(driverRefs);
+        }
+        else {
+            drivers.updateCityReferences(cityId);
+            report.driversNulled += static_cast<int>(driverRefs);
+        }
+    }
+
+    cities.deleteCity(string(cities.getCityNameById(cityId)));
+    return report;
+}
+
+ReferentialIntegrity::DeleteReport ReferentialIntegrity::deleteDriver(int driverId) {
+    DeleteReport report;
+    DriverTable::DriverInfo info;
+    if (!drivers.getDriverById(driverId, info)) return report;
+    checkDriver(driverId);
+    removeDriver(driverId, report);
+    return report;
+}
+
+ReferentialIntegrity::DeleteReport ReferentialIntegrity::deleteFine(int fineId) {
+    DeleteReport report;
+    FineTable::FineInfo info;
+    if (!fines.getFineById(fineId, info)) return report;
+
+    registry.thawReferences(ColdBlock::Column::FINE, fineId);
+    size_t refs = registry.getFineIndex().count(fineId);
+    if (refs > 0 && getPolicy(Relation::FINE_VIOLATION) == OnDelete::RESTRICT)
+        throw invalid_argument("Fine is referenced by " + to_string(refs)
+            + " violation(s) (fine.violation is restrict)");
+
+    applyToViolations(Relation::FINE_VIOLATION, registry.getFineIndex(), fineId, report);
+    fines.deleteFine(string(info.type));
+    return report;
+}
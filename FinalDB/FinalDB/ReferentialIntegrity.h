@@ -0,0 +1,57 @@
+#pragma once
+#include "CityTable.h"
+#include "DriverTable.h"
+#include "FineTable.h"
+#include "FineRegistry.h"
+#include <string>
+
+// Ссылочная целостность: что делать с зависимыми строками при удалении.
+// Зависимые строки находятся через обратные индексы (город → водители,
+// город/водитель/штраф → нарушения), полного прохода по таблицам нет.
+// Политики хранятся в integrity.txt: "<связь> <set-null|cascade|restrict>".
+class ReferentialIntegrity {
+public:
+    enum class Relation { CITY_DRIVER, CITY_VIOLATION, DRIVER_VIOLATION, FINE_VIOLATION };
+    enum class OnDelete { SET_NULL, CASCADE, RESTRICT };
+    static const int RELATION_COUNT = 4;
+
+    // Что затронуло одно удаление
+    struct DeleteReport {
+        int driversDeleted = 0;
+        int driversNulled = 0;
+        int violationsDeleted = 0;
+        int violationsNulled = 0;
+    };
+
+    ReferentialIntegrity(CityTable& cities, DriverTable& drivers,
+        FineTable& fines, FineRegistry& registry);
+
+    bool loadPolicies();
+    bool loadPolicies(const std::string& filename);
+    void savePolicies() const;
+
+    OnDelete getPolicy(Relation relation) const;
+    void setPolicy(Relation relation, OnDelete policy);
+
+    // Удаление с применением политик. RESTRICT проверяется до любых
+    // изменений: при нарушении бросается invalid_argument, данные не меняются.
+    DeleteReport deleteCity(int cityId);
+    DeleteReport deleteDriver(int driverId);
+    DeleteReport deleteFine(int fineId);
+
+    static std::string relationToString(Relation relation);
+    static std::string policyToString(OnDelete policy);
+    static bool parsePolicy(const std::string& text, OnDelete& out);
+
+private:
+    CityTable& cities;
+    DriverTable& drivers;
+    FineTable& fines;
+    FineRegistry& registry;
+    OnDelete policies[RELATION_COUNT];
+
+    void checkDriver(int driverId) const;
+    void removeDriver(int driverId, DeleteReport& report);
+    void applyToViolations(Relation relation, const IntMultiIndex& index, int key,
+        DeleteReport& report);
+};
@@ -0,0 +1,22 @@
+#include "StringHeap.h"
+
+StringHeap::StringHeap() : used(0) {
+    bytes.assign(PADDING, '\0');
+}
+
+void StringHeap::clear() {
+    bytes.assign(PADDING, '\0');
+    used = 0;
+    offsets.clear();
+    ids.clear();
+}
+
+void StringHeap::add(int id, std::string_view text) {
+    bytes.resize(used);
+    offsets.push_back(static_cast<uint32_t>(used));
+    ids.push_back(id);
+    bytes.append(text);
+    bytes.push_back('\0');
+    used = bytes.size();
+    bytes.append(PADDING, '\0');
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Упакованная "куча" строк: все значения подряд в одном буфере,
+// разделены '\0', в конце — нулевой хвост PADDING байт, чтобы
+// векторные ядра могли читать блоками за пределы последней строки.
+class StringHeap {
+public:
+    static const size_t PADDING = 64;
+
+    StringHeap();
+
+    void clear();
+    void add(int id, std::string_view text);
+
+    const char* data() const { return bytes.data(); }
+    size_t size() const { return used; }             // без хвоста
+    size_t count() const { return ids.size(); }
+
+    int idAt(size_t index) const { return ids[index]; }
+    // Начало строки index; для index == count() — конец данных
+    size_t offsetAt(size_t index) const {
+        return index < offsets.size() ? offsets[index] : used;
+    }
+
+private:
+    std::string bytes;
+    size_t used;
+    std::vector<uint32_t> offsets;
+    std::vector<int> ids;
+};
@@ -0,0 +1,84 @@
+#include "StringPool.h"
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+using namespace std;
+
+// Пул не разрушается: view могут жить в статических объектах до самого выхода
+StringPool& StringPool::instance() {
+    static StringPool* pool = new StringPool();
+    return *pool;
+}
+
+StringPool::StringPool() : current(nullptr), blockUsed(0), nextId(1), totalBytes(0) {
+    for (size_t i = 0; i < MAX_SEGMENTS; ++i) segments[i].store(nullptr, memory_order_relaxed);
+}
+
+StringPool::~StringPool() {
+    for (size_t i = 0; i < MAX_SEGMENTS; ++i) delete[] segments[i].load(memory_order_relaxed);
+    for (char* block : blocks) delete[] block;
+}
+
+// Копирует строку в арену; блоки только добавляются, поэтому
+// ранее выданные указатели остаются действительными
+const char* StringPool::store(string_view text) {
+    if (text.size() > BLOCK_SIZE / 4) {
+        char* own = new char[text.size()];
+        memcpy(own, text.data(), text.size());
+        blocks.push_back(own);
+        return own;
+    }
+    if (!current || blockUsed + text.size() > BLOCK_SIZE) {
+        current = new char[BLOCK_SIZE];
+        blocks.push_back(current);
+        blockUsed = 0;
+    }
+    char* dst = current + blockUsed;
+    memcpy(dst, text.data(), text.size());
+    blockUsed += text.size();
+    return dst;
+}
+
+StringPool::Id StringPool::intern(string_view text) {
+    if (text.empty()) return 0;
+    {
+        shared_lock<shared_mutex> lock(mutex);
+        auto it = lookup.find(text);
+        if (it != lookup.end()) return it->second;
+    }
+    unique_lock<shared_mutex> lock(mutex);
+    auto it = lookup.find(text);
+    if (it != lookup.end()) return it->second;
+
+    Id id = nextId;
+    size_t segIndex = id >> SEGMENT_BITS;
+    if (segIndex >= MAX_SEGMENTS) throw length_error("StringPool: too many distinct strings");
+    Entry* seg = segments[segIndex].load(memory_order_relaxed);
+    if (!seg) {
+        seg = new Entry[SEGMENT_SIZE];
+        segments[segIndex].store(seg, memory_order_release);
+    }
+    const char* data = store(text);
+    seg[id & SEGMENT_MASK] = Entry{ data, static_cast<uint32_t>(text.size()) };
+    lookup.emplace(string_view(data, text.size()), id);
+    ++nextId;
+    totalBytes += text.size();
+    return id;
+}
+
+StringPool::Id StringPool::find(string_view text) const {
+    if (text.empty()) return 0;
+    shared_lock<shared_mutex> lock(mutex);
+    auto it = lookup.find(text);
+    return it != lookup.end() ? it->second : 0;
+}
+
+size_t StringPool::count() const {
+    shared_lock<shared_mutex> lock(mutex);
+    return nextId - 1;
+}
+
+size_t StringPool::bytes() const {
+    shared_lock<shared_mutex> lock(mutex);
+    return totalBytes;
+}
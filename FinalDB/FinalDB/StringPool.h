@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Глобальный пул интернированных строк (имена, типы, даты).
+// Каждая различная строка хранится один раз, в узлах таблиц вместо
+// неё лежит 4-байтный id. Память пула не перемещается и не
+// освобождается, поэтому string_view из пула действительны до конца
+// программы. intern() потокобезопасен, view() работает без блокировок.
+class StringPool {
+public:
+    typedef uint32_t Id;             // 0 — пустая строка
+
+    static StringPool& instance();
+
+    Id intern(std::string_view text);
+    // id уже интернированной строки; 0 — такой строки в пуле нет
+    Id find(std::string_view text) const;
+
+    std::string_view view(Id id) const {
+        if (id == 0) return std::string_view();
+        const Entry* seg = segments[id >> SEGMENT_BITS].load(std::memory_order_acquire);
+        const Entry& e = seg[id & SEGMENT_MASK];
+        return std::string_view(e.data, e.length);
+    }
+
+    size_t count() const;            // различных строк
+    size_t bytes() const;            // байт под сами строки
+
+private:
+    struct Entry {
+        const char* data;
+        uint32_t length;
+    };
+
+    static const unsigned SEGMENT_BITS = 12;
+    static const Id SEGMENT_SIZE = 1u << SEGMENT_BITS;
+    static const Id SEGMENT_MASK = SEGMENT_SIZE - 1;
+    static const size_t MAX_SEGMENTS = 1u << 15;   // до ~134M строк
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    StringPool();
+    ~StringPool();
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    const char* store(std::string_view text);
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string_view, Id> lookup;
+    std::atomic<Entry*> segments[MAX_SEGMENTS];
+    std::vector<char*> blocks;
+    char* current;                   // блок, в который дописываем
+    size_t blockUsed;
+    Id nextId;
+    size_t totalBytes;
+};
+
+// Строка из пула: 4 байта в узле вместо std::string
+class InternedString {
+public:
+    InternedString() : id(0) {}
+    explicit InternedString(std::string_view text)
+        : id(StringPool::instance().intern(text)) {}
+
+    std::string_view view() const { return StringPool::instance().view(id); }
+    operator std::string_view() const { return view(); }
+    std::string str() const { return std::string(view()); }
+    StringPool::Id handle() const { return id; }
+    bool empty() const { return id == 0; }
+
+    // Одинаковые строки в пуле имеют один id
+    bool operator==(const InternedString& other) const { return id == other.id; }
+    bool operator!=(const InternedString& other) const { return id != other.id; }
+    bool operator==(std::string_view text) const { return view() == text; }
+    bool operator!=(std::string_view text) const { return view() != text; }
+
+private:
+    StringPool::Id id;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const InternedString& s) {
+    return os << s.view();
+}
@@ -0,0 +1,210 @@
+#include "SubstringScan.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FINALDB_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC компилирует интринсики без флагов; GCC/Clang — только в функциях
+// с соответствующим target, чтобы остальной код не требовал AVX2.
+#if defined(FINALDB_X86) && !defined(_MSC_VER)
+#define FINALDB_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FINALDB_TARGET(isa)
+#endif
+
+using namespace std;
+
+namespace {
+
+const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+typedef size_t (*FindFn)(const char* hay, size_t n, const char* needle, size_t m);
+
+// Скалярное ядро: memchr по первому символу + memcmp остатка
+size_t findScalar(const char* hay, size_t n, const char* needle, size_t m) {
+    if (m > n) return NOT_FOUND;
+    const char* p = hay;
+    const char* last = hay + (n - m);
+    while (p <= last) {
+        p = static_cast<const char*>(memchr(p, needle[0], static_cast<size_t>(last - p) + 1));
+        if (!p) return NOT_FOUND;
+        if (memcmp(p + 1, needle + 1, m - 1) == 0) return static_cast<size_t>(p - hay);
+        ++p;
+    }
+    return NOT_FOUND;
+}
+
+#ifdef FINALDB_X86
+
+inline int lowestBit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// SSE4.2: PCMPESTRI ищет первые ≤16 байт образца в 16-байтном блоке
+// (включая частичное совпадение у конца блока), остаток — memcmp.
+// Блоки читаются за пределы n — это допустимо благодаря хвосту кучи.
+FINALDB_TARGET("sse4.2")
+size_t findSse42(const char* hay, size_t n, const char* needle, size_t m) {
+    if (m > n) return NOT_FOUND;
+    if (m == 1) {
+        const char* p = static_cast<const char*>(memchr(hay, needle[0], n));
+        return p ? static_cast<size_t>(p - hay) : NOT_FOUND;
+    }
+    const int head = m < 16 ? static_cast<int>(m) : 16;
+    char buf[16] = {};
+    memcpy(buf, needle, static_cast<size_t>(head));
+    const __m128i pat = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+
+    size_t i = 0;
+    while (i + m <= n) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+        const int idx = _mm_cmpestri(pat, head, block, 16,
+            _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ORDERED | _SIDD_LEAST_SIGNIFICANT);
+        if (idx == 16) {
+            i += 16;
+            continue;
+        }
+        const size_t cand = i + static_cast<size_t>(idx);
+        if (cand + m > n) return NOT_FOUND;
+        if (memcmp(hay + cand, needle, m) == 0) return cand;
+        i = cand + 1;
+    }
+    return NOT_FOUND;
+}
+
+// AVX2: сравнение первого и последнего символа образца сразу
+// в 32 позициях, полная проверка только для совпавших по обоим.
+FINALDB_TARGET("avx2")
+size_t findAvx2(const char* hay, size_t n, const char* needle, size_t m) {
+    if (m > n) return NOT_FOUND;
+    if (m == 1) {
+        const char* p = static_cast<const char*>(memchr(hay, needle[0], n));
+        return p ? static_cast<size_t>(p - hay) : NOT_FOUND;
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+
+    for (size_t i = 0; i + m <= n; i += 32) {
+        const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+        const __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + m - 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast))));
+        while (mask != 0) {
+            const size_t cand = i + static_cast<size_t>(lowestBit(mask));
+            if (cand + m > n) return NOT_FOUND;
+            if (memcmp(hay + cand + 1, needle + 1, m - 2) == 0) return cand;
+            mask &= mask - 1;
+        }
+    }
+    return NOT_FOUND;
+}
+
+void detectCpu(bool& sse42, bool& avx2) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    sse42 = (info[2] & (1 << 20)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx) {
+        // ОС должна сохранять YMM-регистры при переключении контекста
+        if ((_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+    }
+#else
+    __builtin_cpu_init();
+    sse42 = __builtin_cpu_supports("sse4.2") != 0;
+    avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // FINALDB_X86
+
+FindFn kernelFn(SubstringScan::Kernel kernel) {
+#ifdef FINALDB_X86
+    if (kernel == SubstringScan::Kernel::AVX2) return findAvx2;
+    if (kernel == SubstringScan::Kernel::SSE42) return findSse42;
+#endif
+    (void)kernel;
+    return findScalar;
+}
+
+} // namespace
+
+bool SubstringScan::kernelSupported(Kernel kernel) {
+    if (kernel == Kernel::SCALAR) return true;
+#ifdef FINALDB_X86
+    struct CpuFeatures {
+        bool sse42;
+        bool avx2;
+        CpuFeatures() : sse42(false), avx2(false) { detectCpu(sse42, avx2); }
+    };
+    static const CpuFeatures cpu;
+    return kernel == Kernel::AVX2 ? cpu.avx2 : cpu.sse42;
+#else
+    return false;
+#endif
+}
+
+SubstringScan::Kernel SubstringScan::bestKernel() {
+    static const Kernel best =
+        kernelSupported(Kernel::AVX2) ? Kernel::AVX2 :
+        kernelSupported(Kernel::SSE42) ? Kernel::SSE42 : Kernel::SCALAR;
+    return best;
+}
+
+const char* SubstringScan::kernelName(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::AVX2: return "avx2";
+    case Kernel::SSE42: return "sse4.2";
+    default: return "scalar";
+    }
+}
+
+void SubstringScan::scan(const StringHeap& heap, const string& pattern, vector<int>& ids) {
+    scan(heap, pattern, ids, bestKernel());
+}
+
+void SubstringScan::scan(const StringHeap& heap, const string& pattern,
+    vector<int>& ids, Kernel kernel) {
+    ids.clear();
+    const size_t count = heap.count();
+    if (pattern.empty()) {
+        for (size_t i = 0; i < count; ++i) ids.push_back(heap.idAt(i));
+        return;
+    }
+    if (!kernelSupported(kernel)) kernel = Kernel::SCALAR;
+    const FindFn find = kernelFn(kernel);
+
+    // Один проход по всему буферу: строки разделены '\0', поэтому
+    // совпадение не может пересечь границу; после попадания
+    // переходим сразу к следующей строке.
+    const char* data = heap.data();
+    const size_t total = heap.size();
+    size_t pos = 0;
+    size_t row = 0;
+    while (pos < total) {
+        const size_t hit = find(data + pos, total - pos, pattern.data(), pattern.size());
+        if (hit == NOT_FOUND) break;
+        const size_t at = pos + hit;
+        while (heap.offsetAt(row + 1) <= at) ++row;
+        ids.push_back(heap.idAt(row));
+        pos = heap.offsetAt(++row);
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "StringHeap.h"
+#include <string>
+#include <vector>
+
+// Пакетный поиск подстроки по упакованной куче строк.
+// Ядро выбирается при первом вызове по возможностям процессора:
+// AVX2 → SSE4.2 → скалярное (memchr + memcmp).
+class SubstringScan {
+public:
+    enum class Kernel { SCALAR, SSE42, AVX2 };
+
+    static Kernel bestKernel();
+    static bool kernelSupported(Kernel kernel);
+    static const char* kernelName(Kernel kernel);
+
+    // id всех строк кучи, содержащих pattern (в порядке кучи)
+    static void scan(const StringHeap& heap, const std::string& pattern, std::vector<int>& ids);
+    // То же с явно заданным ядром (для бенчмарка)
+    static void scan(const StringHeap& heap, const std::string& pattern,
+        std::vector<int>& ids, Kernel kernel);
+};
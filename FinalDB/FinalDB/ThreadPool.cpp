@@ -0,0 +1,69 @@
+#include "ThreadPool.h"
+#include <algorithm>
+using namespace std;
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::run, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    hasTask.notify_all();
+    for (thread& t : workers) t.join();
+}
+
+void ThreadPool::submit(function<void()> task) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(move(task));
+    }
+    hasTask.notify_one();
+}
+
+void ThreadPool::wait() {
+    unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return tasks.empty() && active == 0; });
+    if (failure) {
+        exception_ptr e = failure;
+        failure = nullptr;
+        rethrow_exception(e);
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const function<void(size_t, size_t)>& body) {
+    if (count == 0) return;
+    size_t parts = min<size_t>(size(), count);
+    size_t step = (count + parts - 1) / parts;
+    for (size_t begin = 0; begin < count; begin += step) {
+        size_t end = min(count, begin + step);
+        submit([&body, begin, end] { body(begin, end); });
+    }
+    wait();
+}
+
+void ThreadPool::run() {
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        hasTask.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;   // остановка
+        function<void()> task = move(tasks.front());
+        tasks.pop_front();
+        ++active;
+        lock.unlock();
+        try {
+            task();
+        }
+        catch (...) {
+            lock_guard<std::mutex> guard(mutex);
+            if (!failure) failure = current_exception();
+        }
+        lock.lock();
+        --active;
+        if (tasks.empty() && active == 0) idle.notify_all();
+    }
+}
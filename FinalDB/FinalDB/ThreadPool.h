@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков фиксированного размера для пакетной обработки.
+// Исключение из задачи сохраняется и пробрасывается из wait().
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = 0);   // 0 — по числу ядер
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    void submit(std::function<void()> task);
+    void wait();   // все отправленные задачи выполнены
+
+    // [0, count) делится на куски по числу потоков; возвращает после всех
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body);
+
+private:
+    void run();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable hasTask;
+    std::condition_variable idle;
+    size_t active = 0;
+    std::exception_ptr failure;
+    bool stopping = false;
+};
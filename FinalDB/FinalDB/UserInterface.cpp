@@ -1,20 +1,25 @@
 #include "UserInterface.h"
+#include "Metrics.h"
+#include "TableFormatter.h"
 #include <iostream>
 #include <limits>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
 #include <clocale>
+#include <cstdio>
 #include <iomanip>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
 // ======= Вспомогательные методы для работы с датами =======
-bool UserInterface::parseDate(const std::string& dateStr, Date& date) {
+bool UserInterface::parseDate(std::string_view dateStr, Date& date) {
     if (dateStr.size() != 10 || dateStr[2] != '.' || dateStr[5] != '.') return false;
     try {
-        date.day = stoi(dateStr.substr(0, 2));
-        date.month = stoi(dateStr.substr(3, 2));
-        date.year = stoi(dateStr.substr(6, 4));
+        date.day = stoi(string(dateStr.substr(0, 2)));
+        date.month = stoi(string(dateStr.substr(3, 2)));
+        date.year = stoi(string(dateStr.substr(6, 4)));
     }
     catch (...) {
         return false;
@@ -45,28 +50,20 @@ int UserInterface::calculateAge(const Date& birthDate, const Date& violationDate
     return age;
 }
 
-// ======= Сортировка статистики по городам =======
-int UserInterface::compareCityStats(const void* a, const void* b) {
-    const CityViolations* ca = static_cast<const CityViolations*>(a);
-    const CityViolations* cb = static_cast<const CityViolations*>(b);
-    return cb->count - ca->count;
-}
-
-void UserInterface::printCityViolations(CityViolations* stats, int cityCount) {
+// ======= Статистика по городам =======
+void UserInterface::printCityViolations(const std::vector<CityViolations>& stats) {
     std::cout << "+----------------------+-------------+------------+------------+\n";
     std::cout << "| City                 | Violations  | Date       | Paid       |\n";
     std::cout << "+----------------------+-------------+------------+------------+\n";
-    for (int i = 0; i < cityCount; ++i) {
-        for (int j = 0; j < stats[i].count; ++j) {
-            auto vi = dbManager.getRegistry().getViolationById(
-                stats[i].violationIds[j],
-                dbManager.getDrivers(),
-                dbManager.getCities(),
-                dbManager.getFines()
-            );
+    FineRegistry& registry = dbManager.getRegistry();
+    FineRegistry::ViolationInfo vi;
+    for (const CityViolations& city : stats) {
+        for (int recordId : city.violationIds) {
+            // Дата и оплата — собственные поля записи, имена не нужны
+            if (!registry.findViolation(recordId, vi)) continue;
             ostringstream oss;
-            oss << "| " << left << setw(20) << stats[i].name << " | "
-                << right << setw(10) << stats[i].count << " | "
+            oss << "| " << left << setw(20) << city.name << " | "
+                << right << setw(10) << city.violationIds.size() << " | "
                 << left << setw(10) << vi.date << " | "
                 << left << setw(10) << (vi.paid ? "Yes" : "No") << " |";
             std::cout << oss.str() << "\n";
@@ -78,7 +75,7 @@ void UserInterface::printCityViolations(CityViolations* stats, int cityCount) {
 void UserInterface::showTopDrivers() {
     std::cout << "\nTop-5 drivers by violation count:\n";
     auto violations = dbManager.getAllViolations();
-    map<std::string, int> countMap;
+    map<std::string_view, int> countMap;
     for (auto& v : violations) {
         countMap[v.driverName]++;
     }
@@ -89,31 +86,362 @@ void UserInterface::showTopDrivers() {
     }
 }
 
+void UserInterface::showGroupByReport() {
+    std::cout << "\n--- Group-by Report ---\n";
+    std::cout << "Dimensions: city, grade, settlement, fine, severity, month, driver\n";
+    std::cout << "Measures:   count, sum, avg, min_date, max_date, paid_ratio\n";
+    std::string dimensions = readString("Group by (comma-separated, empty for totals): ");
+    std::string measures = readString("Measures (comma-separated, empty for all): ");
+    try {
+        GroupByEngine::Spec spec = GroupByEngine::parseSpec(dimensions, measures);
+        int limit = readInt("Show top N groups (0 for all): ");
+        spec.limit = limit > 0 ? static_cast<size_t>(limit) : 0;
+        GroupByEngine::Result result = dbManager.groupViolations(spec);
+        std::cout << TableFormatter::format(result.table);
+        std::cout << result.groups.size() << " group(s) from " << result.rowsScanned
+            << " violation(s), " << result.threads << " thread(s).\n";
+    }
+    catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+    }
+}
+
+void UserInterface::showTimeSeries() {
+    std::cout << "\n--- Violations Over Time ---\n";
+    std::string unit = readString("Granularity (day/month/year): ");
+    ViolationRollup::Granularity granularity;
+    if (unit == "day") granularity = ViolationRollup::Granularity::DAY;
+    else if (unit == "month") granularity = ViolationRollup::Granularity::MONTH;
+    else if (unit == "year") granularity = ViolationRollup::Granularity::YEAR;
+    else {
+        std::cout << "Unknown granularity.\n";
+        return;
+    }
+    // Пустая граница — без ограничения
+    int bounds[2] = { 0, 99991231 };
+    const char* prompts[2] = { "From date (DD.MM.YYYY, empty for all): ", "To date (DD.MM.YYYY, empty for all): " };
+    for (int i = 0; i < 2; ++i) {
+        std::string text = readString(prompts[i]);
+        if (text.empty()) continue;
+        bounds[i] = FineRegistry::dateKey(text);
+        if (bounds[i] == 0) {
+            std::cout << "Invalid date.\n";
+            return;
+        }
+    }
+    std::string cityName = readString("City (empty for all): ");
+    try {
+        auto start = chrono::steady_clock::now();
+        auto points = dbManager.violationSeries(granularity, bounds[0], bounds[1], cityName);
+        double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        if (points.empty()) {
+            std::cout << "No violations in this range.\n";
+            return;
+        }
+        auto money = [](double v) {
+            std::ostringstream oss;
+            oss << fixed << setprecision(2) << v;
+            return oss.str();
+        };
+        std::vector<std::vector<std::string>> table;
+        table.push_back({ "Period", "City", "Severity", "Violations", "Paid", "Billed", "Revenue" });
+        for (const auto& p : points) {
+            char period[16];
+            if (granularity == ViolationRollup::Granularity::DAY)
+                snprintf(period, sizeof(period), "%02d.%02d.%04d", p.bucket % 100, p.bucket / 100 % 100, p.bucket / 10000);
+            else if (granularity == ViolationRollup::Granularity::MONTH)
+                snprintf(period, sizeof(period), "%02d.%04d", p.bucket % 100, p.bucket / 100);
+            else
+                snprintf(period, sizeof(period), "%04d", p.bucket);
+            CityTable::CityInfo city;
+            std::string cityLabel = dbManager.getCities().getCityById(p.cityId, city) ? std::string(city.name) : "-";
+            std::string severity = p.severity < 0 ? "-"
+                : FineTable::severityToString(static_cast<FineTable::Severity>(p.severity));
+            table.push_back({ period, cityLabel, severity, to_string(p.count), to_string(p.paid),
+                money(p.billed), money(p.revenue) });
+        }
+        std::cout << TableFormatter::format(table);
+        std::ostringstream took;
+        took << fixed << setprecision(1) << us;
+        std::cout << points.size() << " point(s) in " << took.str() << " us.\n";
+    }
+    catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+    }
+}
+
+void UserInterface::showDebtors() {
+    std::cout << "\n--- Debtors ---\n";
+    auto money = [](double v) {
+        std::ostringstream oss;
+        oss << fixed << setprecision(2) << v;
+        return oss.str();
+    };
+    std::vector<std::vector<std::string>> table;
+    std::string name = readString("Driver name (empty for debtor list): ");
+    if (!name.empty()) {
+        auto matches = dbManager.getDrivers().findAllByName(name);
+        if (matches.empty()) {
+            std::cout << "Driver not found.\n";
+            return;
+        }
+        table.push_back({ "Driver", "Birth date", "Unpaid", "Outstanding" });
+        for (const auto& d : matches) {
+            DebtLedger::Debt debt = dbManager.driverDebt(d.id);
+            table.push_back({ std::string(d.fullName), std::string(d.birthDate),
+                to_string(debt.unpaid), money(debt.balance()) });
+        }
+        std::cout << TableFormatter::format(table);
+        return;
+    }
+    double minBalance = readDouble("Minimum outstanding balance: ");
+    int top = readInt("Show top N (0 for all): ");
+    auto list = dbManager.debtors(minBalance, top > 0 ? static_cast<size_t>(top) : 0);
+    if (list.empty()) {
+        std::cout << "No drivers owe more than " << money(minBalance) << ".\n";
+        return;
+    }
+    table.push_back({ "Driver", "Unpaid", "Outstanding" });
+    for (const auto& debt : list) {
+        DriverTable::DriverInfo d;
+        std::string driver = dbManager.getDrivers().getDriverById(debt.driverId, d) ? std::string(d.fullName) : "-";
+        table.push_back({ driver, to_string(debt.unpaid), money(debt.balance()) });
+    }
+    std::cout << TableFormatter::format(table);
+    std::cout << list.size() << " debtor(s).\n";
+}
+
+void UserInterface::showMetrics() {
+    if (!Metrics::enabled()) {
+        std::cout << "Metrics are compiled out (FINALDB_METRICS=0).\n";
+        return;
+    }
+    auto metrics = Metrics::instance().snapshot();
+    if (metrics.empty()) {
+        std::cout << "No operations recorded yet.\n";
+        return;
+    }
+    std::vector<std::vector<std::string>> table;
+    table.push_back({ "Operation", "Calls", "Total ms", "p50 us", "p99 us", "Max us", "Scanned", "Returned" });
+    auto fmt = [](double v) {
+        std::ostringstream oss;
+        oss << fixed << setprecision(1) << v;
+        return oss.str();
+    };
+    for (auto& m : metrics) {
+        table.push_back({ m.name, to_string(m.calls), fmt(m.totalMs), fmt(m.p50Us), fmt(m.p99Us),
+            fmt(m.maxUs), to_string(m.rowsScanned), to_string(m.rowsReturned) });
+    }
+    std::cout << TableFormatter::format(table);
+}
+
+void UserInterface::dumpMetrics() {
+    std::string filename = readString("File name (empty for metrics.json): ");
+    if (filename.empty()) filename = "metrics.json";
+    if (Metrics::instance().dumpJson(filename))
+        std::cout << "Metrics written to " << filename << ".\n";
+}
+
 void UserInterface::mergeDatabaseMenu() {
     std::cout << "\n--- Merge External Database ---\n";
-    std::string suf = readString("Enter suffix (e.g. _ext): ");
+    std::string line = readString("Enter suffixes separated by spaces (e.g. _ext _north): ");
+    std::istringstream iss(line);
+    std::vector<std::string> suffixes;
+    std::string suf;
+    while (iss >> suf) suffixes.push_back(suf);
+    if (suffixes.empty()) {
+        std::cout << "No suffixes given.\n";
+        return;
+    }
     try {
-        dbManager.loadExternalTables(suf);
-        dbManager.mergeExternalTables();
-        std::cout << "Merge completed and saved.\n";
+        MergeEngine::Report report = dbManager.mergeExternal(suffixes);
+        std::vector<std::vector<std::string>> table;
+        table.push_back({ "Source", "Loaded", "Cities", "Drivers", "Fines", "Violations",
+            "New", "Duplicates", "Rejected", "Load ms" });
+        for (const auto& s : report.sources) {
+            std::ostringstream ms;
+            ms << fixed << setprecision(1) << s.loadMs;
+            table.push_back({ s.suffix, s.loaded ? "yes" : "partial", to_string(s.cities),
+                to_string(s.drivers), to_string(s.fines), to_string(s.violations),
+                to_string(s.newViolations), to_string(s.duplicateViolations),
+                to_string(s.rejectedViolations), ms.str() });
+        }
+        std::cout << TableFormatter::format(table);
+        for (const auto& s : report.sources) {
+            if (s.invalidIds)
+                std::cout << "Source " << s.suffix << ": skipped " << s.invalidIds << " row(s) with invalid IDs\n";
+        }
+        std::cout << "Cities added/updated:     " << report.citiesAdded << " / " << report.citiesUpdated << "\n";
+        std::cout << "Fines added/updated:      " << report.finesAdded << " / " << report.finesUpdated << "\n";
+        std::cout << "Drivers added/rejected:   " << report.driversAdded << " / " << report.driversRejected << "\n";
+        std::cout << "Violations added/updated: " << report.violationsAdded << " / " << report.violationsUpdated << "\n";
+        if (!report.remapFile.empty()) std::cout << "ID remap written to " << report.remapFile << "\n";
+        std::cout << "Merge completed.\n";
     }
     catch (const std::exception& e) {
         std::cout << "Error during merge: " << e.what() << "\n";
     }
 }
 
+// ======= Консоль запросов =======
+void UserInterface::queryConsole() {
+    std::cout << "\n--- Query Console ---\n";
+    std::cout << "Syntax: [EXPLAIN] <cities|drivers|fines|violations> [WHERE <condition>]\n";
+    std::cout << "        [ORDER BY <field> [ASC|DESC], ...] [LIMIT <n>]\n";
+    std::cout << "  operators: = != < <= > >=, IN (...), BETWEEN a AND b, CONTAINS, STARTS WITH\n";
+    std::cout << "  logic:     AND, OR, NOT, parentheses\n";
+    std::cout << "  example:   violations where city.grade = Large and fine.severity = Heavy\n";
+    std::cout << "             violations where paid = 0 order by date desc limit 50\n";
+    std::cout << "Empty line to go back.\n";
+    while (true) {
+        std::string text = readString("query> ");
+        if (text.empty()) return;
+        try {
+            QueryResult result = dbManager.runQuery(text);
+            if (result.explainOnly) {
+                std::cout << result.plan;
+                continue;
+            }
+            std::vector<std::vector<std::string>> table;
+            table.push_back(result.columns);
+            table.insert(table.end(), result.rows.begin(), result.rows.end());
+            std::cout << TableFormatter::format(table);
+            std::cout << "(" << result.rows.size() << " rows)\n";
+        }
+        catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+    }
+}
+
+// ======= Ссылочная целостность =======
+void UserInterface::integrityMenu() {
+    ReferentialIntegrity& integrity = dbManager.getIntegrity();
+    while (true) {
+        std::cout << "\n--- ON DELETE policies ---\n";
+        for (int i = 0; i < ReferentialIntegrity::RELATION_COUNT; ++i) {
+            auto relation = static_cast<ReferentialIntegrity::Relation>(i);
+            std::cout << (i + 1) << ". " << left << setw(18)
+                << ReferentialIntegrity::relationToString(relation)
+                << ReferentialIntegrity::policyToString(integrity.getPolicy(relation)) << "\n";
+        }
+        std::cout << (ReferentialIntegrity::RELATION_COUNT + 1) << ". Back\n";
+        int choice = readInt("Choose relation: ");
+        if (choice == ReferentialIntegrity::RELATION_COUNT + 1) return;
+        if (choice < 1 || choice > ReferentialIntegrity::RELATION_COUNT) {
+            std::cout << "Invalid choice.\n";
+            continue;
+        }
+        std::cout << "1. set-null\n2. cascade\n3. restrict\n";
+        int policy = readInt("Policy: ");
+        if (policy < 1 || policy > 3) {
+            std::cout << "Invalid choice.\n";
+            continue;
+        }
+        const ReferentialIntegrity::OnDelete policies[] = { ReferentialIntegrity::OnDelete::SET_NULL,
+            ReferentialIntegrity::OnDelete::CASCADE, ReferentialIntegrity::OnDelete::RESTRICT };
+        integrity.setPolicy(static_cast<ReferentialIntegrity::Relation>(choice - 1), policies[policy - 1]);
+        integrity.savePolicies();
+    }
+}
+
+// ======= Фоновая запись =======
+void UserInterface::persistenceMenu() {
+    BackgroundWriter& writer = dbManager.getWriter();
+    const char* names[] = { "sync", "async", "batched", "deferred" };
+    while (true) {
+        std::cout << "\n--- Persistence ---\n";
+        std::cout << "Durability: " << names[static_cast<int>(writer.getDurability())]
+            << " (batch " << writer.getMaxBatch() << " changes / "
+            << writer.getMaxDelay().count() << " ms)\n";
+        std::cout << "Commits: " << writer.getCommitCount()
+            << ", disk writes: " << writer.getWriteCount() << "\n";
+        ChangeStream& changes = dbManager.getChanges();
+        std::cout << "Change log: " << (dbManager.isChangeLogging() ? dbManager.getChangeLogPath() : "off")
+            << " (events " << changes.getEmitted() << ", delivered " << changes.getDelivered() << ")\n";
+        int cutoff = dbManager.getColdCutoff();
+        std::cout << "Cold storage: ";
+        if (cutoff) std::cout << "paid violations before 01.01." << cutoff / 10000 << "\n";
+        else std::cout << "off\n";
+        std::cout << "1. Sync (write on every change)\n";
+        std::cout << "2. Async (background, as soon as possible)\n";
+        std::cout << "3. Batched (background, group commit)\n";
+        std::cout << "4. Flush Now\n";
+        std::cout << "5. Change Log (CDC) On/Off\n";
+        std::cout << "6. Cold Storage\n";
+        std::cout << "7. Back\n";
+        int choice = readInt("Choose option: ");
+        switch (choice) {
+        case 1: writer.setDurability(BackgroundWriter::Durability::SYNC); break;
+        case 2: writer.setDurability(BackgroundWriter::Durability::ASYNC); break;
+        case 3: {
+            int batch = readInt("Max changes per write: ");
+            int delay = readInt("Max delay (ms): ");
+            writer.setBatchLimits(batch > 0 ? batch : 1, std::chrono::milliseconds(delay > 0 ? delay : 0));
+            writer.setDurability(BackgroundWriter::Durability::BATCHED);
+            break;
+        }
+        case 4:
+            dbManager.flush();
+            std::cout << "All changes written.\n";
+            break;
+        case 5:
+            if (dbManager.isChangeLogging()) {
+                dbManager.stopChangeLog();
+                std::cout << "Change log stopped.\n";
+                break;
+            }
+            {
+                std::string path = readString("Change log file (empty = changes.log): ");
+                if (path.empty()) path = "changes.log";
+                if (dbManager.startChangeLog(path)) std::cout << "Logging changes to " << path << "\n";
+            }
+            break;
+        case 6: {
+            // Более новые записи холодного яруса возвращаются в горячий
+            int year = readInt("Keep paid violations before 1 January of year compressed (0 = off): ");
+            dbManager.setColdCutoff(year > 0 ? year * 10000 + 101 : 0);
+            size_t moved = dbManager.compactCold();
+            auto lock = dbManager.lockTables();
+            FineRegistry& registry = dbManager.getRegistry();
+            std::cout << "Compressed now: " << moved << ", cold: " << registry.getColdCount()
+                << " of " << registry.getRecordCount() << " violations\n";
+            std::cout << "Memory: hot rows " << registry.storageBytes() / 1024 << " KB, cold blocks "
+                << registry.coldBytes() / 1024 << " KB\n";
+            break;
+        }
+        case 7: return;
+        default: std::cout << "Invalid choice. Try again.\n";
+        }
+    }
+}
+
+void UserInterface::printImportReport(const BulkImport::Report& report) {
+    std::cout << "Rows read: " << report.rowsRead << ", imported: " << report.inserted;
+    if (report.duplicates) std::cout << ", already present: " << report.duplicates;
+    if (report.paidDuplicates) std::cout << " (" << report.paidDuplicates << " marked paid)";
+    std::cout << ", rejected: " << report.rejected << "\n";
+    for (const std::string& error : report.errors) std::cout << "  " << error << "\n";
+    if (report.rejected > report.errors.size())
+        std::cout << "  ... and " << (report.rejected - report.errors.size()) << " more\n";
+}
+
+void UserInterface::printDeleteReport(const ReferentialIntegrity::DeleteReport& report) {
+    if (report.driversDeleted) std::cout << "  drivers deleted:      " << report.driversDeleted << "\n";
+    if (report.driversNulled) std::cout << "  drivers unlinked:     " << report.driversNulled << "\n";
+    if (report.violationsDeleted) std::cout << "  violations deleted:   " << report.violationsDeleted << "\n";
+    if (report.violationsNulled) std::cout << "  violations unlinked:  " << report.violationsNulled << "\n";
+}
 
 // ======= Глобальные меню =======
 void UserInterface::run() {
     setlocale(LC_ALL, "");
-    dbManager.loadAll();
     while (true) {
         mainMenu();
     }
 }
 
 void UserInterface::mainMenu() {
-    dbManager.loadAll();
     while (true) {
         std::cout << "\n=== Main Menu ===\n";
         std::cout << "1. Manage Cities\n";
@@ -122,7 +450,10 @@ void UserInterface::mainMenu() {
         std::cout << "4. Manage Violations\n";
         std::cout << "5. Statistics\n";
         std::cout << "6. Merge External Database\n";   // <-- новый пункт
-        std::cout << "7. Exit\n";
+        std::cout << "7. Query Console\n";
+        std::cout << "8. Integrity Settings\n";
+        std::cout << "9. Persistence Settings\n";
+        std::cout << "10. Exit\n";
         int choice = readInt("Choose option: ");
         switch (choice) {
         case 1: citiesMenu();   break;
@@ -131,7 +462,10 @@ void UserInterface::mainMenu() {
         case 4: registryMenu(); break;
         case 5: statisticsMenu(); break;
         case 6: mergeDatabaseMenu(); break;   // <-- обработка
-        case 7: dbManager.saveAll(); exit(0);
+        case 7: queryConsole(); break;
+        case 8: integrityMenu(); break;
+        case 9: persistenceMenu(); break;
+        case 10: dbManager.flush(); exit(0);
         default: std::cout << "Invalid choice. Try again.\n";
         }
     }
@@ -209,8 +543,14 @@ void UserInterface::addCity() {
 
 void UserInterface::deleteCity() {
     string name = readString("City name to delete: ");
-    dbManager.deleteCity(name);
-    std::cout << "City deleted (if it existed).\n";
+    try {
+        auto report = dbManager.deleteCity(name);
+        std::cout << "City deleted.\n";
+        printDeleteReport(report);
+    }
+    catch (const exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+    }
 }
 
 void UserInterface::filterCities() {
@@ -223,9 +563,10 @@ void UserInterface::filterCities() {
     std::cout << "5. Population equals\n";
     std::cout << "6. Type equals\n";
     std::cout << "7. Grade equals\n";
-    std::cout << "8. Cancel\n";
+    std::cout << "8. Name starts with\n";
+    std::cout << "9. Cancel\n";
     int choice = readInt("Choose filter type: ");
-    if (choice == 8) return;
+    if (choice == 9) return;
     if (choice == 1) {
         string val = readString("Enter substring: ");
         cities.addFilter("name", 1, val);
@@ -256,6 +597,10 @@ void UserInterface::filterCities() {
         string val = readString("Enter grade: ");
         cities.addFilter("grade", 2, val);
     }
+    else if (choice == 8) {
+        string val = readString("Enter prefix: ");
+        cities.addFilter("name", 5, val);
+    }
     else {
         std::cout << "Invalid option.\n";
         return;
@@ -319,6 +664,7 @@ void UserInterface::editCity() {
     int choice = readInt("Choose field: ");
     if (choice == 1) {
         string newName = readString("Enter new name: ");
+        auto lock = dbManager.lockTables();
         if (cities.updateCityName(id, newName))
             std::cout << "Name updated.\n";
         else
@@ -326,6 +672,7 @@ void UserInterface::editCity() {
     }
     else if (choice == 2) {
         int newPop = readInt("Enter new population: ");
+        auto lock = dbManager.lockTables();
         if (cities.updateCityPopulation(id, newPop))
             std::cout << "Population updated.\n";
         else
@@ -334,6 +681,7 @@ void UserInterface::editCity() {
     else if (choice == 3) {
         std::cout << "Grades: 0-Small, 1-Medium, 2-Large\n";
         int g = readInt("Choose grade: ");
+        auto lock = dbManager.lockTables();
         if (cities.updateCityGrade(id, static_cast<CityTable::PopulationGrade>(g)))
             std::cout << "Grade updated.\n";
         else
@@ -342,6 +690,7 @@ void UserInterface::editCity() {
     else if (choice == 4) {
         std::cout << "Types: 0-City, 1-Town, 2-Village\n";
         int t = readInt("Choose type: ");
+        auto lock = dbManager.lockTables();
         if (cities.updateCityType(id, static_cast<CityTable::SettlementType>(t)))
             std::cout << "Type updated.\n";
         else
@@ -350,6 +699,7 @@ void UserInterface::editCity() {
     else {
         std::cout << "Cancel.\n";
     }
+    dbManager.commit();
 }
 
 // ==================== Drivers ====================
@@ -363,7 +713,8 @@ void UserInterface::driversMenu() {
         std::cout << "5. Remove Specific Driver Filters\n";
         std::cout << "6. Clear All Driver Filters\n";
         std::cout << "7. Edit Driver\n";
-        std::cout << "8. Back\n";
+        std::cout << "8. Import Drivers (CSV/TSV)\n";
+        std::cout << "9. Back\n";
         int choice = readInt("Choose option: ");
         switch (choice) {
         case 1: listDrivers();           break;
@@ -373,7 +724,8 @@ void UserInterface::driversMenu() {
         case 5: removeDriverFilters();   break;
         case 6: clearAllDriverFilters(); break;
         case 7: editDriver();            break;
-        case 8: return;
+        case 8: importDrivers();         break;
+        case 9: return;
         default: std::cout << "Invalid choice.\n";
         }
     }
@@ -403,7 +755,7 @@ void UserInterface::listDrivers() {
                 fullNameWidth = static_cast<int>(di.fullName.length());
             }
             // Получаем имя города по cityId
-            std::string cityName = dbManager.getCities().getCityNameById(di.cityId);
+            std::string_view cityName = dbManager.getCities().getCityNameById(di.cityId);
             if (static_cast<int>(cityName.length()) > cityNameWidth) {
                 cityNameWidth = static_cast<int>(cityName.length());
             }
@@ -439,7 +791,7 @@ void UserInterface::listDrivers() {
     if (filtered) {
         for (int i = 0; i < count; ++i) {
             const auto& di = filtered[i];
-            std::string cityName = dbManager.getCities().getCityNameById(di.cityId);
+            std::string_view cityName = dbManager.getCities().getCityNameById(di.cityId);
 
             std::ostringstream oss;
             oss << "| " << std::left << std::setw(fullNameWidth) << di.fullName
@@ -498,8 +850,7 @@ void UserInterface::deleteDriver() {
         return;
     }
     if (candidates.size() == 1) {
-        dbManager.deleteDriverById(candidates[0].id);
-        std::cout << "Driver deleted.\n";
+        deleteDriverById(candidates[0].id);
         return;
     }
     // Если несколько с одинаковым ФИО — уточним по дате рождения
@@ -514,8 +865,7 @@ void UserInterface::deleteDriver() {
         return;
     }
     if (filtered.size() == 1) {
-        dbManager.deleteDriverById(filtered[0].id);
-        std::cout << "Driver deleted.\n";
+        deleteDriverById(filtered[0].id);
         return;
     }
     // Если по дате всё ещё несколько — уточним по городу
@@ -537,8 +887,18 @@ void UserInterface::deleteDriver() {
         std::cout << "No matching driver with that city.\n";
         return;
     }
-    dbManager.deleteDriverById(toDelete.id);
-    std::cout << "Driver deleted.\n";
+    deleteDriverById(toDelete.id);
+}
+
+void UserInterface::deleteDriverById(int id) {
+    try {
+        auto report = dbManager.deleteDriverById(id);
+        std::cout << "Driver deleted.\n";
+        printDeleteReport(report);
+    }
+    catch (const exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+    }
 }
 
 void UserInterface::filterDrivers() {
@@ -547,9 +907,10 @@ void UserInterface::filterDrivers() {
     std::cout << "1. Full Name contains\n";
     std::cout << "2. Full Name equals\n";
     std::cout << "3. Birth Date equals\n";
-    std::cout << "4. Cancel\n";
+    std::cout << "4. Full Name starts with\n";
+    std::cout << "5. Cancel\n";
     int choice = readInt("Choose filter type: ");
-    if (choice == 4) return;
+    if (choice == 5) return;
     if (choice == 1) {
         string val = readString("Enter substring: ");
         drivers.addFilter("fullName", 1, val);
@@ -562,6 +923,10 @@ void UserInterface::filterDrivers() {
         string val = readString("Enter birth date (DD.MM.YYYY): ");
         drivers.addFilter("birthDate", 2, val);
     }
+    else if (choice == 4) {
+        string val = readString("Enter prefix: ");
+        drivers.addFilter("fullName", 5, val);
+    }
     else {
         std::cout << "Invalid option.\n";
         return;
@@ -665,6 +1030,7 @@ void UserInterface::editDriver() {
     auto& drivers = dbManager.getDrivers();
     if (choice == 1) {
         string newName = readString("Enter new name: ");
+        auto lock = dbManager.lockTables();
         if (drivers.updateDriverName(target.id, newName))
             std::cout << "Name updated.\n";
         else
@@ -672,6 +1038,7 @@ void UserInterface::editDriver() {
     }
     else if (choice == 2) {
         string newDate = readString("Enter new birth date (DD.MM.YYYY): ");
+        auto lock = dbManager.lockTables();
         if (drivers.updateDriverBirthDate(target.id, newDate))
             std::cout << "Birth date updated.\n";
         else
@@ -684,6 +1051,7 @@ void UserInterface::editDriver() {
             std::cout << "City not found.\n";
         }
         else {
+            auto lock = dbManager.lockTables();
             if (drivers.updateDriverCity(target.id, newCityId)) {
                 // Каскадно обновляем все нарушения этого водителя
                 dbManager.getRegistry().updateViolationsCity(target.id, newCityId);
@@ -697,7 +1065,18 @@ void UserInterface::editDriver() {
     else {
         std::cout << "Cancel.\n";
     }
-    dbManager.saveAll();
+    dbManager.commit();
+}
+
+void UserInterface::importDrivers() {
+    std::cout << "Columns: name, birth_date, city (header line optional)\n";
+    string path = readString("CSV/TSV file: ");
+    try {
+        printImportReport(dbManager.importDrivers(path));
+    }
+    catch (const exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+    }
 }
 
 // ==================== Fines ====================
@@ -764,8 +1143,14 @@ void UserInterface::addFine() {
 
 void UserInterface::deleteFine() {
     string type = readString("Fine type to delete: ");
-    dbManager.getFines().deleteFine(type);
-    std::cout << "Fine deleted (if existed).\n";
+    try {
+        auto report = dbManager.deleteFine(type);
+        std::cout << "Fine deleted.\n";
+        printDeleteReport(report);
+    }
+    catch (const exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+    }
 }
 
 void UserInterface::filterFines() {
@@ -777,9 +1162,10 @@ void UserInterface::filterFines() {
     std::cout << "4. Amount >\n";
     std::cout << "5. Amount equals\n";
     std::cout << "6. Severity equals\n";
-    std::cout << "7. Cancel\n";
+    std::cout << "7. Type starts with\n";
+    std::cout << "8. Cancel\n";
     int choice = readInt("Choose filter type: ");
-    if (choice == 7) return;
+    if (choice == 8) return;
     if (choice == 1) {
         string val = readString("Enter substring: ");
         fines.addFilter("type", 1, val);
@@ -804,6 +1190,10 @@ void UserInterface::filterFines() {
         string val = readString("Enter severity: ");
         fines.addFilter("severity", 2, val);
     }
+    else if (choice == 7) {
+        string val = readString("Enter prefix: ");
+        fines.addFilter("type", 5, val);
+    }
     else {
         std::cout << "Invalid option.\n";
         return;
@@ -866,6 +1256,7 @@ void UserInterface::editFine() {
     int choice = readInt("Choose field: ");
     if (choice == 1) {
         string newType = readString("Enter new type: ");
+        auto lock = dbManager.lockTables();
         if (fines.updateFineType(id, newType))
             std::cout << "Type updated.\n";
         else
@@ -873,7 +1264,7 @@ void UserInterface::editFine() {
     }
     else if (choice == 2) {
         double newAmt = readDouble("Enter new amount: ");
-        if (fines.updateFineAmount(id, newAmt))
+        if (dbManager.updateFineAmount(id, newAmt))
             std::cout << "Amount updated.\n";
         else
             std::cout << "Update failed.\n";
@@ -881,6 +1272,7 @@ void UserInterface::editFine() {
     else if (choice == 3) {
         std::cout << "Severity (0-Light, 1-Medium, 2-Heavy): ";
         int snew = readInt("");
+        auto lock = dbManager.lockTables();
         if (fines.updateFineSeverity(id, static_cast<FineTable::Severity>(snew)))
             std::cout << "Severity updated.\n";
         else
@@ -889,7 +1281,7 @@ void UserInterface::editFine() {
     else {
         std::cout << "Cancel.\n";
     }
-    dbManager.saveAll();
+    dbManager.commit();
 }
 
 // ==================== Violations ====================
@@ -903,7 +1295,8 @@ void UserInterface::registryMenu() {
         std::cout << "5. Remove Specific Violation Filters\n";
         std::cout << "6. Clear All Violation Filters\n";
         std::cout << "7. Edit Violation\n";
-        std::cout << "8. Back\n";
+        std::cout << "8. Import Violations (CSV/TSV)\n";
+        std::cout << "9. Back\n";
         int choice = readInt("Choose option: ");
         switch (choice) {
         case 1: listViolations();            break;
@@ -913,7 +1306,8 @@ void UserInterface::registryMenu() {
         case 5: removeViolationFilters();    break;
         case 6: clearAllViolationFilters();  break;
         case 7: editViolation();             break;
-        case 8: return;
+        case 8: importViolations();          break;
+        case 9: return;
         default: std::cout << "Invalid choice.\n";
         }
     }
@@ -1023,13 +1417,25 @@ void UserInterface::addViolation() {
 
     // Всё ок, добавляем
     try {
+        auto lock = dbManager.lockTables();
         dbManager.getRegistry().addViolation(chosen.id, chosen.cityId, fineId, dateStr);
         std::cout << "Violation added.\n";
     }
     catch (const exception& e) {
         std::cout << "Error: " << e.what() << "\n";
     }
-    dbManager.saveAll();
+    dbManager.commit();
+}
+
+void UserInterface::importViolations() {
+    std::cout << "Columns: driver, fine, date[, paid[, birth_date]] (header line optional)\n";
+    string path = readString("CSV/TSV file: ");
+    try {
+        printImportReport(dbManager.importViolations(path));
+    }
+    catch (const exception& e) {
+        std::cout << "Error: " << e.what() << "\n";
+    }
 }
 
 void UserInterface::markViolationPaid() {
@@ -1046,7 +1452,7 @@ void UserInterface::markViolationPaid() {
     }
     if (found) {
         std::cout << "Violation(s) marked paid.\n";
-        dbManager.saveAll();
+        dbManager.commit();
     }
     else {
         std::cout << "No unpaid violation found matching criteria.\n";
@@ -1262,6 +1668,7 @@ void UserInterface::editViolation() {
             return;
         }
         // Всё ок, обновляем driverId и привязываем новую cityId
+        auto lock = dbManager.lockTables();
         registry.updateViolationDriver(chosen.recordId, newChosen.id, newChosen.cityId);
         std::cout << "Driver in violation updated.\n";
     }
@@ -1274,6 +1681,7 @@ void UserInterface::editViolation() {
             std::cout << "Fine not found.\n";
             return;
         }
+        auto lock = dbManager.lockTables();
         registry.updateViolationFine(chosen.recordId, newFineId);
         std::cout << "Fine type updated.\n";
     }
@@ -1307,6 +1715,7 @@ void UserInterface::editViolation() {
             std::cout << "Driver was under 18 at that new date. Cannot set violation date.\n";
             return;
         }
+        auto lock = dbManager.lockTables();
         registry.updateViolationDate(chosen.recordId, newDate);
         std::cout << "Violation date updated.\n";
     }
@@ -1315,6 +1724,7 @@ void UserInterface::editViolation() {
         std::cout << "Current paid status: " << (chosen.paid ? "Yes" : "No") << "\n";
         std::cout << "Enter new status (1 = paid, 0 = unpaid): ";
         int p = readInt("");
+        auto lock = dbManager.lockTables();
         registry.updateViolationPaid(chosen.recordId, p == 1);
         std::cout << "Paid status updated.\n";
     }
@@ -1322,7 +1732,7 @@ void UserInterface::editViolation() {
         std::cout << "Cancelled.\n";
         return;
     }
-    dbManager.saveAll();
+    dbManager.commit();
 }
 
 // ==================== Statistics ====================
@@ -1331,47 +1741,59 @@ void UserInterface::statisticsMenu() {
         std::cout << "\n--- Statistics ---\n";
         std::cout << "1. Violations by City\n";
         std::cout << "2. Top-5 Drivers\n";
-        std::cout << "3. Back\n";
+        std::cout << "3. Group-by Report\n";
+        std::cout << "4. Violations Over Time\n";
+        std::cout << "5. Debtors\n";
+        std::cout << "6. Performance Metrics\n";
+        std::cout << "7. Dump Metrics (JSON)\n";
+        std::cout << "8. Back\n";
         int choice = readInt("Choose option: ");
         switch (choice) {
         case 1: showViolationsByCity(); break;
         case 2: showTopDrivers();       break;
-        case 3: return;
+        case 3: showGroupByReport();    break;
+        case 4: showTimeSeries();       break;
+        case 5: showDebtors();          break;
+        case 6: showMetrics();          break;
+        case 7: dumpMetrics();          break;
+        case 8: return;
         default: std::cout << "Invalid choice.\n";
         }
     }
 }
 
 void UserInterface::showViolationsByCity() {
-    CityViolations stats[MAX_CITIES];
-    int cityCount = 0;
-    collectCityStats(stats, cityCount);
-    if (cityCount == 0) {
+    auto lock = dbManager.lockTables();
+    std::vector<CityViolations> stats = collectCityStats();
+    if (stats.empty()) {
         std::cout << "No cities with violations.\n";
         return;
     }
-    qsort(stats, cityCount, sizeof(CityViolations), compareCityStats);
-    printCityViolations(stats, cityCount);
+    printCityViolations(stats);
 }
 
-void UserInterface::collectCityStats(CityViolations* stats, int& cityCount) {
-    cityCount = 0;
-    auto violations = dbManager.getAllViolations();
-    for (auto& v : violations) {
-        int idx = -1;
-        for (int i = 0; i < cityCount; ++i) {
-            if (stats[i].name == v.cityName) {
-                idx = i;
-                break;
-            }
-        }
-        if (idx == -1) {
-            idx = cityCount++;
-            stats[idx].name = v.cityName;
-            stats[idx].count = 0;
-        }
-        stats[idx].violationIds[stats[idx].count++] = v.recordId;
-    }
+// Один проход по реестру: позиция города в stats ищется по cityId
+// в хеш-таблице, имя города — один раз на город
+std::vector<UserInterface::CityViolations> UserInterface::collectCityStats() {
+    FINALDB_METRIC_SCOPE("stats.violationsByCity");
+    FineRegistry& registry = dbManager.getRegistry();
+    CityTable& cities = dbManager.getCities();
+    std::vector<int> recordIds = registry.getAllRecordIds();
+    std::vector<CityViolations> stats;
+    std::unordered_map<int, size_t> slotOf;
+    FineRegistry::ViolationInfo v;
+    for (int recordId : recordIds) {
+        registry.findViolation(recordId, v);
+        auto slot = slotOf.emplace(v.cityId, stats.size());
+        if (slot.second) stats.push_back({ v.cityId, std::string(cities.getCityNameById(v.cityId)), {} });
+        stats[slot.first->second].violationIds.push_back(recordId);
+    }
+    sort(stats.begin(), stats.end(), [](const CityViolations& a, const CityViolations& b) {
+        if (a.violationIds.size() != b.violationIds.size()) return a.violationIds.size() > b.violationIds.size();
+        return a.name < b.name;
+    });
+    FINALDB_METRIC_ROWS(recordIds.size(), stats.size());
+    return stats;
 }
 
 // ======= Утилиты ввода/вывода =======
@@ -1,6 +1,8 @@
 #pragma once
 #include "DataBaseManager.h"
 #include <string>
+#include <string_view>
+#include <vector>
 
 class UserInterface {
 public:
@@ -11,17 +13,15 @@ private:
         int day, month, year;
     };
 
-    static bool parseDate(const std::string& dateStr, Date& date);
+    static bool parseDate(std::string_view dateStr, Date& date);
     static bool isDateValid(const Date& date);
     static int calculateAge(const Date& birthDate, const Date& violationDate);
 
-    static const int MAX_CITIES = 100;
-    static const int MAX_VIOLATIONS_PER_CITY = 1000;
-
+    // Нарушения одного города для статистики
     struct CityViolations {
+        int cityId;
         std::string name;
-        int violationIds[MAX_VIOLATIONS_PER_CITY];
-        int count;
+        std::vector<int> violationIds;   // recordId, от новых к старым
     };
 
     DatabaseManager dbManager;
@@ -34,6 +34,9 @@ private:
     void registryMenu();
     void mergeDatabaseMenu();
     void statisticsMenu();
+    void queryConsole();
+    void integrityMenu();
+    void persistenceMenu();
 
     // Города
     void listCities();
@@ -48,10 +51,12 @@ private:
     void listDrivers();
     void addDriver();
     void deleteDriver();
+    void deleteDriverById(int id);
     void filterDrivers();
     void removeDriverFilters();
     void clearAllDriverFilters();
     void editDriver();
+    void importDrivers();
 
     // Штрафы
     void listFines();
@@ -70,17 +75,25 @@ private:
     void removeViolationFilters();
     void clearAllViolationFilters();
     void editViolation();
+    void importViolations();
 
     // Статистика
     void showViolationsByCity();
     void showTopDrivers();
+    void showGroupByReport();
+    void showTimeSeries();
+    void showDebtors();
+    void showMetrics();
+    void dumpMetrics();
 
     // Методы для сбора и печати статистики по городам
-    void collectCityStats(CityViolations* stats, int& cityCount);
-    void printCityViolations(CityViolations* stats, int cityCount);
-    static int compareCityStats(const void* a, const void* b);
+    // Города по убыванию числа нарушений
+    std::vector<CityViolations> collectCityStats();
+    void printCityViolations(const std::vector<CityViolations>& stats);
 
     // Утилиты ввода/вывода
+    static void printDeleteReport(const ReferentialIntegrity::DeleteReport& report);
+    static void printImportReport(const BulkImport::Report& report);
     int readInt(const std::string& prompt);
     double readDouble(const std::string& prompt);
     std::string readString(const std::string& prompt);
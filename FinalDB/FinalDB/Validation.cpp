@@ -0,0 +1,57 @@
+#include "Validation.h"
+#include <ctime>
+using namespace std;
+
+// Пробельные символы \s: пробел, \t \n \v \f \r
+static bool isNameChar(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool Validation::isName(string_view name) {
+    if (name.empty()) return false;
+    for (char c : name)
+        if (!isNameChar(static_cast<unsigned char>(c))) return false;
+    return true;
+}
+
+bool Validation::parseDate(string_view text, Date& date) {
+    if (text.size() != 10 || text[2] != '.' || text[5] != '.') return false;
+    int value[3] = { 0, 0, 0 };
+    static const int start[3] = { 0, 3, 6 };
+    static const int length[3] = { 2, 2, 4 };
+    for (int part = 0; part < 3; ++part) {
+        for (int i = start[part]; i < start[part] + length[part]; ++i) {
+            unsigned digit = static_cast<unsigned char>(text[i]) - '0';
+            if (digit > 9) return false;
+            value[part] = value[part] * 10 + static_cast<int>(digit);
+        }
+    }
+    date.day = value[0];
+    date.month = value[1];
+    date.year = value[2];
+    return true;
+}
+
+Validation::Date Validation::today() {
+    time_t t = time(nullptr);
+    tm now;
+    localtime_s(&now, &t);
+    Date date;
+    date.day = now.tm_mday;
+    date.month = now.tm_mon + 1;
+    date.year = now.tm_year + 1900;
+    return date;
+}
+
+int Validation::ageOn(const Date& birth, const Date& day) {
+    int age = day.year - birth.year;
+    if (day.month < birth.month || (day.month == birth.month && day.day < birth.day)) --age;
+    return age;
+}
+
+bool Validation::isDriverAge(string_view birthDate, const Date& today) {
+    Date birth;
+    if (!parseDate(birthDate, birth)) return false;
+    int age = ageOn(birth, today);
+    return age >= 18 && age <= 100;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string_view>
+
+// Проверки полей без regex и без выделения памяти.
+// Правила прежних регулярных выражений сохранены:
+//   ФИО  — ^[A-Za-z\s]+$
+//   дата — ^\d{2}\.\d{2}\.\d{4}$ (только формат, диапазоны не проверяются)
+// Разбор даты и проверка формата — один проход по 10 символам.
+class Validation {
+public:
+    struct Date {
+        int day = 0, month = 0, year = 0;
+    };
+
+    static bool isName(std::string_view name);
+    static bool parseDate(std::string_view text, Date& date);   // false — не DD.MM.YYYY
+    static bool isDate(std::string_view text) {
+        Date date;
+        return parseDate(text, date);
+    }
+
+    // Текущая дата (localtime). Для пакетов берётся один раз на пакет.
+    static Date today();
+    static int ageOn(const Date& birth, const Date& day);
+    // Возраст водителя 18–100 лет на дату today
+    static bool isDriverAge(std::string_view birthDate, const Date& today);
+};
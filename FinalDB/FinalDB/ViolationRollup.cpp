@@ -0,0 +1,112 @@
+#include "ViolationRollup.h"
+#include "Metrics.h"
+#include <tuple>
+using namespace std;
+
+int ViolationRollup::bucketOf(Granularity granularity, int day) {
+    switch (granularity) {
+    case Granularity::MONTH: return day / 100;
+    case Granularity::YEAR:  return day / 10000;
+    default:                 return day;
+    }
+}
+
+void ViolationRollup::add(int day, int cityId, int fineId, bool paid, int delta) {
+    if (day == 0) return;
+    for (int g = 0; g < 3; ++g) {
+        int bucket = bucketOf(static_cast<Granularity>(g), day);
+        vector<Cell>& cells = levels[g][bucket];
+        auto it = lower_bound(cells.begin(), cells.end(), make_pair(cityId, fineId),
+            [](const Cell& c, const pair<int, int>& key) {
+                return tie(c.cityId, c.fineId) < tie(key.first, key.second);
+            });
+        if (it == cells.end() || it->cityId != cityId || it->fineId != fineId) {
+            if (delta < 0) {              // снимать нечего
+                if (cells.empty()) levels[g].erase(bucket);
+                continue;
+            }
+            it = cells.insert(it, Cell{ cityId, fineId, 0, 0 });
+        }
+        it->count += static_cast<uint32_t>(delta);
+        if (paid) it->paid += static_cast<uint32_t>(delta);
+        // Пустые ячейки и корзины не хранятся
+        if (it->count == 0) {
+            cells.erase(it);
+            if (cells.empty()) levels[g].erase(bucket);
+        }
+    }
+}
+
+void ViolationRollup::clear() {
+    for (Level& level : levels) level.clear();
+}
+
+void ViolationRollup::shrinkToFit() {
+    for (Level& level : levels)
+        for (auto& bucket : level) bucket.second.shrink_to_fit();
+}
+
+size_t ViolationRollup::cellCount() const {
+    size_t n = 0;
+    for (const Level& level : levels)
+        for (const auto& bucket : level) n += bucket.second.size();
+    return n;
+}
+
+vector<ViolationRollup::Point> ViolationRollup::series(Granularity granularity,
+    int fromDay, int toDay, int cityId, const FineTable& fines) const
+{
+    FINALDB_METRIC_SCOPE("rollup.series");
+    // Тяжесть и сумма штрафа — по текущему FineTable, один поиск на fineId
+    struct FineRate {
+        bool known = false;
+        int severity = -1;
+        double amount = 0;
+    };
+    map<int, FineRate> rates;
+    auto rateOf = [&](int fineId) -> const FineRate& {
+        FineRate& rate = rates[fineId];
+        if (!rate.known) {
+            rate.known = true;
+            FineTable::FineInfo info;
+            if (fines.getFineById(fineId, info)) {
+                rate.severity = static_cast<int>(info.severity);
+                rate.amount = info.amount;
+            }
+        }
+        return rate;
+    };
+
+    // Ячейки идут по корзине, затем по городу: точки (корзина, город)
+    // копятся в массиве по тяжести и сбрасываются при смене города
+    vector<Point> points;
+    Point pending[4];                // LIGHT, MEDIUM, HEAVY, штрафа нет
+    int pendingBucket = 0, pendingCity = 0;
+    bool havePending = false;
+    size_t cells = 0;
+    auto flush = [&] {
+        for (Point& p : pending) {
+            if (p.count) points.push_back(p);
+            p = Point();
+        }
+    };
+    visit(granularity, fromDay, toDay, cityId, [&](int bucket, const Cell& cell) {
+        ++cells;
+        if (havePending && (bucket != pendingBucket || cell.cityId != pendingCity)) flush();
+        havePending = true;
+        pendingBucket = bucket;
+        pendingCity = cell.cityId;
+        const FineRate& rate = rateOf(cell.fineId);
+        Point& p = pending[rate.severity < 0 ? 3 : rate.severity];
+        p.bucket = bucket;
+        p.cityId = cell.cityId;
+        p.severity = rate.severity;
+        p.count += cell.count;
+        p.paid += cell.paid;
+        p.billed += rate.amount * cell.count;
+        p.revenue += rate.amount * cell.paid;
+    });
+    flush();
+    FINALDB_METRIC_ROWS(cells, points.size());
+    return points;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "FineTable.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Счётчики нарушений по корзинам времени (день, месяц, год) × город × штраф.
+// Ведутся FineRegistry при каждом изменении записи, поэтому ряды для
+// дашборда не требуют прохода по реестру и разбора дат: запрос диапазона —
+// обход нескольких корзин упорядоченного словаря.
+// Хранится fineId, а не тяжесть и сумма: их правки в FineTable не делают
+// счётчики устаревшими, тяжесть и сумма подставляются при запросе.
+class ViolationRollup {
+public:
+    enum class Granularity { DAY, MONTH, YEAR };
+    static const int ANY_CITY = INT_MIN;
+
+    // Корзина — (cityId, fineId) в порядке возрастания
+    struct Cell {
+        int32_t  cityId;
+        int32_t  fineId;
+        uint32_t count;
+        uint32_t paid;
+    };
+
+    // Точка ряда: корзина × город × тяжесть
+    struct Point {
+        int    bucket;               // YYYYMMDD, YYYYMM или YYYY
+        int    cityId;
+        int    severity;             // FineTable::Severity, -1 — штрафа нет
+        size_t count = 0, paid = 0;
+        double billed = 0;           // сумма штрафов по текущим ставкам
+        double revenue = 0;          // из них оплачено
+    };
+
+    // day — YYYYMMDD (0 — дата некорректна, в счётчики не попадает);
+    // delta — +1 при появлении записи, -1 при её исчезновении
+    void add(int day, int cityId, int fineId, bool paid, int delta);
+    void clear();
+    // Отдать лишнюю ёмкость корзин (после загрузки)
+    void shrinkToFit();
+
+    // Ключ корзины для даты YYYYMMDD
+    static int bucketOf(Granularity granularity, int day);
+
+    // Обход ячеек корзин, пересекающих [fromDay, toDay] (YYYYMMDD);
+    // cityId = ANY_CITY — все города. visit(bucket, const Cell&)
+    template <class Visit>
+    void visit(Granularity granularity, int fromDay, int toDay, int cityId, Visit visit) const {
+        const Level& level = levels[static_cast<int>(granularity)];
+        auto first = level.lower_bound(bucketOf(granularity, fromDay));
+        auto last = level.upper_bound(bucketOf(granularity, toDay));
+        for (auto it = first; it != last; ++it) {
+            const std::vector<Cell>& cells = it->second;
+            auto range = std::make_pair(cells.begin(), cells.end());
+            if (cityId != ANY_CITY)
+                range = std::equal_range(cells.begin(), cells.end(), Cell{ cityId, 0, 0, 0 }, CityLess());
+            for (auto cell = range.first; cell != range.second; ++cell) visit(it->first, *cell);
+        }
+    }
+
+    // Ряд по корзинам × городам × тяжести, по возрастанию корзины и города
+    std::vector<Point> series(Granularity granularity, int fromDay, int toDay,
+        int cityId, const FineTable& fines) const;
+
+    size_t cellCount() const;
+
+private:
+    using Level = std::map<int, std::vector<Cell>>;
+    Level levels[3];                 // по Granularity
+
+    struct CityLess {
+        bool operator()(const Cell& a, const Cell& b) const { return a.cityId < b.cityId; }
+    };
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+// Точки входа бенчмарков; argv — аргументы после имени подкоманды
+int runScanBench(int argc, char** argv);
+int runGenCommand(int argc, char** argv);
+int runTableBench(int argc, char** argv);
+int runValidateBench(int argc, char** argv);
+int runLoadGen(int argc, char** argv);
+
+// Пиковый рабочий набор процесса в байтах (0 — неизвестно)
+size_t peakRssBytes();
+
+// Секундомер для замеров
+class BenchTimer {
+public:
+    BenchTimer() : start(std::chrono::steady_clock::now()) {}
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
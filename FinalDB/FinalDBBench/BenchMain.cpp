@@ -0,0 +1,58 @@
+#include "Bench.h"
+#include <cstring>
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+using namespace std;
+
+size_t peakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);           // байты
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;    // килобайты
+#endif
+#endif
+}
+
+static void printUsage() {
+    cout << "Usage: FinalDBBench <command> [args]\n"
+        << "  scan [rows] [iterations]   substring kernels vs matchField\n"
+        << "  gen [violations] [options] write a synthetic database\n"
+        << "  tables [violations] [options]\n"
+        << "                             load/save/filters/statistics/merge on generated data\n"
+        << "  validate [rows] [iterations]\n"
+        << "                             regex vs hand-rolled field validation\n"
+        << "  loadgen [address] [options]\n"
+        << "                             QPS and latency against FinalDB --serve (127.0.0.1:5433)\n"
+        << "options: --drivers N --cities N --fines N --skew S --dup F --seed N\n"
+        << "         --suffix S (gen) --dir D (default bench_data for tables)\n"
+        << "         --ext N (tables) violations in the merged _ext base (100), 0 skips merge\n"
+        << "         --clients N --seconds S --pipeline D --query F --write F --debt F (loadgen)\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    if (strcmp(argv[1], "scan") == 0) return runScanBench(argc - 2, argv + 2);
+    if (strcmp(argv[1], "gen") == 0) return runGenCommand(argc - 2, argv + 2);
+    if (strcmp(argv[1], "tables") == 0) return runTableBench(argc - 2, argv + 2);
+    if (strcmp(argv[1], "validate") == 0) return runValidateBench(argc - 2, argv + 2);
+    if (strcmp(argv[1], "loadgen") == 0) return runLoadGen(argc - 2, argv + 2);
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,358 @@
+#include "DataGen.h"
+#include "Bench.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+using namespace std;
+
+namespace {
+
+// Слоги для фамилий и названий городов (только латиница — как в validateName)
+const char* SYLLABLES[] = { "vol", "kov", "mor", "sid", "pet", "leb", "bor", "vas", "gor", "dan",
+    "zhu", "kar", "lap", "mak", "nos", "pav", "rud", "sem", "tar", "fil",
+    "khar", "tsar", "shes", "yak", "bel", "gro", "kras", "sol", "zai", "ab" };
+const int SYLLABLE_COUNT = sizeof(SYLLABLES) / sizeof(SYLLABLES[0]);
+const int ROOT_COUNT = SYLLABLE_COUNT * SYLLABLE_COUNT * (1 + SYLLABLE_COUNT);
+
+const char* MALE_NAMES[] = { "Ivan", "Petr", "Sergey", "Andrey", "Dmitry", "Pavel", "Nikolay",
+    "Alexey", "Mikhail", "Oleg", "Igor", "Yury", "Viktor", "Roman", "Denis",
+    "Artem", "Maxim", "Egor", "Anton", "Boris" };
+const char* FEMALE_NAMES[] = { "Anna", "Maria", "Elena", "Olga", "Irina", "Natalia", "Tatiana",
+    "Svetlana", "Ekaterina", "Yulia", "Daria", "Polina", "Vera", "Nina", "Alina",
+    "Ksenia", "Sofia", "Galina", "Lidia", "Marina" };
+const int FIRST_NAME_COUNT = 20;
+const char* PATRONYMIC_ROOTS[] = { "Ivanov", "Petrov", "Sergeev", "Andreev", "Dmitriev", "Pavlov",
+    "Nikolaev", "Alexeev", "Mikhailov", "Olegov", "Igorev", "Viktorov" };
+const int PATRONYMIC_COUNT = 12;
+const char* MALE_ENDINGS[] = { "ov", "in", "sky" };
+const char* FEMALE_ENDINGS[] = { "ova", "ina", "skaya" };
+const int ENDING_COUNT = 3;
+
+const char* CITY_ENDINGS[] = { "grad", "sk", "ovo", "insk", "evka", "ino",
+    "burg", "polye", "gorsk", "yar", "ovka", "ets" };
+const int CITY_ENDING_COUNT = 12;
+
+struct FineBase {
+    const char* type;
+    int amount;
+    int severity;   // 0 Light, 1 Medium, 2 Heavy
+};
+const FineBase FINE_BASES[] = {
+    { "Speeding", 500, 1 }, { "RedLight", 1000, 2 }, { "NoSeatbelt", 1000, 1 },
+    { "Parking", 300, 0 }, { "SpeakPhone", 1500, 1 }, { "Drunkdrive", 30000, 2 },
+    { "ExpiredLicense", 600, 1 }, { "NoInsurance", 800, 1 }, { "WrongLane", 500, 0 },
+    { "Tailgating", 700, 1 }, { "IllegalTurn", 500, 0 }, { "NoHeadlights", 500, 0 },
+    { "Overloading", 2000, 1 }, { "NoHelmet", 1000, 1 }, { "StopLine", 800, 0 },
+    { "Overtaking", 5000, 2 }, { "Tinting", 500, 0 }, { "NoRegistration", 1500, 1 },
+    { "BusLane", 1500, 0 }, { "Pedestrian", 2500, 2 } };
+const int FINE_BASE_COUNT = sizeof(FINE_BASES) / sizeof(FINE_BASES[0]);
+const char* FINE_QUALIFIERS[] = { "", "Urban", "Highway", "Repeat", "Night", "School", "Winter", "Truck" };
+const int FINE_QUALIFIER_COUNT = sizeof(FINE_QUALIFIERS) / sizeof(FINE_QUALIFIERS[0]);
+const char* SEVERITY_NAMES[] = { "Light", "Medium", "Heavy" };
+
+// Корень из 2–3 слогов, первая буква заглавная; разные r дают разные корни
+string rootName(int r) {
+    string s;
+    if (r < SYLLABLE_COUNT * SYLLABLE_COUNT) {
+        s = string(SYLLABLES[r / SYLLABLE_COUNT]) + SYLLABLES[r % SYLLABLE_COUNT];
+    }
+    else {
+        r -= SYLLABLE_COUNT * SYLLABLE_COUNT;
+        s = string(SYLLABLES[r / (SYLLABLE_COUNT * SYLLABLE_COUNT)])
+            + SYLLABLES[(r / SYLLABLE_COUNT) % SYLLABLE_COUNT] + SYLLABLES[r % SYLLABLE_COUNT];
+    }
+    s[0] = static_cast<char>(s[0] - 'a' + 'A');
+    return s;
+}
+
+// Перемешивание индекса: умножение на простое по модулю — биекция,
+// соседние id получают непохожие имена
+uint64_t scramble(uint64_t index, uint64_t modulo) {
+    return (index % modulo) * 2654435761ULL % modulo;
+}
+
+const uint64_t NAME_COMBINATIONS =
+    2ULL * FIRST_NAME_COUNT * PATRONYMIC_COUNT * ENDING_COUNT * ROOT_COUNT;
+
+string driverName(uint64_t index) {
+    uint64_t k = scramble(index, NAME_COMBINATIONS);
+    bool female = (k % 2) != 0;          k /= 2;
+    int first = static_cast<int>(k % FIRST_NAME_COUNT);  k /= FIRST_NAME_COUNT;
+    int patronymic = static_cast<int>(k % PATRONYMIC_COUNT); k /= PATRONYMIC_COUNT;
+    int ending = static_cast<int>(k % ENDING_COUNT);     k /= ENDING_COUNT;
+    int root = static_cast<int>(k);
+
+    string name = rootName(root) + (female ? FEMALE_ENDINGS[ending] : MALE_ENDINGS[ending]);
+    name += ' ';
+    name += female ? FEMALE_NAMES[first] : MALE_NAMES[first];
+    name += ' ';
+    name += PATRONYMIC_ROOTS[patronymic];
+    name += female ? "na" : "ich";
+    return name;
+}
+
+string cityName(int index) {
+    uint64_t k = scramble(index, static_cast<uint64_t>(ROOT_COUNT) * CITY_ENDING_COUNT);
+    return rootName(static_cast<int>(k / CITY_ENDING_COUNT)) + CITY_ENDINGS[k % CITY_ENDING_COUNT];
+}
+
+// Степенной выбор ранга в [0, n): чем больше exponent, тем сильнее перекос к началу
+int skewedRank(int n, double exponent, mt19937_64& rng) {
+    double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+    int rank = static_cast<int>(n * pow(u, exponent));
+    return min(rank, n - 1);
+}
+
+void appendInt(string& out, long long value) {
+    char buf[24];
+    int len = 0;
+    bool negative = value < 0;
+    unsigned long long v = negative ? 0ULL - static_cast<unsigned long long>(value)
+        : static_cast<unsigned long long>(value);
+    do {
+        buf[len++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (negative) out += '-';
+    while (len) out += buf[--len];
+}
+
+void appendQuoted(string& out, const string& text) {
+    out += '"';
+    out += text;
+    out += '"';
+}
+
+void appendDate(string& out, int day, int month, int year) {
+    out += '"';
+    out += static_cast<char>('0' + day / 10);
+    out += static_cast<char>('0' + day % 10);
+    out += '.';
+    out += static_cast<char>('0' + month / 10);
+    out += static_cast<char>('0' + month % 10);
+    out += '.';
+    appendInt(out, year);
+    out += '"';
+}
+
+void appendRandomDate(string& out, int fromYear, int toYear, mt19937_64& rng) {
+    int day = static_cast<int>(rng() % 28) + 1;
+    int month = static_cast<int>(rng() % 12) + 1;
+    int year = fromYear + static_cast<int>(rng() % (toYear - fromYear + 1));
+    appendDate(out, day, month, year);
+}
+
+// Построчная запись большими порциями
+class TableWriter {
+public:
+    TableWriter(const filesystem::path& path) : file(path, ios::binary), path(path), written(0) {
+        buffer.reserve(FLUSH_SIZE + 256);
+    }
+    bool isOpen() const { return file.is_open(); }
+    string& line() { return buffer; }
+    void endLine() {
+        buffer += '\n';
+        if (buffer.size() >= FLUSH_SIZE) flush();
+    }
+    bool close() {
+        flush();
+        file.close();
+        if (!file) {
+            cerr << "Error writing " << path.string() << "\n";
+            return false;
+        }
+        return true;
+    }
+    long long bytes() const { return written; }
+
+private:
+    static const size_t FLUSH_SIZE = 1 << 20;
+    ofstream file;
+    filesystem::path path;
+    string buffer;
+    long long written;
+
+    void flush() {
+        file.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+        written += static_cast<long long>(buffer.size());
+        buffer.clear();
+    }
+};
+
+bool openWriter(TableWriter& writer, const filesystem::path& path) {
+    if (!writer.isOpen()) {
+        cerr << "Error opening " << path.string() << " for writing\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool generateDatabase(const GenOptions& options, GenSummary& summary) {
+    summary = GenSummary();
+    long long violations = max(0LL, options.violations);
+    int drivers = options.drivers > 0 ? options.drivers
+        : static_cast<int>(min(5000000LL, max(100LL, violations / 20)));
+    int cities = options.cities > 0 ? options.cities : min(5000, max(10, drivers / 200));
+    cities = min(cities, ROOT_COUNT * CITY_ENDING_COUNT);
+    int fines = max(1, min(options.fines, FINE_BASE_COUNT * FINE_QUALIFIER_COUNT));
+
+    error_code ec;
+    filesystem::path dir(options.dir);
+    filesystem::create_directories(dir, ec);
+    auto file = [&](const char* table) { return dir / (table + options.suffix + ".txt"); };
+    mt19937_64 rng(options.seed);
+
+    // Города: id 1 — самый крупный, население падает по Ципфу
+    {
+        TableWriter out(file("cities"));
+        if (!openWriter(out, file("cities"))) return false;
+        for (int i = 0; i < cities; ++i) {
+            double noise = 0.8 + 0.4 * uniform_real_distribution<double>(0.0, 1.0)(rng);
+            int population = max(50, static_cast<int>(12000000.0 / pow(i + 1, 1.1) * noise));
+            const char* grade = population >= 1000000 ? "Large" : population >= 100000 ? "Medium" : "Small";
+            const char* type = population >= 50000 ? "City" : population >= 5000 ? "Town" : "Village";
+            string& line = out.line();
+            appendInt(line, i + 1);
+            line += ' ';
+            appendQuoted(line, cityName(i));
+            line += ' ';
+            appendInt(line, population);
+            line += " \"";
+            line += grade;
+            line += "\" \"";
+            line += type;
+            line += '"';
+            out.endLine();
+        }
+        if (!out.close()) return false;
+        summary.bytes += out.bytes();
+    }
+
+    // Водители: города с перекосом к крупным, часть — тёзки уже созданных
+    vector<int> driverCity(drivers);
+    {
+        TableWriter out(file("drivers"));
+        if (!openWriter(out, file("drivers"))) return false;
+        vector<uint32_t> nameIndex(drivers);
+        for (int i = 0; i < drivers; ++i) {
+            bool duplicate = i > 0
+                && uniform_real_distribution<double>(0.0, 1.0)(rng) < options.duplicateNames;
+            nameIndex[i] = duplicate ? nameIndex[rng() % i] : static_cast<uint32_t>(i);
+            driverCity[i] = skewedRank(cities, 2.0, rng) + 1;
+            string& line = out.line();
+            appendInt(line, i + 1);
+            line += ' ';
+            appendQuoted(line, driverName(nameIndex[i]));
+            line += ' ';
+            appendRandomDate(line, 1950, 2004, rng);
+            line += ' ';
+            appendInt(line, driverCity[i]);
+            out.endLine();
+        }
+        if (!out.close()) return false;
+        summary.bytes += out.bytes();
+    }
+
+    // Штрафы: базовые типы, затем с уточнениями ("SpeedingUrban", ...)
+    {
+        TableWriter out(file("fines"));
+        if (!openWriter(out, file("fines"))) return false;
+        for (int i = 0; i < fines; ++i) {
+            const FineBase& base = FINE_BASES[i % FINE_BASE_COUNT];
+            int qualifier = i / FINE_BASE_COUNT;
+            string& line = out.line();
+            appendInt(line, i + 1);
+            line += ' ';
+            appendInt(line, base.amount + qualifier * base.amount / 4);
+            line += ' ';
+            appendQuoted(line, string(base.type) + FINE_QUALIFIERS[qualifier]);
+            line += " \"";
+            line += SEVERITY_NAMES[base.severity];
+            line += '"';
+            out.endLine();
+        }
+        if (!out.close()) return false;
+        summary.bytes += out.bytes();
+    }
+
+    // Нарушения: «горячие» водители выбираются чаще (ранг → случайный id)
+    {
+        vector<int> byRank(drivers);
+        for (int i = 0; i < drivers; ++i) byRank[i] = i;
+        shuffle(byRank.begin(), byRank.end(), rng);
+
+        TableWriter out(file("registry"));
+        if (!openWriter(out, file("registry"))) return false;
+        for (long long r = 0; r < violations; ++r) {
+            int driver = byRank[skewedRank(drivers, options.skew, rng)];
+            int fine = skewedRank(fines, 1.5, rng) + 1;
+            bool paid = rng() % 10 < 6;
+            string& line = out.line();
+            appendInt(line, r + 1);
+            line += ' ';
+            appendInt(line, driver + 1);
+            line += ' ';
+            appendInt(line, driverCity[driver]);
+            line += ' ';
+            appendInt(line, fine);
+            line += paid ? " 1 " : " 0 ";
+            appendRandomDate(line, 2015, 2025, rng);
+            out.endLine();
+        }
+        if (!out.close()) return false;
+        summary.bytes += out.bytes();
+    }
+
+    summary.cities = cities;
+    summary.drivers = drivers;
+    summary.fines = fines;
+    summary.violations = violations;
+    return true;
+}
+
+bool parseGenOption(const string& key, const char* value, GenOptions& options) {
+    if (key == "--drivers") options.drivers = atoi(value);
+    else if (key == "--cities") options.cities = atoi(value);
+    else if (key == "--fines") options.fines = atoi(value);
+    else if (key == "--skew") options.skew = max(1.0, atof(value));
+    else if (key == "--dup") options.duplicateNames = min(1.0, max(0.0, atof(value)));
+    else if (key == "--seed") options.seed = static_cast<unsigned>(strtoul(value, nullptr, 10));
+    else if (key == "--suffix") options.suffix = value;
+    else if (key == "--dir") options.dir = value;
+    else return false;
+    return true;
+}
+
+int runGenCommand(int argc, char** argv) {
+    GenOptions options;
+    int i = 0;
+    if (argc > 0 && argv[0][0] != '-') options.violations = atoll(argv[i++]);
+    for (; i + 1 < argc; i += 2) {
+        if (!parseGenOption(argv[i], argv[i + 1], options)) {
+            cerr << "gen: unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+    if (i < argc) {
+        cerr << "gen: missing value for " << argv[i] << "\n";
+        return 1;
+    }
+
+    BenchTimer timer;
+    GenSummary summary;
+    if (!generateDatabase(options, summary)) return 1;
+    double ms = timer.elapsedMs();
+    cout << "generated in " << options.dir << ": " << summary.cities << " cities, "
+        << summary.drivers << " drivers, " << summary.fines << " fines, "
+        << summary.violations << " violations (" << summary.bytes / (1024 * 1024) << " MB, "
+        << static_cast<long long>(ms) << " ms)\n";
+    return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+
+// Генератор синтетической базы в формате FinalDB (cities/drivers/fines/registry.txt).
+// Распределения приближены к реальным: население городов и число нарушений
+// на водителя — степенные (немного «горячих» водителей и крупных городов),
+// часть водителей — полные тёзки.
+struct GenOptions {
+    long long violations = 100000;
+    int drivers = 0;              // 0 — подобрать по числу нарушений
+    int cities = 0;               // 0 — подобрать по числу водителей
+    int fines = 40;
+    double skew = 3.0;            // показатель перекоса по водителям; 1 — равномерно
+    double duplicateNames = 0.05; // доля водителей-тёзок
+    unsigned seed = 42;
+    std::string suffix;           // "" — основная база, "_ext" — внешняя для слияния
+    std::string dir = ".";
+};
+
+// Итог генерации (для отчёта)
+struct GenSummary {
+    int cities = 0;
+    int drivers = 0;
+    int fines = 0;
+    long long violations = 0;
+    long long bytes = 0;
+};
+
+// false — ошибка записи (сообщение в cerr)
+bool generateDatabase(const GenOptions& options, GenSummary& summary);
+
+// Разбор общих ключей генератора: --drivers, --cities, --fines, --skew,
+// --dup, --seed, --suffix, --dir. Возвращает false при неизвестном ключе.
+bool parseGenOption(const std::string& key, const char* value, GenOptions& options);
@@ -0,0 +1,169 @@
+#include "Bench.h"
+#include "QueryProtocol.h"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+using namespace QueryProtocol;
+
+namespace {
+
+struct LoadOptions {
+    string address = "127.0.0.1:5433";
+    int clients = 4;
+    double seconds = 5;
+    int pipeline = 1;             // запросов в полёте на соединение
+    double queryShare = 0.10;     // QUERY по водителю
+    double writeShare = 0.05;     // ADD_VIOLATION
+    double debtShare = 0.01;      // DEBT; остальное — GET_VIOLATION
+};
+
+// Размеры базы для случайных ID — из STATS
+struct Bounds {
+    int drivers = 0;
+    int fines = 0;
+    int maxRecordId = 0;
+};
+
+struct ClientResult {
+    vector<double> latencyUs;
+    size_t errors = 0;
+    bool disconnected = false;
+};
+
+string makeRequest(const LoadOptions& o, const Bounds& b, mt19937& rng) {
+    uniform_real_distribution<double> share(0, 1);
+    double r = share(rng);
+    auto pick = [&rng](int n) { return uniform_int_distribution<int>(1, max(1, n))(rng); };
+    if (r < o.queryShare)
+        return Writer(Op::QUERY).str("violations WHERE driver.id = " + to_string(pick(b.drivers)) + " LIMIT 20").finish();
+    r -= o.queryShare;
+    if (r < o.writeShare)
+        return Writer(Op::ADD_VIOLATION).i32(pick(b.drivers)).i32(pick(b.fines)).str("01.06.2024").finish();
+    r -= o.writeShare;
+    if (r < o.debtShare)
+        return Writer(Op::DEBT).i32(pick(b.drivers)).finish();
+    return Writer(Op::GET_VIOLATION).i32(pick(b.maxRecordId)).finish();
+}
+
+// Замкнутый цикл: на каждый ответ — следующий запрос, пока не вышло время
+void runClient(const LoadOptions& o, const Bounds& b, unsigned seed, ClientResult& result) {
+    QueryClient client(o.address);
+    if (!client.isConnected()) {
+        result.disconnected = true;
+        return;
+    }
+    mt19937 rng(seed);
+    using Clock = chrono::steady_clock;
+    Clock::time_point deadline = Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double>(o.seconds));
+    deque<Clock::time_point> inFlight;
+    string response;
+    while (true) {
+        while (static_cast<int>(inFlight.size()) < o.pipeline && Clock::now() < deadline) {
+            if (!client.send(makeRequest(o, b, rng))) {
+                result.disconnected = true;
+                return;
+            }
+            inFlight.push_back(Clock::now());
+        }
+        if (inFlight.empty()) return;
+        if (!client.receive(response)) {
+            result.disconnected = true;
+            return;
+        }
+        result.latencyUs.push_back(chrono::duration<double, micro>(Clock::now() - inFlight.front()).count());
+        inFlight.pop_front();
+        if (response.empty() || static_cast<Status>(response[0]) != Status::OK) ++result.errors;
+    }
+}
+
+bool parseOption(const string& key, const char* value, LoadOptions& o) {
+    if (key == "--clients") o.clients = max(1, atoi(value));
+    else if (key == "--seconds") o.seconds = max(0.1, atof(value));
+    else if (key == "--pipeline") o.pipeline = max(1, atoi(value));
+    else if (key == "--query") o.queryShare = atof(value);
+    else if (key == "--write") o.writeShare = atof(value);
+    else if (key == "--debt") o.debtShare = atof(value);
+    else return false;
+    return true;
+}
+
+double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+int runLoadGen(int argc, char** argv) {
+    LoadOptions options;
+    int i = 0;
+    if (argc > 0 && argv[0][0] != '-') options.address = argv[i++];
+    for (; i + 1 < argc; i += 2) {
+        if (!parseOption(argv[i], argv[i + 1], options)) {
+            cerr << "loadgen: unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+    if (i < argc) {
+        cerr << "loadgen: missing value for " << argv[i] << "\n";
+        return 1;
+    }
+
+    Bounds bounds;
+    {
+        QueryClient client(options.address);
+        string body;
+        if (!client.isConnected() || !client.call(Writer(Op::STATS).finish(), body)) {
+            cerr << "loadgen: server is not available at " << options.address << "\n";
+            return 1;
+        }
+        Reader in(body.data(), body.size());
+        if (static_cast<Status>(in.u8()) != Status::OK) {
+            cerr << "loadgen: STATS failed: " << in.str() << "\n";
+            return 1;
+        }
+        in.u32();   // города
+        bounds.drivers = static_cast<int>(in.u32());
+        bounds.fines = static_cast<int>(in.u32());
+        in.u32();   // нарушения
+        bounds.maxRecordId = in.i32();
+    }
+    cout << "loadgen: " << options.address << ", " << options.clients << " clients x pipeline "
+        << options.pipeline << ", " << options.seconds << " s; mix query " << options.queryShare
+        << " write " << options.writeShare << " debt " << options.debtShare << ", rest get\n";
+
+    vector<ClientResult> results(options.clients);
+    vector<thread> threads;
+    BenchTimer timer;
+    for (int c = 0; c < options.clients; ++c)
+        threads.emplace_back(runClient, cref(options), cref(bounds), 1000u + c, ref(results[c]));
+    for (thread& t : threads) t.join();
+    double elapsedMs = timer.elapsedMs();
+
+    vector<double> latency;
+    size_t errors = 0, lost = 0;
+    for (ClientResult& r : results) {
+        latency.insert(latency.end(), r.latencyUs.begin(), r.latencyUs.end());
+        errors += r.errors;
+        lost += r.disconnected;
+    }
+    sort(latency.begin(), latency.end());
+    cout << left << setw(12) << "requests" << right << setw(10) << "errors" << setw(12) << "QPS"
+        << setw(10) << "p50 us" << setw(10) << "p90 us" << setw(10) << "p99 us"
+        << setw(11) << "p99.9 us" << setw(11) << "max us" << "\n";
+    cout << left << setw(12) << latency.size() << right << setw(10) << errors
+        << setw(12) << fixed << setprecision(0) << latency.size() / (elapsedMs / 1000)
+        << setprecision(1) << setw(10) << percentile(latency, 0.5) << setw(10) << percentile(latency, 0.9)
+        << setw(10) << percentile(latency, 0.99) << setw(11) << percentile(latency, 0.999)
+        << setw(11) << (latency.empty() ? 0.0 : latency.back()) << "\n";
+    if (lost) cerr << "loadgen: " << lost << " connections lost\n";
+    return lost ? 1 : 0;
+}
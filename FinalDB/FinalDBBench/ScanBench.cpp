@@ -0,0 +1,121 @@
+#include "Bench.h"
+#include "StringHeap.h"
+#include "SubstringScan.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+
+// Узел в раскладке таблиц: отдельная аллокация на строку и на узел
+struct NameNode {
+    string name;
+    int id;
+    NameNode* next;
+};
+
+const char* SURNAMES[] = { "Ivanov", "Petrov", "Sidorov", "Morozova", "Novikov",
+    "Kozlova", "Volkov", "Sokolova", "Lebedev", "Popova", "Smirnov", "Kuznetsova" };
+const char* NAMES[] = { "Anna", "Andrey", "Elena", "Sergey", "Olga", "Dmitry",
+    "Maria", "Pavel", "Irina", "Nikolay" };
+const char* PATRONYMICS[] = { "Dmitrievna", "Igorevich", "Nikolaevna", "Sergeevich",
+    "Petrovna", "Andreevich", "Ivanovna", "Olegovich" };
+
+template <size_t N>
+const char* pick(const char* (&arr)[N], mt19937& rng) {
+    return arr[rng() % N];
+}
+
+NameNode* buildList(int rows, StringHeap& heap) {
+    mt19937 rng(42);
+    NameNode* head = nullptr;
+    for (int id = 1; id <= rows; ++id) {
+        string name = string(pick(SURNAMES, rng)) + " " + pick(NAMES, rng) + " "
+            + pick(PATRONYMICS, rng);
+        head = new NameNode{ name, id, head };
+        heap.add(id, name);
+    }
+    return head;
+}
+
+// Текущий путь фильтра: обход списка и find() в каждом узле (matchField, cmpType 1)
+size_t matchFieldScan(const NameNode* head, const string& pattern, vector<int>& ids) {
+    ids.clear();
+    for (const NameNode* n = head; n; n = n->next)
+        if (n->name.find(pattern) != string::npos) ids.push_back(n->id);
+    return ids.size();
+}
+
+void report(const string& pattern, const char* method, size_t matches,
+    double bestMs, int rows, size_t bytes) {
+    cout << left << setw(16) << ("\"" + pattern + "\"") << setw(12) << method
+        << right << setw(10) << matches
+        << setw(12) << fixed << setprecision(3) << bestMs
+        << setw(14) << setprecision(1) << (rows / bestMs / 1000.0)
+        << setw(10) << setprecision(2) << (bytes / bestMs / 1e6) << "\n";
+}
+
+} // namespace
+
+int runScanBench(int argc, char** argv) {
+    int rows = argc > 0 ? atoi(argv[0]) : 1000000;
+    int iterations = argc > 1 ? atoi(argv[1]) : 5;
+    if (rows <= 0 || iterations <= 0) {
+        cerr << "scan: rows and iterations must be positive\n";
+        return 1;
+    }
+
+    StringHeap heap;
+    NameNode* head = buildList(rows, heap);
+    cout << "rows: " << rows << ", heap bytes: " << heap.size()
+        << ", best kernel: " << SubstringScan::kernelName(SubstringScan::bestKernel()) << "\n\n";
+    cout << left << setw(16) << "pattern" << setw(12) << "method" << right << setw(10) << "matches"
+        << setw(12) << "best ms" << setw(14) << "Mrows/s" << setw(10) << "GB/s" << "\n";
+
+    const string patterns[] = { "a", "ov", "Ser", "Nikolaevna", "Petrov Pavel", "zzz" };
+    const SubstringScan::Kernel kernels[] = { SubstringScan::Kernel::SCALAR,
+        SubstringScan::Kernel::SSE42, SubstringScan::Kernel::AVX2 };
+
+    bool ok = true;
+    vector<int> expected, ids;
+    for (const string& pattern : patterns) {
+        double best = 1e300;
+        for (int i = 0; i < iterations; ++i) {
+            BenchTimer t;
+            matchFieldScan(head, pattern, expected);
+            best = min(best, t.elapsedMs());
+        }
+        report(pattern, "matchField", expected.size(), best, rows, heap.size());
+        sort(expected.begin(), expected.end());
+
+        for (SubstringScan::Kernel k : kernels) {
+            if (!SubstringScan::kernelSupported(k)) continue;
+            best = 1e300;
+            for (int i = 0; i < iterations; ++i) {
+                BenchTimer t;
+                SubstringScan::scan(heap, pattern, ids, k);
+                best = min(best, t.elapsedMs());
+            }
+            report(pattern, SubstringScan::kernelName(k), ids.size(), best, rows, heap.size());
+            sort(ids.begin(), ids.end());
+            if (ids != expected) {
+                cerr << "MISMATCH: kernel " << SubstringScan::kernelName(k)
+                    << ", pattern \"" << pattern << "\"\n";
+                ok = false;
+            }
+        }
+        cout << "\n";
+    }
+
+    while (head) {
+        NameNode* next = head->next;
+        delete head;
+        head = next;
+    }
+    return ok ? 0 : 2;
+}
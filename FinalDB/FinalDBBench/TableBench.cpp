@@ -0,0 +1,431 @@
+#include "Bench.h"
+#include "DataGen.h"
+#include "DatabaseManager.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+namespace {
+
+// Один фильтр для замера: таблица, поле, cmpType, значение
+struct FilterCase {
+    string table;
+    string field;
+    int cmpType;
+    string value;
+};
+
+void printHeader() {
+    cout << left << setw(34) << "phase" << right << setw(12) << "ms" << setw(12) << "rows"
+        << setw(14) << "Krows/s" << setw(12) << "result" << setw(12) << "peak MB" << "\n";
+}
+
+// rows — обработано строк, result — строк на выходе
+void report(const string& phase, double ms, long long rows, long long result) {
+    cout << left << setw(34) << phase << right << setw(12) << fixed << setprecision(1) << ms
+        << setw(12) << rows << setw(14) << setprecision(1) << (ms > 0 ? rows / ms : 0.0)
+        << setw(12) << result
+        << setw(12) << setprecision(1) << peakRssBytes() / (1024.0 * 1024.0) << "\n";
+}
+
+size_t runFilter(DatabaseManager& db, const FilterCase& c) {
+    if (c.table == "cities") {
+        CityTable& cities = db.getCities();
+        cities.clearFilters();
+        cities.addFilter(c.field, c.cmpType, c.value);
+        size_t n = 0;
+        CityTable::CityNode* node = cities.applyFilters();
+        while (node) {
+            CityTable::CityNode* next = node->next;
+            delete node;
+            node = next;
+            ++n;
+        }
+        cities.clearFilters();
+        return n;
+    }
+    if (c.table == "drivers") {
+        DriverTable& drivers = db.getDrivers();
+        drivers.clearFilters();
+        drivers.addFilter(c.field, c.cmpType, c.value);
+        int n = 0;
+        DriverTable::DriverInfo* rows = drivers.applyFilters(n);
+        delete[] rows;
+        drivers.clearFilters();
+        return static_cast<size_t>(n);
+    }
+    if (c.table == "fines") {
+        FineTable& fines = db.getFines();
+        fines.clearFilters();
+        fines.addFilter(c.field, c.cmpType, c.value);
+        int n = 0;
+        FineTable::FineInfo* rows = fines.applyFilters(n);
+        delete[] rows;
+        fines.clearFilters();
+        return static_cast<size_t>(n);
+    }
+    FineRegistry& registry = db.getRegistry();
+    registry.clearFilters();
+    registry.addFilter(c.field, c.cmpType, c.value);
+    size_t n = registry.applyFilters(db.getDrivers(), db.getCities(), db.getFines()).size();
+    registry.clearFilters();
+    return n;
+}
+
+// Нарушения по городам — тот же алгоритм, что UserInterface::collectCityStats:
+// один проход по ID нарушений, группы по cityId в хеш-таблице
+size_t violationsByCity(DatabaseManager& db) {
+    struct CityStat {
+        int cityId;
+        string name;
+        vector<int> violationIds;
+    };
+    FineRegistry& registry = db.getRegistry();
+    CityTable& cities = db.getCities();
+    vector<CityStat> stats;
+    unordered_map<int, size_t> slotOf;
+    FineRegistry::ViolationInfo v;
+    for (int recordId : registry.getAllRecordIds()) {
+        registry.findViolation(recordId, v);
+        auto slot = slotOf.emplace(v.cityId, stats.size());
+        if (slot.second) stats.push_back({ v.cityId, string(cities.getCityNameById(v.cityId)), {} });
+        stats[slot.first->second].violationIds.push_back(recordId);
+    }
+    sort(stats.begin(), stats.end(), [](const CityStat& a, const CityStat& b) {
+        if (a.violationIds.size() != b.violationIds.size()) return a.violationIds.size() > b.violationIds.size();
+        return a.name < b.name;
+    });
+    return stats.size();
+}
+
+// Прежний вариант для сравнения: getAllViolations и линейный поиск города по имени
+size_t violationsByCityNameScan(DatabaseManager& db) {
+    struct CityStat {
+        string name;
+        vector<int> violationIds;
+    };
+    vector<CityStat> stats;
+    for (auto& v : db.getAllViolations()) {
+        size_t idx = stats.size();
+        for (size_t i = 0; i < stats.size(); ++i) {
+            if (stats[i].name == v.cityName) {
+                idx = i;
+                break;
+            }
+        }
+        if (idx == stats.size()) stats.push_back({ string(v.cityName), {} });
+        stats[idx].violationIds.push_back(v.recordId);
+    }
+    sort(stats.begin(), stats.end(), [](const CityStat& a, const CityStat& b) {
+        return a.violationIds.size() > b.violationIds.size();
+    });
+    return stats.size();
+}
+
+// Топ водителей — как UserInterface::showTopDrivers
+size_t topDrivers(DatabaseManager& db) {
+    map<string_view, int> countMap;
+    for (auto& v : db.getAllViolations()) countMap[v.driverName]++;
+    vector<pair<string, int>> vec(countMap.begin(), countMap.end());
+    sort(vec.begin(), vec.end(), [](auto& a, auto& b) { return a.second > b.second; });
+    return min<size_t>(vec.size(), 5);
+}
+
+} // namespace
+
+int runTableBench(int argc, char** argv) {
+    GenOptions options;
+    options.dir = "bench_data";
+    long long extViolations = 100;    // 0 — без слияния
+    int i = 0;
+    if (argc > 0 && argv[0][0] != '-') options.violations = atoll(argv[i++]);
+    for (; i + 1 < argc; i += 2) {
+        if (string(argv[i]) == "--ext") {
+            extViolations = atoll(argv[i + 1]);
+            continue;
+        }
+        if (string(argv[i]) == "--suffix" || !parseGenOption(argv[i], argv[i + 1], options)) {
+            cerr << "tables: unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+    if (i < argc) {
+        cerr << "tables: missing value for " << argv[i] << "\n";
+        return 1;
+    }
+
+    // Основная база и внешняя (другой seed — частично пересекающиеся имена).
+    // Слияние сравнивает каждое внешнее нарушение со всем реестром,
+    // поэтому внешняя база по умолчанию маленькая (--ext).
+    BenchTimer genTimer;
+    GenSummary main, external;
+    GenOptions extOptions = options;
+    extOptions.suffix = "_ext";
+    extOptions.seed = options.seed + 1;
+    extOptions.violations = max(0LL, extViolations);
+    extOptions.drivers = extOptions.cities = 0;
+    if (!generateDatabase(options, main)) return 1;
+    if (extOptions.violations > 0 && !generateDatabase(extOptions, external)) return 1;
+    cout << "data: " << main.cities << " cities, " << main.drivers << " drivers, " << main.fines
+        << " fines, " << main.violations << " violations (" << main.bytes / (1024 * 1024)
+        << " MB) in " << options.dir << "\n\n";
+    printHeader();
+    long long mainRows = main.cities + main.drivers + main.fines + main.violations;
+    long long extRows = external.cities + external.drivers + external.fines + external.violations;
+    report("generate", genTimer.elapsedMs(), mainRows + extRows, mainRows + extRows);
+
+    // Таблицы читают и пишут файлы из текущего каталога
+    error_code ec;
+    filesystem::current_path(options.dir, ec);
+    if (ec) {
+        cerr << "tables: cannot enter " << options.dir << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    DatabaseManager db;
+    {
+        BenchTimer t;
+        db.loadAll();
+        report("load", t.elapsedMs(), mainRows, mainRows);
+    }
+
+    // Образцы значений для фильтров на равенство
+    db.getCities().cityIteratorReset();
+    string sampleCity(db.getCities().cityIteratorNext().name);
+    db.getDrivers().driverIteratorReset();
+    string sampleDriver(db.getDrivers().driverIteratorNext().fullName);
+    db.getFines().fineIteratorReset();
+    string sampleFine(db.getFines().fineIteratorNext().type);
+
+    const FilterCase cases[] = {
+        { "cities", "name", 1, "ov" },
+        { "cities", "name", 2, sampleCity },
+        { "cities", "name", 5, sampleCity.substr(0, 3) },
+        { "cities", "population", 3, "10000" },
+        { "cities", "population", 4, "1000000" },
+        { "cities", "population", 2, "50000" },
+        { "cities", "type", 2, "Village" },
+        { "cities", "grade", 2, "Large" },
+        { "drivers", "fullName", 1, "ova" },
+        { "drivers", "fullName", 2, sampleDriver },
+        { "drivers", "fullName", 5, sampleDriver.substr(0, 4) },
+        { "drivers", "birthDate", 2, "01.01.1980" },
+        { "fines", "type", 1, "Urban" },
+        { "fines", "type", 2, sampleFine },
+        { "fines", "type", 5, "No" },
+        { "fines", "amount", 3, "1000" },
+        { "fines", "amount", 4, "5000" },
+        { "fines", "amount", 2, "500" },
+        { "fines", "severity", 2, "Heavy" },
+        { "violations", "driver", 2, sampleDriver },
+        { "violations", "city", 2, sampleCity },
+        { "violations", "fineType", 2, sampleFine },
+        { "violations", "paid", 2, "1" },
+        { "violations", "amount", 3, "1000" },
+        { "violations", "amount", 4, "5000" },
+        { "violations", "date", 3, "01.01.2016" },
+        { "violations", "date", 4, "01.01.2025" },
+    };
+    const char* ops[] = { "", "contains", "=", "<", ">", "starts" };
+    auto tableRows = [&](const string& table) -> long long {
+        if (table == "cities") return main.cities;
+        if (table == "drivers") return main.drivers;
+        if (table == "fines") return main.fines;
+        return main.violations;
+    };
+    for (const FilterCase& c : cases) {
+        BenchTimer t;
+        size_t n = runFilter(db, c);
+        report("filter " + c.table + "." + c.field + " " + ops[c.cmpType], t.elapsedMs(),
+            tableRows(c.table), static_cast<long long>(n));
+    }
+
+    {
+        BenchTimer t;
+        size_t n = db.getAllViolations().size();
+        report("getAllViolations", t.elapsedMs(), main.violations, static_cast<long long>(n));
+    }
+    {
+        BenchTimer t;
+        size_t n = violationsByCityNameScan(db);
+        report("stats: by city (name scan)", t.elapsedMs(), main.violations, static_cast<long long>(n));
+    }
+    {
+        BenchTimer t;
+        size_t n = violationsByCity(db);
+        report("stats: violations by city", t.elapsedMs(), main.violations, static_cast<long long>(n));
+    }
+    {
+        BenchTimer t;
+        size_t n = topDrivers(db);
+        report("stats: top drivers", t.elapsedMs(), main.violations, static_cast<long long>(n));
+    }
+    for (const char* dims : { "city", "city, severity, month", "driver" }) {
+        BenchTimer t;
+        GroupByEngine::Result r = db.groupViolations(GroupByEngine::parseSpec(dims, ""));
+        report(string("group by ") + dims, t.elapsedMs(), main.violations,
+            static_cast<long long>(r.groups.size()));
+    }
+    {
+        // Те же месячные ряды по счётчикам реестра, затем дневные за один месяц
+        BenchTimer t;
+        size_t n = db.violationSeries(ViolationRollup::Granularity::MONTH, 0, 99991231, "").size();
+        report("rollup: month x city x severity", t.elapsedMs(), main.violations, static_cast<long long>(n));
+        BenchTimer day;
+        n = db.violationSeries(ViolationRollup::Granularity::DAY, 20200101, 20200131, "").size();
+        report("rollup: days of one month", day.elapsedMs(), main.violations, static_cast<long long>(n));
+    }
+    {
+        // Должники: прежний проход по реестру против счётчиков DebtLedger
+        BenchTimer t;
+        unordered_map<int, double> owed;
+        for (auto& v : db.getAllViolations())
+            if (!v.paid) owed[v.driverId] += v.fineAmount;
+        size_t n = 0;
+        for (auto& d : owed) n += d.second > 1000;
+        report("debtors > 1000: registry scan", t.elapsedMs(), main.violations, static_cast<long long>(n));
+        BenchTimer ledger;
+        n = db.debtors(1000, 0).size();
+        report("debtors > 1000: ledger", ledger.elapsedMs(), main.violations, static_cast<long long>(n));
+        BenchTimer top;
+        n = db.debtors(0, 10).size();
+        report("debtors: top 10", top.elapsedMs(), main.violations, static_cast<long long>(n));
+    }
+    {
+        // Цена CDC: каждая запись переключается туда и обратно (2 изменения
+        // на строку) без подписчиков и с подписчиком, считающим события
+        auto togglePaid = [&db] {
+            auto lock = db.lockTables();
+            FineRegistry& registry = db.getRegistry();
+            size_t n = 0;
+            for (int id = 1; id <= registry.getMaxRecordId(); ++id) {
+                FineRegistry::ViolationInfo v = registry.getViolationById(id,
+                    db.getDrivers(), db.getCities(), db.getFines());
+                if (v.recordId != id) continue;
+                registry.updateViolationPaid(id, !v.paid);
+                registry.updateViolationPaid(id, v.paid);
+                n += 2;
+            }
+            return n;
+        };
+        BenchTimer off;
+        size_t n = togglePaid();
+        report("update paid x2: cdc off", off.elapsedMs(), main.violations, static_cast<long long>(n));
+        size_t seen = 0;
+        int subscription = db.getChanges().subscribe([&seen](const ChangeEvent*, size_t count) { seen += count; });
+        BenchTimer on;
+        togglePaid();
+        db.getChanges().flush();
+        report("update paid x2: cdc on", on.elapsedMs(), main.violations, static_cast<long long>(seen));
+        db.getChanges().unsubscribe(subscription);
+    }
+    {
+        // Поиск повторов, как при слиянии и импорте: ключи всех записей
+        // (все найдутся) и те же ключи с датой, которой в реестре нет
+        // (почти все отсекает фильтр); прежде — индекс всех ключей реестра
+        auto lock = db.lockTables();
+        FineRegistry& registry = db.getRegistry();
+        vector<FineRegistry::ViolationInfo> keys;
+        keys.reserve(static_cast<size_t>(registry.getRecordCount()));
+        FineRegistry::ViolationInfo v;
+        for (int id : registry.getAllRecordIds())
+            if (registry.findViolation(id, v)) keys.push_back(v);
+
+        BenchTimer build;
+        unordered_map<string, int> keyMap;
+        keyMap.reserve(keys.size());
+        for (const auto& k : keys) {
+            keyMap.emplace(to_string(k.driverId) + ' ' + to_string(k.cityId) + ' '
+                + to_string(k.fineId) + ' ' + string(k.date), k.recordId);
+        }
+        report("dedup: key map of registry", build.elapsedMs(), main.violations, static_cast<long long>(keyMap.size()));
+
+        BenchTimer existing;
+        size_t found = 0;
+        for (const auto& k : keys) found += registry.findIdentical(k.driverId, k.cityId, k.fineId, k.date) != 0;
+        report("dedup: probe existing keys", existing.elapsedMs(), main.violations, static_cast<long long>(found));
+
+        FineRegistry::IdentityStats before = registry.getIdentityStats();
+        BenchTimer fresh;
+        found = 0;
+        for (const auto& k : keys) found += registry.findIdentical(k.driverId, k.cityId, k.fineId, "01.01.1900") != 0;
+        FineRegistry::IdentityStats after = registry.getIdentityStats();
+        report("dedup: probe new keys", fresh.elapsedMs(), main.violations, static_cast<long long>(found));
+        cout << "  filter: " << registry.getIdentityFilter().bytes() / 1024 << " KB, new keys skipped "
+            << after.skipped - before.skipped << ", false positives "
+            << after.falsePositives - before.falsePositives << "\n";
+    }
+    {
+        // Выбранные планы против полного прохода — строки должны совпасть.
+        // Временные записи с пустыми (-1) и висячими ссылками — как после
+        // SET_NULL и удаления связанных строк
+        auto lock = db.lockTables();
+        FineRegistry& registry = db.getRegistry();
+        vector<int> temporary = {
+            registry.addViolation(-1, -1, -1, "01.06.2020"),
+            registry.addViolation(999999, 999999, 999999, "02.06.2020"),
+        };
+        const vector<string> queries = {
+            "violations WHERE city.id < 1",
+            "violations WHERE NOT city.grade = Large",
+            "violations WHERE city.grade = Large AND fine.severity = Heavy",
+            "violations WHERE NOT (fine.amount > 1000 OR city.population < 100000)",
+            "violations WHERE driver.birthDate < 01.01.1970",
+            "violations WHERE driver.id IN (1, 2, 999999)",
+            "violations WHERE date BETWEEN 01.01.2016 AND 31.12.2016 AND paid = 1",
+            "drivers WHERE city.grade = Small",
+            "cities WHERE population > 100000",
+        };
+        QueryEngine engine(db.getCities(), db.getDrivers(), db.getFines(), registry);
+        QueryEngine reference(db.getCities(), db.getDrivers(), db.getFines(), registry);
+        reference.setFullScanOnly(true);
+        vector<vector<vector<string>>> planned, scanned;
+        BenchTimer t;
+        for (const auto& q : queries) planned.push_back(engine.execute(q).rows);
+        double plannedMs = t.elapsedMs();
+        BenchTimer full;
+        for (const auto& q : queries) scanned.push_back(reference.execute(q).rows);
+        double fullMs = full.elapsedMs();
+        size_t rows = 0, mismatches = 0;
+        for (size_t q = 0; q < queries.size(); ++q) {
+            sort(planned[q].begin(), planned[q].end());
+            sort(scanned[q].begin(), scanned[q].end());
+            rows += planned[q].size();
+            if (planned[q] != scanned[q]) {
+                ++mismatches;
+                cerr << "query plan mismatch: " << queries[q] << " (" << planned[q].size()
+                    << " rows, full scan " << scanned[q].size() << ")\n";
+            }
+        }
+        report("query: chosen plans", plannedMs, main.violations, static_cast<long long>(rows));
+        report("query: full scan", fullMs, main.violations, static_cast<long long>(rows));
+        cout << "  plans vs full scan: " << queries.size() << " queries, " << mismatches << " mismatches\n";
+        for (int id : temporary) registry.deleteViolation(id);
+    }
+    {
+        BenchTimer t;
+        db.saveAll();
+        report("save", t.elapsedMs(), mainRows, mainRows);
+    }
+    if (extOptions.violations > 0) {
+        // Слияние фиксирует результат; flush — дождаться записи на диск
+        BenchTimer t;
+        db.mergeExternal({ "_ext" });
+        db.flush();
+        report("merge _ext (load + merge + save)", t.elapsedMs(), extRows,
+            db.getRegistry().getRecordCount());
+    }
+
+    // Встроенные метрики за весь прогон — рядом с данными
+    if (Metrics::enabled() && Metrics::instance().dumpJson("metrics.json"))
+        cout << "\nmetrics: " << options.dir << "/metrics.json\n";
+    return 0;
+}
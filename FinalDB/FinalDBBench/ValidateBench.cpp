@@ -0,0 +1,130 @@
+#include "Bench.h"
+#include "Validation.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+
+// Прежние проверки DriverTable: regex и localtime_s на каждый вызов
+bool regexName(const string& name) {
+    static const regex pattern("^[A-Za-z\\s]+$");
+    return regex_match(name, pattern);
+}
+
+bool regexDate(const string& date) {
+    static const regex pattern("^\\d{2}\\.\\d{2}\\.\\d{4}$");
+    return regex_match(date, pattern);
+}
+
+bool regexAge(const string& birthDate) {
+    if (birthDate.size() != 10 || birthDate[2] != '.' || birthDate[5] != '.') return false;
+    int day, month, year;
+    try {
+        day = stoi(birthDate.substr(0, 2));
+        month = stoi(birthDate.substr(3, 2));
+        year = stoi(birthDate.substr(6, 4));
+    }
+    catch (...) {
+        return false;
+    }
+    time_t t = time(nullptr);
+    tm now;
+    localtime_s(&now, &t);
+    int age = now.tm_year + 1900 - year;
+    if (now.tm_mon + 1 < month || (now.tm_mon + 1 == month && now.tm_mday < day)) age--;
+    return age >= 18 && age <= 100;
+}
+
+// Строки ФИО и дат, около 5% — с ошибками
+void buildInput(int rows, vector<string>& names, vector<string>& dates) {
+    const char* parts[] = { "Ivanov", "Petrova", "Sidorov", "Anna", "Sergey", "Olga",
+        "Dmitrievna", "Igorevich", "Nikolaevna" };
+    const char* broken[] = { "Ivanov2 Anna", "Petrov_Ivan", "", "Olga-Maria" };
+    const char* badDates[] = { "1.02.1990", "01-02-1990", "01.02.199x", "", "01.02.19901" };
+    mt19937 rng(7);
+    char buf[16];
+    for (int i = 0; i < rows; ++i) {
+        if (rng() % 20 == 0) {
+            names.push_back(broken[rng() % 4]);
+            dates.push_back(badDates[rng() % 5]);
+            continue;
+        }
+        names.push_back(string(parts[rng() % 3]) + " " + parts[3 + rng() % 3] + " " + parts[6 + rng() % 3]);
+        snprintf(buf, sizeof(buf), "%02d.%02d.%04d", static_cast<int>(1 + rng() % 28),
+            static_cast<int>(1 + rng() % 12), static_cast<int>(1915 + rng() % 110));
+        dates.push_back(buf);
+    }
+}
+
+template <class Check>
+double best(int iterations, const vector<string>& input, vector<char>& result, Check check) {
+    double bestMs = 1e300;
+    for (int it = 0; it < iterations; ++it) {
+        BenchTimer t;
+        for (size_t i = 0; i < input.size(); ++i) result[i] = check(input[i]);
+        bestMs = min(bestMs, t.elapsedMs());
+    }
+    return bestMs;
+}
+
+void report(const char* check, double regexMs, double handMs, int rows, size_t valid) {
+    cout << left << setw(10) << check << right
+        << setw(10) << valid
+        << setw(12) << fixed << setprecision(2) << regexMs
+        << setw(12) << handMs
+        << setw(12) << setprecision(1) << (rows / regexMs / 1000.0)
+        << setw(12) << (rows / handMs / 1000.0)
+        << setw(10) << setprecision(1) << (regexMs / handMs) << "x\n";
+}
+
+} // namespace
+
+int runValidateBench(int argc, char** argv) {
+    int rows = argc > 0 ? atoi(argv[0]) : 200000;
+    int iterations = argc > 1 ? atoi(argv[1]) : 3;
+    if (rows <= 0 || iterations <= 0) {
+        cerr << "validate: rows and iterations must be positive\n";
+        return 1;
+    }
+    vector<string> names, dates;
+    buildInput(rows, names, dates);
+    cout << "rows: " << rows << "\n\n";
+    cout << left << setw(10) << "check" << right << setw(10) << "valid"
+        << setw(12) << "regex ms" << setw(12) << "hand ms"
+        << setw(12) << "regex Mr/s" << setw(12) << "hand Mr/s" << setw(11) << "speedup" << "\n";
+
+    bool ok = true;
+    vector<char> expected(rows), actual(rows);
+    auto compare = [&](const char* check, double regexMs, double handMs) {
+        report(check, regexMs, handMs, rows, count(actual.begin(), actual.end(), 1));
+        if (expected != actual) {
+            cerr << "MISMATCH: " << check << "\n";
+            ok = false;
+        }
+    };
+
+    double r = best(iterations, names, expected, regexName);
+    double h = best(iterations, names, actual, [](const string& s) { return Validation::isName(s); });
+    compare("name", r, h);
+
+    r = best(iterations, dates, expected, regexDate);
+    h = best(iterations, dates, actual, [](const string& s) { return Validation::isDate(s); });
+    compare("date", r, h);
+
+    // Возраст: в прежнем пути — после проверки формата, как в addDriver
+    r = best(iterations, dates, expected, [](const string& s) { return regexDate(s) && regexAge(s); });
+    Validation::Date today = Validation::today();
+    h = best(iterations, dates, actual, [&today](const string& s) { return Validation::isDriverAge(s, today); });
+    compare("date+age", r, h);
+
+    return ok ? 0 : 2;
+}
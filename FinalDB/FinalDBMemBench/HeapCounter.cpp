@@ -0,0 +1,50 @@
+#include "HeapCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+using namespace std;
+
+// Замена глобальных operator new/delete: поэтому бенчмарк памяти —
+// отдельная программа, остальные замеры FinalDBBench идут без счётчика.
+// Отдельный файл, чтобы delete не встраивался в измеряемый код.
+// Размер блока берётся у самого malloc, заголовок перед блоком не нужен.
+namespace {
+    atomic<size_t> heapBytes{ 0 };
+    atomic<size_t> heapBlocks{ 0 };
+
+    size_t blockSize(void* p) {
+#ifdef _WIN32
+        return _msize(p);
+#else
+        return malloc_usable_size(p);
+#endif
+    }
+}
+
+void* operator new(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (!p) throw bad_alloc();
+    heapBytes.fetch_add(blockSize(p), memory_order_relaxed);
+    heapBlocks.fetch_add(1, memory_order_relaxed);
+    return p;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    heapBytes.fetch_sub(blockSize(ptr), memory_order_relaxed);
+    heapBlocks.fetch_sub(1, memory_order_relaxed);
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+size_t heapBytesInUse() {
+    return heapBytes.load();
+}
+
+size_t heapBlocksInUse() {
+    return heapBlocks.load();
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <cstddef>
+
+// Байты и блоки, выделенные через operator new и ещё не освобождённые.
+// Считает замена глобальных operator new/delete в HeapCounter.cpp.
+size_t heapBytesInUse();
+size_t heapBlocksInUse();
@@ -0,0 +1,153 @@
+#include "HeapCounter.h"
+#include "FineRegistry.h"
+#include "IntHashMap.h"
+#include "StringPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+
+// Прежнее хранение реестра: узел двусвязного списка на запись
+// плюс хеш-таблица recordId → узел
+struct OldViolationNode {
+    int    recordId;
+    int    driverId;
+    int    cityId;
+    int    fineId;
+    bool   paid;
+    InternedString date;
+    OldViolationNode* next;
+    OldViolationNode* prev;
+};
+
+struct HeapUsage {
+    size_t bytes, blocks;
+};
+
+HeapUsage heapNow() {
+    return { heapBytesInUse(), heapBlocksInUse() };
+}
+
+void report(const char* layout, size_t rowSize, HeapUsage used, int rows) {
+    cout << left << setw(22) << layout << right
+        << setw(10) << rowSize
+        << setw(14) << fixed << setprecision(1) << static_cast<double>(used.bytes) / rows
+        << setw(14) << setprecision(3) << static_cast<double>(used.blocks) / rows
+        << setw(12) << setprecision(1) << used.bytes / (1024.0 * 1024.0) << "\n";
+}
+
+HeapUsage since(HeapUsage before) {
+    HeapUsage now = heapNow();
+    return { now.bytes - before.bytes, now.blocks - before.blocks };
+}
+
+} // namespace
+
+// FinalDBMemBench [rows]: байты реестра на нарушение, список узлов против упакованных строк
+int main(int argc, char** argv) {
+    int rows = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (rows <= 0) {
+        cerr << "memory: rows must be positive\n";
+        return 1;
+    }
+    // Даты заранее в пуле: их стоимость не зависит от числа записей
+    mt19937 rng(11);
+    vector<string> dates;
+    char buf[16];
+    for (int year = 2015; year < 2025; ++year)
+        for (int day = 0; day < 365; ++day) {
+            snprintf(buf, sizeof(buf), "%02d.%02d.%04d", 1 + day % 28, 1 + day / 31 % 12, year);
+            dates.push_back(buf);
+            InternedString warm(dates.back());
+        }
+    auto dateAt = [&](int i) -> const string& { return dates[i % dates.size()]; };
+
+    cout << "rows: " << rows << "\n\n";
+    cout << left << setw(22) << "layout" << right << setw(10) << "sizeof"
+        << setw(14) << "heap B/row" << setw(14) << "allocs/row" << setw(12) << "heap MB" << "\n";
+
+    {
+        HeapUsage before = heapNow();
+        IntHashMap byId;
+        OldViolationNode* head = nullptr;
+        for (int i = 1; i <= rows; ++i) {
+            OldViolationNode* node = new OldViolationNode{ i, static_cast<int>(rng() % 5000),
+                static_cast<int>(rng() % 50), static_cast<int>(rng() % 20), (i & 1) != 0,
+                InternedString(dateAt(i)), head, nullptr };
+            if (head) head->prev = node;
+            head = node;
+            byId.insert(i, node);
+        }
+        report("node list + hash", sizeof(OldViolationNode), since(before), rows);
+        while (head) {
+            OldViolationNode* next = head->next;
+            delete head;
+            head = next;
+        }
+    }
+
+    {
+        HeapUsage before = heapNow();
+        FineRegistry registry;
+        for (int i = 1; i <= rows; ++i) {
+            int id = registry.addViolation(static_cast<int>(rng() % 5000), static_cast<int>(rng() % 50),
+                static_cast<int>(rng() % 20), dateAt(i));
+            if (i & 1) registry.markAsPaid(id);
+        }
+        // Строки отдельно от вторичных индексов (они одинаковы в обеих схемах)
+        size_t blocks = (static_cast<size_t>(rows) + FineRegistry::SEGMENT_RECORDS - 1) / FineRegistry::SEGMENT_RECORDS;
+        report("packed rows", FineRegistry::rowSize(), { registry.storageBytes(), blocks + 1 }, rows);
+        report("packed rows + indexes", FineRegistry::rowSize(), since(before), rows);
+    }
+
+    {
+        // Реестр в порядке дат, как он копится: записи до 2023 года оплачены
+        // и заполняют первые сегменты, из новых оплачена половина. Объём —
+        // после загрузки с диска, без холодного яруса и с ним
+        error_code ec;
+        filesystem::path home = filesystem::current_path(ec);
+        filesystem::path dir = filesystem::temp_directory_path(ec) / "finaldb_memory_bench";
+        filesystem::remove_all(dir, ec);
+        filesystem::create_directories(dir, ec);
+        filesystem::current_path(dir, ec);
+        if (ec) {
+            cerr << "memory: cannot use " << dir.string() << ": " << ec.message() << "\n";
+            return 1;
+        }
+        {
+            FineRegistry registry;
+            for (int i = 0; i < rows; ++i) {
+                const string& date = dates[static_cast<size_t>(i) * dates.size() / rows];
+                int id = registry.addViolation(static_cast<int>(rng() % 5000), static_cast<int>(rng() % 50),
+                    static_cast<int>(rng() % 20), date);
+                if (date.compare(6, 4, "2023") < 0 || (i & 1)) registry.markAsPaid(id);
+            }
+            registry.saveToFile();
+        }
+        for (int cutoff : { 0, 20230101 }) {
+            HeapUsage before = heapNow();
+            FineRegistry registry;
+            registry.setColdCutoff(cutoff);
+            registry.loadFromFile("registry.txt");
+            report(cutoff ? "loaded, cold < 2023" : "loaded, all hot", FineRegistry::rowSize(), since(before), rows);
+            if (cutoff) {
+                cout << "  cold: " << registry.getColdCount() << " rows, " << setprecision(1)
+                    << static_cast<double>(registry.coldBytes()) / max(1, registry.getColdCount())
+                    << " B/row in blocks; hot rows " << registry.storageBytes() / 1024 << " KB; rollup "
+                    << registry.getRollup().cellCount() * sizeof(ViolationRollup::Cell) / 1024
+                    << " KB (all rows, both tiers)\n";
+            }
+        }
+        filesystem::current_path(home, ec);
+        filesystem::remove_all(dir, ec);
+    }
+    return 0;
+}